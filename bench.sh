@@ -0,0 +1,107 @@
+#!/bin/sh
+#
+# Scalability benchmark of the model (run by 'make -f makefile-NW bench').
+#
+# Runs each scenario headless for each number of households, scaling the
+# number of firms per sector in the same proportion, and collects the
+# benchmark records of lsdNW ('-j' option) in a single JSON file: wall time
+# and peak resident memory per time step, the time spent in the equations
+# in BENCH_EQS per time step and the time to save the results of the run.
+#
+# Settings (environment variables):
+#   BENCH_SCENARIOS  scenario numbers to run (default: 0 1 2 3)
+#   BENCH_SIZES      numbers of households (default: 100 1000 10000 100000)
+#   BENCH_STEPS      time steps per run (default: 20)
+#   BENCH_EQS        comma-separated equations to time
+#   BENCH_DIR        work directory (default: bench)
+#   BENCH_OUT        JSON output file (default: $BENCH_DIR/bench.json)
+#   LSD              lsdNW executable (default: ./lsdNW)
+#   LSD_OPTS         additional lsdNW options (e.g. -d -c 4)
+
+BENCH_SCENARIOS=${BENCH_SCENARIOS:-"0 1 2 3"}
+BENCH_SIZES=${BENCH_SIZES:-"100 1000 10000 100000"}
+BENCH_STEPS=${BENCH_STEPS:-20}
+BENCH_EQS=${BENCH_EQS:-"Class_Employed_Count,Country_Inequality_Master,Loans_Distribution_Firms"}
+BENCH_DIR=${BENCH_DIR:-bench}
+BENCH_OUT=${BENCH_OUT:-$BENCH_DIR/bench.json}
+LSD=${LSD:-./lsdNW}
+
+if [ ! -x "$LSD" ]; then
+	echo "LSD executable '$LSD' not found, build it first" >&2
+	exit 1
+fi
+
+mkdir -p "$BENCH_DIR" || exit 1
+sep=""
+printf '{"steps":%d,"runs":[' "$BENCH_STEPS" > "$BENCH_OUT.tmp"
+
+for s in $BENCH_SCENARIOS; do
+	for n in $BENCH_SIZES; do
+		name=Scenario_${s}_N$n
+		cfg=$BENCH_DIR/$name.lsd
+
+		if [ ! -f Scenario_$s.lsd ]; then
+			echo "Configuration 'Scenario_$s.lsd' not found, skipping" >&2
+			continue
+		fi
+
+		# scale the configuration: households, firms per sector, one run
+		awk -v n="$n" -v steps="$BENCH_STEPS" '
+			function values( ) {
+				line = $1
+				for ( i = 2; i <= 7; ++i )
+					line = line " " $i
+				for ( i = 8; i <= NF; ++i )
+					line = line "\t" $i
+				return line
+			}
+			FNR == NR {
+				if ( $1 == "Param:" && $2 == "country_total_population" && NF > 7 )
+					pop = $NF
+				next
+			}
+			$1 == "Param:" && $2 == "country_total_population" && NF > 7 {
+				$NF = n
+				print values( )
+				next
+			}
+			$1 == "Param:" && $2 == "sector_number_object_firms" && NF > 7 {
+				firms = ""
+				for ( i = 8; i <= NF; ++i ) {
+					$i = int( $i * n / pop + 0.5 )
+					if ( $i < 1 )
+						$i = 1
+					firms = firms ( i > 8 ? "," : "" ) $i
+				}
+				print firms > "/dev/stderr"
+				print values( )
+				next
+			}
+			$1 == "SIM_NUM" { print "SIM_NUM 1"; next }
+			$1 == "MAX_STEP" { print "MAX_STEP " steps; next }
+			{ print }
+		' Scenario_$s.lsd Scenario_$s.lsd > "$cfg" 2> "$BENCH_DIR/$name.firms"
+
+		firms=$(cat "$BENCH_DIR/$name.firms")
+		rm -f "$BENCH_DIR/$name.firms"
+
+		echo "Running scenario $s with $n households and $firms firms per sector..."
+
+		$LSD -f "$cfg" -z -p -o "$BENCH_DIR" -l "$BENCH_DIR/$name.log" \
+			-j "$BENCH_DIR/$name.json:$BENCH_EQS" $LSD_OPTS
+
+		if [ $? -ne 0 ] || [ ! -s "$BENCH_DIR/$name.json" ]; then
+			echo "Run failed, see '$BENCH_DIR/$name.log'" >&2
+			continue
+		fi
+
+		printf '%s\n{"scenario":%d,"households":%d,"firms":[%s],"bench":' "$sep" "$s" "$n" "$firms" >> "$BENCH_OUT.tmp"
+		cat "$BENCH_DIR/$name.json" >> "$BENCH_OUT.tmp"
+		printf '}' >> "$BENCH_OUT.tmp"
+		sep=","
+	done
+done
+
+printf '\n]}\n' >> "$BENCH_OUT.tmp"
+mv "$BENCH_OUT.tmp" "$BENCH_OUT"
+echo "Benchmark records saved to '$BENCH_OUT'"
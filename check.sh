@@ -0,0 +1,82 @@
+#!/bin/sh
+#
+# Regression check of the parallel computation (run by 'make -f makefile-NW
+# check').
+#
+# Runs each scenario headless for a few time steps serially, and then with
+# the dependency waves ('-d' option) for each number of threads, comparing
+# the saved results of each parallel run with the serial ones, which must be
+# identical. The time steps must be more than the dependency recording
+# warm-up (DEP_WARM) for the waves to be used, and long enough for late
+# divergences to show in the results. Exit with an error if any run fails or
+# differs from the serial run.
+#
+# Settings (environment variables):
+#   CHECK_SCENARIOS  scenario numbers to run (default: 0)
+#   CHECK_STEPS      time steps per run (default: 30)
+#   CHECK_THREADS    numbers of threads (default: 2 4)
+#   CHECK_DIR        work directory (default: check)
+#   LSD              lsdNW executable (default: ./lsdNW)
+
+CHECK_SCENARIOS=${CHECK_SCENARIOS:-0}
+CHECK_STEPS=${CHECK_STEPS:-30}
+CHECK_THREADS=${CHECK_THREADS:-"2 4"}
+CHECK_DIR=${CHECK_DIR:-check}
+LSD=${LSD:-./lsdNW}
+
+if [ ! -x "$LSD" ]; then
+	echo "LSD executable '$LSD' not found, build it first" >&2
+	exit 1
+fi
+
+mkdir -p "$CHECK_DIR" || exit 1
+fail=0
+
+for s in $CHECK_SCENARIOS; do
+	name=Scenario_${s}_check
+	cfg=$CHECK_DIR/$name.lsd
+
+	if [ ! -f Scenario_$s.lsd ]; then
+		echo "Configuration 'Scenario_$s.lsd' not found, skipping" >&2
+		continue
+	fi
+
+	# shorten the configuration to a single run
+	awk -v steps="$CHECK_STEPS" '
+		$1 == "SIM_NUM" { print "SIM_NUM 1"; next }
+		$1 == "MAX_STEP" { print "MAX_STEP " steps; next }
+		{ print }
+	' Scenario_$s.lsd > "$cfg"
+
+	for opts in "" $CHECK_THREADS; do
+		out=$CHECK_DIR/${opts:-serial}
+		mkdir -p "$out" || exit 1
+		rm -f "$out/$name"_*
+
+		if [ -n "$opts" ]; then
+			echo "Running scenario $s with dependency waves and $opts threads..."
+		else
+			echo "Running scenario $s serially..."
+		fi
+
+		$LSD -f "$cfg" -t -z -p -o "$out" -l "$out/$name.log" ${opts:+-d -c $opts}
+
+		if [ $? -ne 0 ] || [ ! -s "$out/${name}_1.csv" ]; then
+			echo "Run failed, see '$out/$name.log'" >&2
+			fail=1
+			continue
+		fi
+
+		if [ -n "$opts" ] && ! cmp -s "$CHECK_DIR/serial/${name}_1.csv" "$out/${name}_1.csv"; then
+			echo "Results differ from the serial run: '$out/${name}_1.csv'" >&2
+			fail=1
+		fi
+	done
+done
+
+if [ $fail -ne 0 ]; then
+	echo "Parallel check failed" >&2
+	exit 1
+fi
+
+echo "Parallel results identical to the serial ones"
@@ -1,7 +1,7 @@
 /*******************************************************************************
  * fun_classes.h - CLASS-Level Aggregation Module
  *
- * Master equation pattern: Class_Employed_Count iterates each CLASS's
+ * Master equation pattern: Class_Employed_Count reduces each CLASS's
  * HOUSEHOLD objects ONCE, accumulating all 59 class-level values simultaneously.
  * Individual equations are EQUATION_DUMMY, computed by the master via WRITE().
  *
@@ -23,7 +23,7 @@
 /*============================================================================
  * MASTER AGGREGATION EQUATION
  *
- * Single CYCLE through all HOUSEHOLD objects in this CLASS.
+ * Single REDUCE pass through all HOUSEHOLD objects in this CLASS.
  * Accumulates 59 values simultaneously: 50 sums, 7 averages, 2 counts.
  * All other Class_* equations are EQUATION_DUMMY pointing to this master.
  *============================================================================*/
@@ -32,136 +32,177 @@ EQUATION("Class_Employed_Count")
 /*
 Master aggregation equation for all class-level household aggregates.
 Returns the number of employed households; WRITEs all other class totals.
+All household values are reduced in a single engine pass (REDUCE_VAL),
+evaluated per household in the same order of the former CYCLE.
 */
-	// SUM accumulators — income
-	double wage = 0, profit = 0, unemp_ben = 0, gross = 0, tax = 0;
-	double disp = 0, real_disp = 0, avg_real_inc = 0, avg_nom_inc = 0;
-	double transfer = 0, dep_ret = 0;
-	// SUM accumulators — consumption
-	double real_dom_dem = 0, real_imp_dem = 0, eff_exp = 0;
-	double real_auton = 0, real_des_dom = 0, des_exp = 0;
-	double eff_real_dom = 0, eff_real_imp = 0;
-	double ret_dep = 0, int_funds = 0, max_exp = 0, asset_purch = 0;
-	// SUM accumulators — financial stocks
-	double deposits = 0, loans = 0, fin_assets = 0, net_wealth = 0, savings = 0;
-	// SUM accumulators — financial flows
-	double int_pay = 0, debt_pay = 0, dem_loans = 0, eff_loans = 0;
-	double max_loans = 0, fin_oblig = 0;
-	// SUM accumulators — wealth tax
-	double wt_owed = 0, wt_pay = 0, wt_dep = 0, wt_assets = 0;
-	double wt_borrow = 0, wt_buffer = 0;
-	// SUM accumulators — evasion & capital flight
-	double off_dep = 0, dom_dep = 0, undecl = 0, decl = 0, repat = 0;
-	double asset_pen = 0, off_pen = 0, audited = 0, flight = 0, evasion = 0;
-	// AVE accumulators (sum first, divide by i at end)
-	double imp_share = 0, int_rate = 0, max_debt = 0;
-	double propensity = 0, sav_rate = 0, debt_rate = 0, ref_inc = 0;
+	// result indexes of the household reductions, in hh_spec order
+	enum {
+		HH_EMPLOYMENT_STATUS_CNT,
+		HH_SKILL,
+		HH_WAGE_INCOME,
+		HH_PROFIT_INCOME,
+		HH_UNEMPLOYMENT_BENEFITS,
+		HH_NOMINAL_GROSS_INCOME,
+		HH_INCOME_TAXATION,
+		HH_NOMINAL_DISPOSABLE_INCOME,
+		HH_REAL_DISPOSABLE_INCOME,
+		HH_AVG_REAL_INCOME,
+		HH_AVG_NOMINAL_INCOME,
+		HH_TRANSFER_RECEIVED,
+		HH_DEPOSITS_RETURN,
+		HH_REAL_DOMESTIC_CONSUMPTION_DEMAND,
+		HH_REAL_DESIRED_IMPORTED_CONSUMPTION,
+		HH_EFFECTIVE_EXPENSES,
+		HH_REAL_AUTONOMOUS_CONSUMPTION,
+		HH_REAL_DESIRED_DOMESTIC_CONSUMPTION,
+		HH_DESIRED_EXPENSES,
+		HH_EFFECTIVE_REAL_DOMESTIC_CONSUMPTION,
+		HH_EFFECTIVE_REAL_IMPORTED_CONSUMPTION,
+		HH_RETAINED_DEPOSITS,
+		HH_INTERNAL_FUNDS,
+		HH_MAXIMUM_EXPENSES,
+		HH_ASSET_PURCHASES,
+		HH_STOCK_DEPOSITS,
+		HH_STOCK_LOANS,
+		HH_FINANCIAL_ASSETS,
+		HH_NET_WEALTH,
+		HH_SAVINGS,
+		HH_INTEREST_PAYMENT,
+		HH_DEBT_PAYMENT,
+		HH_DEMAND_LOANS,
+		HH_EFFECTIVE_LOANS,
+		HH_MAX_LOANS,
+		HH_FINANCIAL_OBLIGATIONS,
+		HH_WEALTH_TAX_OWED,
+		HH_WEALTH_TAX_PAYMENT,
+		HH_WEALTH_TAX_PAYMENT_CNT,
+		HH_WEALTH_TAX_FROM_DEPOSITS,
+		HH_WEALTH_TAX_FROM_ASSETS,
+		HH_WEALTH_TAX_FROM_BORROWING,
+		HH_WEALTH_TAX_FROM_BUFFER,
+		HH_DEPOSITS_OFFSHORE,
+		HH_ASSETS_UNDECLARED,
+		HH_DEPOSITS_DOMESTIC,
+		HH_ASSETS_DECLARED,
+		HH_REPATRIATED_DEPOSITS,
+		HH_ASSET_PENALTY,
+		HH_OFFSHORE_PENALTY,
+		HH_IS_AUDITED,
+		HH_DECISION_FLIGHT,
+		HH_DECISION_EVASION,
+		HH_IMPORTS_SHARE,
+		HH_INTEREST_RATE,
+		HH_MAX_DEBT_RATE,
+		HH_PROPENSITY_TO_SPEND,
+		HH_SAVINGS_RATE,
+		HH_DEBT_RATE,
+		HH_REFERENCE_INCOME,
+		HH_N
+	};
+
+	// household reductions: label, reduction, count condition
+	static reduce_spec hh_spec[] = {
+		{ "Household_Employment_Status", "CNT", ">", 0 },
+		{ "household_skill", "SUM", "", 0 },
+		{ "Household_Wage_Income", "SUM", "", 0 },
+		{ "Household_Profit_Income", "SUM", "", 0 },
+		{ "Household_Unemployment_Benefits", "SUM", "", 0 },
+		{ "Household_Nominal_Gross_Income", "SUM", "", 0 },
+		{ "Household_Income_Taxation", "SUM", "", 0 },
+		{ "Household_Nominal_Disposable_Income", "SUM", "", 0 },
+		{ "Household_Real_Disposable_Income", "SUM", "", 0 },
+		{ "Household_Avg_Real_Income", "SUM", "", 0 },
+		{ "Household_Avg_Nominal_Income", "SUM", "", 0 },
+		{ "Household_Transfer_Received", "SUM", "", 0 },
+		{ "Household_Deposits_Return", "SUM", "", 0 },
+		{ "Household_Real_Domestic_Consumption_Demand", "SUM", "", 0 },
+		{ "Household_Real_Desired_Imported_Consumption", "SUM", "", 0 },
+		{ "Household_Effective_Expenses", "SUM", "", 0 },
+		{ "Household_Real_Autonomous_Consumption", "SUM", "", 0 },
+		{ "Household_Real_Desired_Domestic_Consumption", "SUM", "", 0 },
+		{ "Household_Desired_Expenses", "SUM", "", 0 },
+		{ "Household_Effective_Real_Domestic_Consumption", "SUM", "", 0 },
+		{ "Household_Effective_Real_Imported_Consumption", "SUM", "", 0 },
+		{ "Household_Retained_Deposits", "SUM", "", 0 },
+		{ "Household_Internal_Funds", "SUM", "", 0 },
+		{ "Household_Maximum_Expenses", "SUM", "", 0 },
+		{ "Household_Asset_Purchases", "SUM", "", 0 },
+		{ "Household_Stock_Deposits", "SUM", "", 0 },
+		{ "Household_Stock_Loans", "SUM", "", 0 },
+		{ "Household_Financial_Assets", "SUM", "", 0 },
+		{ "Household_Net_Wealth", "SUM", "", 0 },
+		{ "Household_Savings", "SUM", "", 0 },
+		{ "Household_Interest_Payment", "SUM", "", 0 },
+		{ "Household_Debt_Payment", "SUM", "", 0 },
+		{ "Household_Demand_Loans", "SUM", "", 0 },
+		{ "Household_Effective_Loans", "SUM", "", 0 },
+		{ "Household_Max_Loans", "SUM", "", 0 },
+		{ "Household_Financial_Obligations", "SUM", "", 0 },
+		{ "Household_Wealth_Tax_Owed", "SUM", "", 0 },
+		{ "Household_Wealth_Tax_Payment", "SUM", "", 0 },
+		{ "Household_Wealth_Tax_Payment", "CNT", ">", 0.01 },
+		{ "Household_Wealth_Tax_From_Deposits", "SUM", "", 0 },
+		{ "Household_Wealth_Tax_From_Assets", "SUM", "", 0 },
+		{ "Household_Wealth_Tax_From_Borrowing", "SUM", "", 0 },
+		{ "Household_Wealth_Tax_From_Buffer", "SUM", "", 0 },
+		{ "Household_Deposits_Offshore", "SUM", "", 0 },
+		{ "Household_Assets_Undeclared", "SUM", "", 0 },
+		{ "Household_Deposits_Domestic", "SUM", "", 0 },
+		{ "Household_Assets_Declared", "SUM", "", 0 },
+		{ "Household_Repatriated_Deposits", "SUM", "", 0 },
+		{ "Household_Asset_Penalty", "SUM", "", 0 },
+		{ "Household_Offshore_Penalty", "SUM", "", 0 },
+		{ "Household_Is_Audited", "SUM", "", 0 },
+		{ "Household_Decision_Flight", "SUM", "", 0 },
+		{ "Household_Decision_Evasion", "SUM", "", 0 },
+		{ "Household_Imports_Share", "AVE", "", 0 },
+		{ "Household_Interest_Rate", "AVE", "", 0 },
+		{ "Household_Max_Debt_Rate", "AVE", "", 0 },
+		{ "Household_Propensity_to_Spend", "AVE", "", 0 },
+		{ "Household_Savings_Rate", "AVE", "", 0 },
+		{ "Household_Debt_Rate", "AVE", "", 0 },
+		{ "Household_Reference_Income", "AVE", "", 0 },
+	};
+	static_assert(sizeof(hh_spec) / sizeof(reduce_spec) == HH_N, "hh_spec out of HH_ indexes order");
+	double r[HH_N];
+	// all household values, per household (buffer kept across calls, per thread)
+	static thread_local vector<double> hv;
+
+	double this_class = V("class_id");  // 0=workers, 1=capitalists
+
+	i = REDUCE_VAL("HOUSEHOLD", hh_spec, r, hv);
+
 	// Count accumulators
-	double employed = 0, unemployed = 0;
+	double employed   = r[HH_EMPLOYMENT_STATUS_CNT];
+	double unemployed = i - employed;
 	// Derived accumulators (for country-level delegation)
 	double empl_skill  = 0;   // sum of skill for employed workers (Country_Total_Employed_Skill)
-	double wt_count    = 0;   // count of households paying wealth tax (Country_Wealth_Tax_Taxpayer_Count)
 	double evader_cnt  = 0;   // count of evading households (Country_Evader_Count)
 	double wt_debt_sum = 0;   // Σ(debt_rate_i × income_i) for Country_Debt_Rate
-	i = 0;
 
-	double this_class = V("class_id");  // 0=workers, 1=capitalists
-
-	CYCLE(cur, "HOUSEHOLD")
+	for(j = 0; j < i; j++)
 	{
-		double emp = VS(cur, "Household_Employment_Status");
-		if(emp > 0) employed++;
-		else        unemployed++;
+		const double *h_v = &hv[j * HH_N];
 
 		// employed skill (workers only — capitalists always have class_id=1)
-		if(this_class == 0 && emp > 0)
-			empl_skill += VS(cur, "household_skill");
-
-		// income
-		wage         += VS(cur, "Household_Wage_Income");
-		profit       += VS(cur, "Household_Profit_Income");
-		unemp_ben    += VS(cur, "Household_Unemployment_Benefits");
-		gross        += VS(cur, "Household_Nominal_Gross_Income");
-		tax          += VS(cur, "Household_Income_Taxation");
-		disp         += VS(cur, "Household_Nominal_Disposable_Income");
-		real_disp    += VS(cur, "Household_Real_Disposable_Income");
-		avg_real_inc += VS(cur, "Household_Avg_Real_Income");
-		avg_nom_inc  += VS(cur, "Household_Avg_Nominal_Income");
-		transfer     += VS(cur, "Household_Transfer_Received");
-		dep_ret      += VS(cur, "Household_Deposits_Return");
-
-		// consumption
-		real_dom_dem += VS(cur, "Household_Real_Domestic_Consumption_Demand");
-		real_imp_dem += VS(cur, "Household_Real_Desired_Imported_Consumption");
-		eff_exp      += VS(cur, "Household_Effective_Expenses");
-		real_auton   += VS(cur, "Household_Real_Autonomous_Consumption");
-		real_des_dom += VS(cur, "Household_Real_Desired_Domestic_Consumption");
-		des_exp      += VS(cur, "Household_Desired_Expenses");
-		eff_real_dom += VS(cur, "Household_Effective_Real_Domestic_Consumption");
-		eff_real_imp += VS(cur, "Household_Effective_Real_Imported_Consumption");
-		ret_dep      += VS(cur, "Household_Retained_Deposits");
-		int_funds    += VS(cur, "Household_Internal_Funds");
-		max_exp      += VS(cur, "Household_Maximum_Expenses");
-		asset_purch  += VS(cur, "Household_Asset_Purchases");
-
-		// financial stocks
-		deposits   += VS(cur, "Household_Stock_Deposits");
-		loans      += VS(cur, "Household_Stock_Loans");
-		fin_assets += VS(cur, "Household_Financial_Assets");
-		net_wealth += VS(cur, "Household_Net_Wealth");
-		savings    += VS(cur, "Household_Savings");
+		if(this_class == 0 && h_v[HH_EMPLOYMENT_STATUS_CNT] > 0)
+			empl_skill += h_v[HH_SKILL];
 
 		// weighted debt rate contribution (for Country_Debt_Rate)
-		{ double dep_i = VS(cur, "Household_Stock_Deposits");
-		  double lon_i = VS(cur, "Household_Stock_Loans");
-		  double dis_i = VS(cur, "Household_Nominal_Disposable_Income");
+		{ double dep_i = h_v[HH_STOCK_DEPOSITS];
+		  double lon_i = h_v[HH_STOCK_LOANS];
+		  double dis_i = h_v[HH_NOMINAL_DISPOSABLE_INCOME];
 		  double dr = (dep_i > 0.001) ? lon_i / dep_i : 0;
 		  wt_debt_sum += dr * dis_i; }
 
-		// financial flows
-		int_pay   += VS(cur, "Household_Interest_Payment");
-		debt_pay  += VS(cur, "Household_Debt_Payment");
-		dem_loans += VS(cur, "Household_Demand_Loans");
-		eff_loans += VS(cur, "Household_Effective_Loans");
-		max_loans += VS(cur, "Household_Max_Loans");
-		fin_oblig += VS(cur, "Household_Financial_Obligations");
-
-		// wealth tax
-		wt_owed   += VS(cur, "Household_Wealth_Tax_Owed");
-		{ double wt_p = VS(cur, "Household_Wealth_Tax_Payment"); wt_pay += wt_p; if(wt_p > 0.01) wt_count++; }
-		wt_dep    += VS(cur, "Household_Wealth_Tax_From_Deposits");
-		wt_assets += VS(cur, "Household_Wealth_Tax_From_Assets");
-		wt_borrow += VS(cur, "Household_Wealth_Tax_From_Borrowing");
-		wt_buffer += VS(cur, "Household_Wealth_Tax_From_Buffer");
-
 		// evasion & capital flight
-		{ double off_i = VS(cur, "Household_Deposits_Offshore"); off_dep += off_i;
-		  double und_i = VS(cur, "Household_Assets_Undeclared"); undecl  += und_i;
-		  if(off_i > 0.01 || und_i > 0.01) evader_cnt++; }
-		dom_dep   += VS(cur, "Household_Deposits_Domestic");
-		decl      += VS(cur, "Household_Assets_Declared");
-		repat     += VS(cur, "Household_Repatriated_Deposits");
-		asset_pen += VS(cur, "Household_Asset_Penalty");
-		off_pen   += VS(cur, "Household_Offshore_Penalty");
-		audited   += VS(cur, "Household_Is_Audited");
-		flight    += VS(cur, "Household_Decision_Flight");
-		evasion   += VS(cur, "Household_Decision_Evasion");
-
-		// averages (sum here; divide by i below)
-		imp_share  += VS(cur, "Household_Imports_Share");
-		int_rate   += VS(cur, "Household_Interest_Rate");
-		max_debt   += VS(cur, "Household_Max_Debt_Rate");
-		propensity += VS(cur, "Household_Propensity_to_Spend");
-		sav_rate   += VS(cur, "Household_Savings_Rate");
-		debt_rate  += VS(cur, "Household_Debt_Rate");
-		ref_inc    += VS(cur, "Household_Reference_Income");
-
-		i++;
+		if(h_v[HH_DEPOSITS_OFFSHORE] > 0.01 || h_v[HH_ASSETS_UNDECLARED] > 0.01)
+			evader_cnt++;
 	}
 
 	// Write derived counts/sums (delegated from country-level equations)
 	WRITE("Class_Employed_Skill",          empl_skill);
-	WRITE("Class_Wealth_Tax_Payer_Count",  wt_count);
+	WRITE("Class_Wealth_Tax_Payer_Count",  r[HH_WEALTH_TAX_PAYMENT_CNT]);
 	WRITE("Class_Evader_Count",            evader_cnt);
 	WRITE("Class_Weighted_Debt_Sum",       wt_debt_sum);
 
@@ -169,75 +210,75 @@ Returns the number of employed households; WRITEs all other class totals.
 	WRITE("Class_Unemployed_Count", unemployed);
 
 	// Write sums — income
-	WRITE("Class_Wage_Income",               wage);
-	WRITE("Class_Profit_Income",             profit);
-	WRITE("Class_Unemployment_Benefits",     unemp_ben);
-	WRITE("Class_Nominal_Gross_Income",      gross);
-	WRITE("Class_Income_Taxation",           tax);
-	WRITE("Class_Nominal_Disposable_Income", disp);
-	WRITE("Class_Real_Disposable_Income",    real_disp);
-	WRITE("Class_Avg_Real_Income",           avg_real_inc);
-	WRITE("Class_Avg_Nominal_Income",        avg_nom_inc);
-	WRITE("Class_Transfer_Received",         transfer);
-	WRITE("Class_Deposits_Return",           dep_ret);
+	WRITE("Class_Wage_Income",               r[HH_WAGE_INCOME]);
+	WRITE("Class_Profit_Income",             r[HH_PROFIT_INCOME]);
+	WRITE("Class_Unemployment_Benefits",     r[HH_UNEMPLOYMENT_BENEFITS]);
+	WRITE("Class_Nominal_Gross_Income",      r[HH_NOMINAL_GROSS_INCOME]);
+	WRITE("Class_Income_Taxation",           r[HH_INCOME_TAXATION]);
+	WRITE("Class_Nominal_Disposable_Income", r[HH_NOMINAL_DISPOSABLE_INCOME]);
+	WRITE("Class_Real_Disposable_Income",    r[HH_REAL_DISPOSABLE_INCOME]);
+	WRITE("Class_Avg_Real_Income",           r[HH_AVG_REAL_INCOME]);
+	WRITE("Class_Avg_Nominal_Income",        r[HH_AVG_NOMINAL_INCOME]);
+	WRITE("Class_Transfer_Received",         r[HH_TRANSFER_RECEIVED]);
+	WRITE("Class_Deposits_Return",           r[HH_DEPOSITS_RETURN]);
 
 	// Write sums — consumption
-	WRITE("Class_Real_Domestic_Consumption_Demand",    real_dom_dem);
-	WRITE("Class_Real_Desired_Imported_Consumption",   real_imp_dem);
-	WRITE("Class_Effective_Expenses",                  eff_exp);
-	WRITE("Class_Real_Autonomous_Consumption",         real_auton);
-	WRITE("Class_Real_Desired_Domestic_Consumption",   real_des_dom);
-	WRITE("Class_Desired_Expenses",                    des_exp);
-	WRITE("Class_Effective_Real_Domestic_Consumption", eff_real_dom);
-	WRITE("Class_Effective_Real_Imported_Consumption", eff_real_imp);
-	WRITE("Class_Retained_Deposits",                   ret_dep);
-	WRITE("Class_Internal_Funds",                      int_funds);
-	WRITE("Class_Maximum_Expenses",                    max_exp);
-	WRITE("Class_Asset_Purchases",                     asset_purch);
+	WRITE("Class_Real_Domestic_Consumption_Demand",    r[HH_REAL_DOMESTIC_CONSUMPTION_DEMAND]);
+	WRITE("Class_Real_Desired_Imported_Consumption",   r[HH_REAL_DESIRED_IMPORTED_CONSUMPTION]);
+	WRITE("Class_Effective_Expenses",                  r[HH_EFFECTIVE_EXPENSES]);
+	WRITE("Class_Real_Autonomous_Consumption",         r[HH_REAL_AUTONOMOUS_CONSUMPTION]);
+	WRITE("Class_Real_Desired_Domestic_Consumption",   r[HH_REAL_DESIRED_DOMESTIC_CONSUMPTION]);
+	WRITE("Class_Desired_Expenses",                    r[HH_DESIRED_EXPENSES]);
+	WRITE("Class_Effective_Real_Domestic_Consumption", r[HH_EFFECTIVE_REAL_DOMESTIC_CONSUMPTION]);
+	WRITE("Class_Effective_Real_Imported_Consumption", r[HH_EFFECTIVE_REAL_IMPORTED_CONSUMPTION]);
+	WRITE("Class_Retained_Deposits",                   r[HH_RETAINED_DEPOSITS]);
+	WRITE("Class_Internal_Funds",                      r[HH_INTERNAL_FUNDS]);
+	WRITE("Class_Maximum_Expenses",                    r[HH_MAXIMUM_EXPENSES]);
+	WRITE("Class_Asset_Purchases",                     r[HH_ASSET_PURCHASES]);
 
 	// Write sums — financial stocks
-	WRITE("Class_Stock_Deposits",   deposits);
-	WRITE("Class_Stock_Loans",      loans);
-	WRITE("Class_Financial_Assets", fin_assets);
-	WRITE("Class_Net_Wealth",       net_wealth);
-	WRITE("Class_Savings",          savings);
+	WRITE("Class_Stock_Deposits",   r[HH_STOCK_DEPOSITS]);
+	WRITE("Class_Stock_Loans",      r[HH_STOCK_LOANS]);
+	WRITE("Class_Financial_Assets", r[HH_FINANCIAL_ASSETS]);
+	WRITE("Class_Net_Wealth",       r[HH_NET_WEALTH]);
+	WRITE("Class_Savings",          r[HH_SAVINGS]);
 
 	// Write sums — financial flows
-	WRITE("Class_Interest_Payment",      int_pay);
-	WRITE("Class_Debt_Payment",          debt_pay);
-	WRITE("Class_Demand_Loans",          dem_loans);
-	WRITE("Class_Effective_Loans",       eff_loans);
-	WRITE("Class_Max_Loans",             max_loans);
-	WRITE("Class_Financial_Obligations", fin_oblig);
+	WRITE("Class_Interest_Payment",      r[HH_INTEREST_PAYMENT]);
+	WRITE("Class_Debt_Payment",          r[HH_DEBT_PAYMENT]);
+	WRITE("Class_Demand_Loans",          r[HH_DEMAND_LOANS]);
+	WRITE("Class_Effective_Loans",       r[HH_EFFECTIVE_LOANS]);
+	WRITE("Class_Max_Loans",             r[HH_MAX_LOANS]);
+	WRITE("Class_Financial_Obligations", r[HH_FINANCIAL_OBLIGATIONS]);
 
 	// Write sums — wealth tax
-	WRITE("Class_Wealth_Tax_Owed",           wt_owed);
-	WRITE("Class_Wealth_Tax_Payment",        wt_pay);
-	WRITE("Class_Wealth_Tax_From_Deposits",  wt_dep);
-	WRITE("Class_Wealth_Tax_From_Assets",    wt_assets);
-	WRITE("Class_Wealth_Tax_From_Borrowing", wt_borrow);
-	WRITE("Class_Wealth_Tax_From_Buffer",    wt_buffer);
+	WRITE("Class_Wealth_Tax_Owed",           r[HH_WEALTH_TAX_OWED]);
+	WRITE("Class_Wealth_Tax_Payment",        r[HH_WEALTH_TAX_PAYMENT]);
+	WRITE("Class_Wealth_Tax_From_Deposits",  r[HH_WEALTH_TAX_FROM_DEPOSITS]);
+	WRITE("Class_Wealth_Tax_From_Assets",    r[HH_WEALTH_TAX_FROM_ASSETS]);
+	WRITE("Class_Wealth_Tax_From_Borrowing", r[HH_WEALTH_TAX_FROM_BORROWING]);
+	WRITE("Class_Wealth_Tax_From_Buffer",    r[HH_WEALTH_TAX_FROM_BUFFER]);
 
 	// Write sums — evasion & capital flight
-	WRITE("Class_Deposits_Offshore",    off_dep);
-	WRITE("Class_Deposits_Domestic",    dom_dep);
-	WRITE("Class_Assets_Undeclared",    undecl);
-	WRITE("Class_Assets_Declared",      decl);
-	WRITE("Class_Repatriated_Deposits", repat);
-	WRITE("Class_Asset_Penalty",        asset_pen);
-	WRITE("Class_Offshore_Penalty",     off_pen);
-	WRITE("Class_Audited_Count",        audited);
-	WRITE("Class_Flight_Count",         flight);
-	WRITE("Class_Evasion_Count",        evasion);
-
-	// Write averages (accumulated sum / household count)
-	WRITE("Class_Avg_Imports_Share",       (i > 0) ? imp_share / i : 0);
-	WRITE("Class_Avg_Interest_Rate",       (i > 0) ? int_rate   / i : 0);
-	WRITE("Class_Avg_Max_Debt_Rate",       (i > 0) ? max_debt   / i : 0);
-	WRITE("Class_Avg_Propensity_to_Spend", (i > 0) ? propensity / i : 0);
-	WRITE("Class_Avg_Savings_Rate",        (i > 0) ? sav_rate   / i : 0);
-	WRITE("Class_Avg_Debt_Rate",           (i > 0) ? debt_rate  / i : 0);
-	WRITE("Class_Avg_Reference_Income",    (i > 0) ? ref_inc    / i : 0);
+	WRITE("Class_Deposits_Offshore",    r[HH_DEPOSITS_OFFSHORE]);
+	WRITE("Class_Deposits_Domestic",    r[HH_DEPOSITS_DOMESTIC]);
+	WRITE("Class_Assets_Undeclared",    r[HH_ASSETS_UNDECLARED]);
+	WRITE("Class_Assets_Declared",      r[HH_ASSETS_DECLARED]);
+	WRITE("Class_Repatriated_Deposits", r[HH_REPATRIATED_DEPOSITS]);
+	WRITE("Class_Asset_Penalty",        r[HH_ASSET_PENALTY]);
+	WRITE("Class_Offshore_Penalty",     r[HH_OFFSHORE_PENALTY]);
+	WRITE("Class_Audited_Count",        r[HH_IS_AUDITED]);
+	WRITE("Class_Flight_Count",         r[HH_DECISION_FLIGHT]);
+	WRITE("Class_Evasion_Count",        r[HH_DECISION_EVASION]);
+
+	// Write averages
+	WRITE("Class_Avg_Imports_Share",       (i > 0) ? r[HH_IMPORTS_SHARE] : 0);
+	WRITE("Class_Avg_Interest_Rate",       (i > 0) ? r[HH_INTEREST_RATE] : 0);
+	WRITE("Class_Avg_Max_Debt_Rate",       (i > 0) ? r[HH_MAX_DEBT_RATE] : 0);
+	WRITE("Class_Avg_Propensity_to_Spend", (i > 0) ? r[HH_PROPENSITY_TO_SPEND] : 0);
+	WRITE("Class_Avg_Savings_Rate",        (i > 0) ? r[HH_SAVINGS_RATE] : 0);
+	WRITE("Class_Avg_Debt_Rate",           (i > 0) ? r[HH_DEBT_RATE] : 0);
+	WRITE("Class_Avg_Reference_Income",    (i > 0) ? r[HH_REFERENCE_INCOME] : 0);
 
 RESULT(employed)
 
@@ -98,6 +98,9 @@ FORMULA:
 SKILL MODULATION:
 - High-skill workers are more likely to be hired (skill attracts, capped at 2×)
 - High-skill workers are less likely to be fired (skill protects, floor at 0.5)
+
+Hire/fire draws use the household's own counter-based stream (RND_CTR), so they
+do not depend on evaluation order and can be computed in parallel.
 */
 v[0] = V("household_type");
 if(v[0] == 1)  // Capitalist - not in labor market
@@ -137,7 +140,7 @@ else  // Worker
         v[12] = v[6] * (1.0 + v[8] * max(0.0, v[5])) * min(2.0, v[11]);
         v[12] = min(0.50, max(0.0, v[12]));  // Cap at 50%
 
-        if(RND < v[12])
+        if(RND_CTR < v[12])
             v[10] = 1;  // Hired
         else
             v[10] = 0;  // Stay unemployed
@@ -148,7 +151,7 @@ else  // Worker
         v[13] = v[7] * (1.0 + v[9] * max(0.0, -v[5])) / max(0.5, v[11]);
         v[13] = min(0.20, max(0.0, v[13]));  // Cap at 20% (institutional friction)
 
-        if(RND < v[13])
+        if(RND_CTR < v[13])
             v[10] = 0;  // Fired
         else
             v[10] = 1;  // Stay employed
@@ -249,7 +252,7 @@ else
 RESULT(v[3])
 
 
-EQUATION("Household_Unemployment_Benefits")
+EQUATION_BATCH("Household_Unemployment_Benefits")
 /*
 Stage 5.2: Unemployment benefits for unemployed workers.
 SFC-CORRECT: Benefits come from Government_Effective_Unemployment_Benefits,
@@ -262,32 +265,26 @@ distributed equally among all unemployed worker households.
 This maintains Stock-Flow Consistency: money flows Government → Households.
 Government budget constraint limits total benefits payable.
 
+Batch equation: computed at once for all households, so the government
+and country totals are fetched a single time.
+
 Reference: target model fun_households.h lines 935-951
 */
-v[0] = V("household_type");
-if(v[0] == 1)  // Capitalist - no benefits
-{
-    v[4] = 0;
-}
-else  // Worker
-{
-    v[1] = V("Household_Employment_Status");
-    if(v[1] == 1)  // Employed - no benefits
-    {
-        v[4] = 0;
-    }
-    else  // Unemployed - receives share of government benefits
-    {
-        // SFC-correct: Get total benefits from government budget
-        v[2] = VS(government, "Government_Effective_Unemployment_Benefits");
-        // Get count of unemployed workers
-        v[3] = VS(country, "Country_Unemployed_Households");
-        // Distribute equally among all unemployed
-        v[4] = (v[3] > 0) ? v[2] / v[3] : 0;
-    }
-}
+vector<double> type, status;
+BATCH_V("household_type", type);
+BATCH_V("Household_Employment_Status", status);
 
-RESULT(max(0, v[4]))
+// SFC-correct: Get total benefits from government budget
+v[2] = VS(government, "Government_Effective_Unemployment_Benefits");
+// Get count of unemployed workers
+v[3] = VS(country, "Country_Unemployed_Households");
+// Distribute equally among all unemployed
+v[4] = max(0, (v[3] > 0) ? v[2] / v[3] : 0);
+
+CYCLE_BATCH(i)
+    BATCH_RES(i) = (type[i] == 1 || status[i] == 1) ? 0 : v[4];  // Capitalist or employed - no benefits
+
+RESULT_BATCH
 
 
 /******************************************************************************
@@ -532,7 +529,7 @@ EQUATION("Household_Income_Percentile")
 Stage 7 OPTIMIZED: True rank-based percentile in [0, 1].
 
 Value is written annually by Country_Inequality_Master via WRITES() using
-a full argsort of Household_Avg_Real_Income. This replaces the old biased
+the rank in its Household_Avg_Real_Income distribution index. This replaces the old biased
 proxy (x/(1+x)) which compressed all households near 0.5.
 
 This equation triggers the master if not yet computed this period, then
@@ -1587,9 +1584,10 @@ EQUATION("Household_Is_Audited")
 /*
 Stage 9: Stochastic audit outcome. Applies to BOTH asset evasion and offshore deposits.
 Uses dynamic audit probability when enforcement_sensitivity > 0.
+Order-free draw from the household's counter-based stream (RND_CTR).
 */
 v[0] = VS(government, "Government_Dynamic_Audit_Probability");
-RESULT(RND < v[0] ? 1 : 0)
+RESULT(RND_CTR < v[0] ? 1 : 0)
 
 
 EQUATION("Household_Asset_Penalty")
@@ -10,10 +10,15 @@ There are some underlying hypothesis:
 1-Income classes are never credit rationed and receive loans first.
 2-A bank has a total amount of loans it can provide. After discounting the amount for the income classes, it distribute proportionally to each sector
 3-Within each sector, it provides in a order of debt rate. High indebtedness firms migh not receive loans.
+Single pass: firms are sorted once and bucketed by (sector, bank) in the sector order, so each bank only visits its clients.
 */
 
 v[0]=SUM("Firm_Demand_Loans");						//total demand of firm loans
 v[12]=V("Country_Total_Household_Demand_Loans");				// household loan demand (pre-computed)
+v[11]=V("switch_creditworthness");
+
+vector<double> sec_dem;								//sector demand of loans
+vector<unordered_map<double, vector<object*>>> clients;	//firms of each sector by bank id, in sector order
 
 CYCLE(cur, "BANKS")
 {
@@ -21,47 +26,49 @@ CYCLE(cur, "BANKS")
 	v[2]=VS(cur, "bank_id");
 	v[13]=VS(cur, "Bank_Market_Share");
 	v[14]=v[13]*v[12];
+
+	if(clients.empty())								//sort and bucket the firms only once
+	{
+		if(v[11]==1)
+			SORTS(root, "FIRMS", "Firm_Avg_Debt_Rate", "UP");
+		if(v[11]==2)
+			SORTS(root, "FIRMS", "firm_date_birth", "UP");
+		if(v[11]==3)
+			SORTS(root, "FIRMS", "firm_date_birth", "DOWN");
+
+		CYCLES(root, cur1, "SECTORS")
+		{
+			sec_dem.push_back(SUMS(cur1, "Firm_Demand_Loans"));
+			clients.emplace_back();
+			CYCLES(cur1, cur2, "FIRMS")
+				clients.back()[VS(cur2, "firm_bank")].push_back(cur2);
+		}
+	}
+
 	v[10]=0;
-	CYCLES(root, cur1, "SECTORS")
+	for(i=0; i<(int)clients.size(); ++i)
 	{
-		v[3]=SUMS(cur1, "Firm_Demand_Loans");			//sector demand of loans
 		if(v[0]!=0)
-			v[4]=v[3]/v[0];								//sector share of demand
+			v[4]=sec_dem[i]/v[0];							//sector share of demand
 		else
 			v[4]=0;
-		
-		v[5]=max(0,(v[1]-v[14])*v[4]);
-		v[11]=V("switch_creditworthness");
-				
-			v[9]=0;
-			if(v[11]==1)
-				SORTS(root, "FIRMS", "Firm_Avg_Debt_Rate", "UP");
-			if(v[11]==2)
-				SORTS(root, "FIRMS", "firm_date_birth", "UP");
-			if(v[11]==3)
-				SORTS(root, "FIRMS", "firm_date_birth", "DOWN");
-			CYCLES(cur1, cur2, "FIRMS")
-			{
-				v[6]=VS(cur2, "firm_bank");
-					if (v[6]==v[2])
-					{
-						v[7]=VS(cur2, "Firm_Demand_Loans");
-						if (v[5]>=v[7])
-							v[8]=v[7];
-						else
-							v[8]=max(0, v[5]);
-						v[5]=v[5]-v[8];
-						WRITES(cur2, "firm_effective_loans", v[8]);
-						v[9]=v[9]+1;
-					}
-					else
-					{
-						v[5]=v[5];
-						v[9]=v[9];
-					}		
-			}
-
-	v[10]=v[10]+v[9];
+
+		v[5]=max(0,(v[1]-v[14])*v[4]);				//bank supply to the sector, rationed in order
+		auto it=clients[i].find(v[2]);
+		if(it==clients[i].end())
+			continue;
+
+		for(object *firm : it->second)
+		{
+			v[7]=VS(firm, "Firm_Demand_Loans");
+			if (v[5]>=v[7])
+				v[8]=v[7];
+			else
+				v[8]=max(0, v[5]);
+			v[5]=v[5]-v[8];
+			WRITES(firm, "firm_effective_loans", v[8]);
+		}
+		v[10]=v[10]+it->second.size();
 	}
 WRITES(cur, "Bank_Number_Clients", v[10]);
 }	
@@ -1037,11 +1044,13 @@ RESULT((v[1] > 0.001) ? v[0] / v[1] : 0)
 
 EQUATION("Country_Inequality_Master")
 /*
-Stage 7 UNIFIED ANNUAL MASTER: Single CYCLE fills all 5 arrays, 4-5 sorts compute
-all inequality indices, argsort provides median + transfer threshold + true HH ranks.
+Stage 7 UNIFIED ANNUAL MASTER: Single CYCLE updates 5 persistent distribution
+indexes (dist_index, order-statistics trees): only households whose value changed
+are moved, O(log N) each. Gini, shares, median, transfer threshold and true HH
+ranks are then O(log N) queries — no copies, no sorts. Cheap enough to set
+annual_frequency = 1 and compute every period.
 
 Replaces: 4 separate annual Gini CYCLEs + 1 per-period median CYCLE + per-HH proxy.
-Performance: ~2125 fewer O(N) operations per 500-step run vs old approach.
 
 Writes (all via WRITE/WRITES):
   - Country_Gini_Index + 4 sub-indices (post-tax income)
@@ -1088,70 +1097,57 @@ if(do_compute)
 	}
 	else
 	{
-		// --- Step 2: Static buffers (amortized allocation) ---
-		struct RankEntry { double val; object* ptr; };
-		static double*    vals_disp  = nullptr;  // Household_Nominal_Disposable_Income
-		static double*    vals_gross = nullptr;  // Household_Nominal_Gross_Income
-		static double*    vals_wpost = nullptr;  // Household_Net_Wealth
-		static double*    vals_wpre  = nullptr;  // Household_Net_Wealth + Wealth_Tax_Payment
-		static RankEntry* rank_arr   = nullptr;  // lagged avg income + ptr (for argsort)
-		static int buf_n = 0;
-
-		if(i > buf_n)
+		// --- Step 2: Persistent distribution indexes (updated incrementally) ---
+		static dist_index idx_disp;   // Household_Nominal_Disposable_Income
+		static dist_index idx_gross;  // Household_Nominal_Gross_Income
+		static dist_index idx_wpost;  // Household_Net_Wealth
+		static dist_index idx_wpre;   // Household_Net_Wealth + Wealth_Tax_Payment
+		static dist_index idx_avg;    // lagged avg income (median + threshold + HH rank)
+		static vector<o_pairT> ranked;
+		static int idx_t = 0;         // time of last computation (new run if not before t)
+
+		// start empty at the first computation of each run
+		if(t <= idx_t)
 		{
-			delete[] vals_disp;  delete[] vals_gross;
-			delete[] vals_wpost; delete[] vals_wpre;
-			delete[] rank_arr;
-			int new_n = i * 2;
-			vals_disp  = new double[new_n];
-			vals_gross = new double[new_n];
-			vals_wpost = new double[new_n];
-			vals_wpre  = new double[new_n];
-			rank_arr   = new RankEntry[new_n];
-			buf_n = new_n;
+			idx_disp.clear(); idx_gross.clear(); idx_wpost.clear(); idx_wpre.clear(); idx_avg.clear();
+			ranked.clear();
 		}
+		idx_t = t;
+
+		v[5] = V("switch_class_tax_structure");
+		v[6] = V("wealth_tax_rate");
 
-		// --- Step 3: Single CYCLE — fill all 5 arrays simultaneously ---
-		double tot_disp = 0, tot_wpost = 0;
-		j = 0;
+		// --- Step 3: Single CYCLE — move only households whose values changed ---
+		idx_disp.mark(); idx_gross.mark(); idx_wpost.mark(); idx_wpre.mark(); idx_avg.mark();
 		CYCLE(cur1, "CLASSES")
 		{
 		CYCLES(cur1, cur, "HOUSEHOLD")
 		{
-			double yd   = VLS(cur, "Household_Nominal_Disposable_Income", 1);
-			double yg   = VLS(cur, "Household_Nominal_Gross_Income", 1);
-			double w    = VLS(cur, "Household_Net_Wealth", 1);
-			double wtax = VS(cur, "Household_Wealth_Tax_Payment");
-			double ya   = VLS(cur, "Household_Avg_Real_Income", 1);
-			vals_disp[j]    = yd;    tot_disp  += yd;
-			vals_gross[j]   = yg;
-			vals_wpost[j]   = w;     tot_wpost += w;
-			vals_wpre[j]    = w + wtax;
-			rank_arr[j].val = ya;
-			rank_arr[j].ptr = cur;
-			j++;
+			double w = VLS(cur, "Household_Net_Wealth", 1);
+			idx_disp.update(cur, VLS(cur, "Household_Nominal_Disposable_Income", 1));
+			idx_wpost.update(cur, w);
+			idx_avg.update(cur, VLS(cur, "Household_Avg_Real_Income", 1));
+			if(v[5] >= 5)
+				idx_gross.update(cur, VLS(cur, "Household_Nominal_Gross_Income", 1));
+			if(v[6] > 0)
+				idx_wpre.update(cur, w + VS(cur, "Household_Wealth_Tax_Payment"));
 		}
 		}
+		// drop households that left the economy since last computation
+		idx_disp.sweep(); idx_gross.sweep(); idx_wpost.sweep(); idx_wpre.sweep(); idx_avg.sweep();
 
-		// --- Gini+shares helper lambda (reused across 4 sort passes) ---
-		auto gini_and_shares = [&](double* arr, int n, double total,
+		// --- Gini+shares helper lambda (O(log N) queries on the index) ---
+		auto gini_and_shares = [&](dist_index& d,
 			const char* gini_nm, const char* palma_nm,
 			const char* t10_nm, const char* t1_nm, const char* b50_nm)
 		{
-			// arr must already be sorted ascending
-			double sum_ix = 0, sum_x = 0;
+			int n = d.size();
+			double total = d.total();
 			int b40 = (int)(n * 0.40), b50 = (int)(n * 0.50);
 			int t10 = (int)(n * 0.90), t1  = min((int)(n * 0.99), n - 1);
-			double s_b40 = 0, s_b50 = 0, s_t10 = 0, s_t1 = 0;
-			for(int k = 0; k < n; k++) {
-				sum_ix += (k + 1) * arr[k];
-				sum_x  += arr[k];
-				if(k < b40) s_b40 += arr[k];
-				if(k < b50) s_b50 += arr[k];
-				if(k >= t10) s_t10 += arr[k];
-				if(k >= t1)  s_t1  += arr[k];
-			}
-			double g = (sum_x > 1e-10) ? (2.0 * sum_ix - (n + 1) * sum_x) / (n * sum_x) : 0;
+			double s_b40 = d.sum_below(b40), s_b50 = d.sum_below(b50);
+			double s_t10 = total - d.sum_below(t10), s_t1 = total - d.sum_below(t1);
+			double g = d.gini();
 			WRITE(gini_nm,  g);
 			WRITE(palma_nm, (fabs(s_b40) > 1e-10) ? s_t10 / s_b40 : 9999);
 			WRITE(t10_nm,   (total > 1e-10) ? s_t10 / total : 0);
@@ -1160,41 +1156,28 @@ if(do_compute)
 			return g;
 		};
 
-		// --- Step 5: Sort 1 — post-tax disposable income Gini ---
-		std::sort(vals_disp, vals_disp + i);
-		gini_and_shares(vals_disp, i, tot_disp,
+		// --- Step 5: post-tax disposable income Gini ---
+		gini_and_shares(idx_disp,
 			"Country_Gini_Index", "Country_Palma_Ratio_Income",
 			"Country_Top10_Share_Income", "Country_Top1_Share_Income",
 			"Country_Bottom50_Share_Income");
 
-		// --- Step 6: Sort 2 — pre-tax income Gini ---
-		v[5] = V("switch_class_tax_structure");
+		// --- Step 6: pre-tax income Gini ---
 		if(v[5] < 5)
 			WRITE("Country_Gini_Index_Pretax", V("Country_Gini_Index")); // proportional: scale-invariant
 		else
-		{
-			std::sort(vals_gross, vals_gross + i);
-			double sum_ix2 = 0, sum_x2 = 0;
-			for(int k = 0; k < i; k++) {
-				sum_ix2 += (k + 1) * vals_gross[k];
-				sum_x2  += vals_gross[k];
-			}
-			WRITE("Country_Gini_Index_Pretax",
-				(sum_x2 > 1e-10) ? (2.0 * sum_ix2 - (i + 1) * sum_x2) / (i * sum_x2) : 0);
-		}
+			WRITE("Country_Gini_Index_Pretax", idx_gross.gini());
 
-		// --- Step 7: Sort 3 — post-tax net wealth Gini ---
-		std::sort(vals_wpost, vals_wpost + i);
-		gini_and_shares(vals_wpost, i, tot_wpost,
+		// --- Step 7: post-tax net wealth Gini ---
+		gini_and_shares(idx_wpost,
 			"Country_Gini_Index_Wealth", "Country_Palma_Ratio_Wealth",
 			"Country_Top10_Share_Wealth", "Country_Top1_Share_Wealth",
 			"Country_Bottom50_Share_Wealth");
 
-		// --- Step 8: Sort 4 — pre-tax wealth Gini ---
-		v[6] = V("wealth_tax_rate");
+		// --- Step 8: pre-tax wealth Gini ---
 		if(v[6] <= 0)
 		{
-			// No wealth tax: pre-tax = post-tax, skip sort
+			// No wealth tax: pre-tax = post-tax
 			WRITE("Country_Gini_Index_Wealth_Pretax",      V("Country_Gini_Index_Wealth"));
 			WRITE("Country_Palma_Ratio_Wealth_Pretax",     V("Country_Palma_Ratio_Wealth"));
 			WRITE("Country_Top10_Share_Wealth_Pretax",     V("Country_Top10_Share_Wealth"));
@@ -1202,35 +1185,30 @@ if(do_compute)
 			WRITE("Country_Bottom50_Share_Wealth_Pretax",  V("Country_Bottom50_Share_Wealth"));
 		}
 		else
-		{
-			double tot_wpre = 0;
-			for(int k = 0; k < i; k++) tot_wpre += vals_wpre[k];
-			std::sort(vals_wpre, vals_wpre + i);
-			gini_and_shares(vals_wpre, i, tot_wpre,
+			gini_and_shares(idx_wpre,
 				"Country_Gini_Index_Wealth_Pretax", "Country_Palma_Ratio_Wealth_Pretax",
 				"Country_Top10_Share_Wealth_Pretax", "Country_Top1_Share_Wealth_Pretax",
 				"Country_Bottom50_Share_Wealth_Pretax");
-		}
 
-		// --- Step 9: Sort 5 — avg income argsort → median + threshold + HH rank ---
-		std::sort(rank_arr, rank_arr + i,
-			[](const RankEntry& a, const RankEntry& b){ return a.val < b.val; });
+		// --- Step 9: avg income order statistics → median + threshold + HH rank ---
+		i = idx_avg.size();
 
 		// Median (interpolated midpoint)
 		double median_val = (i % 2 == 0)
-			? 0.5 * (rank_arr[i/2 - 1].val + rank_arr[i/2].val)
-			: rank_arr[i/2].val;
+			? 0.5 * (idx_avg.select(i/2 - 1) + idx_avg.select(i/2))
+			: idx_avg.select(i/2);
 		WRITE("Country_Median_Household_Income", max(0.01, median_val));
 
 		// Transfer threshold (percentile set by parameter)
 		v[7] = V("wealth_transfer_target_percentile");
 		if(v[7] <= 0 || v[7] > 1) v[7] = 0.5;
 		int thresh_idx = (int)((i - 1) * v[7]);
-		WRITE("Country_Transfer_Income_Threshold", rank_arr[thresh_idx].val);
+		WRITE("Country_Transfer_Income_Threshold", idx_avg.select(thresh_idx));
 
-		// True rank-based percentile for each household (replaces biased proxy)
+		// True rank-based percentile for each household (in-order walk, no sort)
+		idx_avg.sorted(ranked);
 		for(int k = 0; k < i; k++)
-			WRITES(rank_arr[k].ptr, "Household_Income_Percentile",
+			WRITES(ranked[k].second, "Household_Income_Percentile",
 				   (i > 1) ? (double)k / (i - 1) : 0.5);
 	}
 }
@@ -38,6 +38,41 @@ object *households;
 object *working_class;     // CLASS for workers (class_id=0)
 object *capitalist_class;  // CLASS for capitalists (class_id=1)
 
+// Set the global pointers: called by Initialization_2 and again after
+// resuming a run from a checkpoint (-y), when it is not computed
+void set_global_pointers(void)
+{
+	object *p = root;
+
+	consumption=SEARCH_CND("id_consumption_goods_sector",1);
+	capital=SEARCH_CND("id_capital_goods_sector",1);
+	input=SEARCH_CND("id_intermediate_goods_sector",1);
+	government=SEARCH("GOVERNMENT");
+	financial=SEARCH("FINANCIAL");
+	external=SEARCH("EXTERNAL_SECTOR");
+	country=SEARCH("COUNTRY");
+	centralbank=SEARCH("CENTRAL_BANK");
+
+	// NOTE: aclass, bclass, cclass searches removed (Stage 5.5 CLASS removal)
+	// All consumption now driven by HOUSEHOLD objects
+
+	// Phase 1: Initialize household pointers
+	// Structure: COUNTRY → CLASSES (workers/capitalists) → HOUSEHOLD
+	// (Mirrors: COUNTRY → SECTORS → FIRMS)
+	//
+	// Pointers:
+	//   households       → country (common ancestor, for SUMS across all households)
+	//   working_class    → CLASSES instance with class_id=0
+	//   capitalist_class → CLASSES instance with class_id=1
+	households = country;  // Use country as search root for all household aggregations
+
+	// Initialize individual CLASS pointers for direct access
+	working_class = SEARCH_CND("class_id", 0);     // class_id=0 → workers
+	capitalist_class = SEARCH_CND("class_id", 1);  // class_id=1 → capitalists
+}
+
+RESTORE_SIM(set_global_pointers);
+
 #include "fun_diagnostics.h"        				// Diagnostic System (helper functions - needs global pointers)
 
 MODELBEGIN
@@ -32,11 +32,9 @@ EXAMPLE 2: LAG_SUM(p, "X", 3, 2) will return VL("X",2) + VL("X",3) + VL("X",4).
 */
 double LAG_SUM( object *obj , const char *var , int lag = 0, int lag2 = 0)
 {
-	double x = 0;
-	int i;
-	for(i=lag2; i<=lag2+lag-1; i++)
-		x = x + VLS( obj, var, i);
-	return x;
+	// uses the variable rolling window, if set by USE_WINDOW(var, lag),
+	// which may change the result in the last bits (see set_window)
+	return obj->lag_sum( var, lag, lag2 );
 }
 
 /*
@@ -48,11 +46,9 @@ EXAMPLE 2: LAG_AVE(p, "X", 3, 2) will return (VL("X",2) + VL("X",3) + VL("X",4))
 */
 double LAG_AVE( object *obj , const char *var , int lag = 0, int lag2 = 0)
 {
-	double x = 0;
-	int i;
-	for(i=lag2; i<=lag2+lag-1; i++)
-		x = x + VLS( obj, var, i);
-	return x/lag;
+	// uses the variable rolling window, if set by USE_WINDOW(var, lag),
+	// which may change the result in the last bits (see set_window)
+	return obj->lag_sum( var, lag, lag2 ) / lag;
 }
 
 /*
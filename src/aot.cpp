@@ -0,0 +1,846 @@
+/*************************************************************
+
+	LSD 8.0 - May 2022
+	written by Marco Valente, Universita' dell'Aquila
+	and by Marcelo Pereira, University of Campinas
+
+	Copyright Marco Valente and Marcelo Pereira
+	LSD is distributed under the GNU General Public License
+
+	See Readme.txt for copyright information of
+	third parties' code used in LSD
+
+ *************************************************************/
+
+/*************************************************************
+AOT.CPP
+Ahead-of-time model compiler, a stand-alone tool run by the 'aot'
+target of makefile-NW before compiling the no-window version.
+
+It reads the model structure from a configuration file and the model
+equation file (including the local equation files it includes), and
+writes a new equation file where each equation is a static free
+function, registered in the equation map at start-up (MODEL_AOT), so:
+
+- only the temporary variables (v[], i, cur, curl...) an equation
+  uses, directly or through macros, are declared (v[] always with its
+  full USER_D_VARS size, as indexes may be computed);
+
+- V/VL/VS/VLS requests for a literal label of an element of the model
+  structure become V_ID/VL_ID/VS_ID/VLS_ID, resolving the label only
+  once for each call site instead of hashing it at every call, so each
+  request is an array index in the variables slots of the object type;
+  labels missing in the structure are reported and left untouched;
+
+- EQUATION_BATCH bodies become free functions called by cal_batch,
+  and EQUATION_DUMMY keep their standard form.
+
+#line directives keep compiler messages and pointer-checking reports
+pointing to the original files and lines.
+
+The generated equations compute the same values, but the compiler may
+contract floating-point operations differently (into FMA instructions
+with -march=native), so results may differ in the last bits from the
+standard build, unless both are compiled with -ffp-contract=off.
+
+Usage: lsdAOT [-i LSD_SRC_DIR] MODEL.cpp CONFIGURATION.lsd OUTPUT.cpp
+*************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+enum { T_END, T_ID, T_NUM, T_STR, T_DIR, T_PUNCT };
+
+struct token
+{
+	int type;
+	size_t pos, len;
+};
+
+struct source							// file loaded in memory
+{
+	string name;
+	string text;
+	vector < size_t > lines;			// position of each line start
+
+	int line( size_t pos ) const
+	{ return upper_bound( lines.begin( ), lines.end( ), pos ) - lines.begin( ); };
+};
+
+struct usage							// elements used by a piece of code
+{
+	set < string > ids;					// identifiers
+	vector < size_t > binds;			// end of V... identifiers to bind
+
+	void merge( const usage &u )
+	{ ids.insert( u.ids.begin( ), u.ids.end( ) ); };
+};
+
+struct macro_def						// preprocessor macro definition
+{
+	string body;
+	set < string > params;
+};
+
+const char *locals[ ] = { "h", "i", "j", "k", "cur", "cur1", "cur2", "cur3", "cur4", "cur5", "cur6", "cur7", "cur8", "cur9", "cyccur", "cyccur2", "cyccur3", "curl", "curl1", "curl2", "curl3", "curl4", "curl5", "curl6", "curl7", "curl8", "curl9", "f" };
+const char *no_expand[ ] = { "DEBUG_CODE", "EQ_BEGIN", "INIT_POINTERS" };
+
+int n_eqs = 0, n_look = 0, n_bound = 0, n_warn = 0;
+map < string, source * > files;			// loaded files by name
+map < string, int > eq_names;			// function names used
+multimap < string, macro_def > macros;	// macros in model and LSD headers
+set < string > elements;				// elements in model structure
+set < string > variables;				// variables/functions in model structure
+string model_dir;
+
+
+/***************************************************
+LOAD
+Read a file in memory, once
+****************************************************/
+source *load( const string &name, bool dir = true )
+{
+	auto it = files.find( name );
+	if ( it != files.end( ) )
+		return it->second;
+
+	ifstream in( dir ? model_dir + name : name );
+	if ( ! in )
+		return NULL;
+
+	stringstream buf;
+	buf << in.rdbuf( );
+
+	source *src = new source;
+	src->name = name;
+	src->text = buf.str( );
+	src->lines.push_back( 0 );
+	for ( size_t i = 0; i < src->text.size( ); ++i )
+		if ( src->text[ i ] == '\n' )
+			src->lines.push_back( i + 1 );
+
+	files[ name ] = src;
+	return src;
+}
+
+
+/***************************************************
+NEXT_TOKEN
+Get the next token of C++ code from pos, skipping
+white space and comments
+****************************************************/
+token next_token( const string &s, size_t pos, size_t end )
+{
+	size_t i, e;
+	token tok;
+
+	while ( pos < end )
+	{
+		if ( isspace( s[ pos ] ) )
+			++pos;
+		else
+			if ( s.compare( pos, 2, "//" ) == 0 )
+			{
+				e = s.find( '\n', pos );
+				pos = ( e == string::npos ) ? end : e;
+			}
+			else
+				if ( s.compare( pos, 2, "/*" ) == 0 )
+				{
+					e = s.find( "*/", pos + 2 );
+					pos = ( e == string::npos ) ? end : e + 2;
+				}
+				else
+					break;
+	}
+
+	tok.pos = pos;
+	tok.len = 0;
+
+	if ( pos >= end )
+	{
+		tok.type = T_END;
+		return tok;
+	}
+
+	char ch = s[ pos ];
+
+	if ( ch == '#' )					// directive, if first in line
+	{
+		for ( i = pos; i > 0 && ( s[ i - 1 ] == ' ' || s[ i - 1 ] == '\t' ); --i );
+
+		if ( i == 0 || s[ i - 1 ] == '\n' )
+		{
+			for ( e = pos; e < end && ( s[ e ] != '\n' || s[ e - 1 ] == '\\' ); ++e );
+			tok.type = T_DIR;
+			tok.len = e - pos;
+			return tok;
+		}
+	}
+
+	if ( ch == '"' || ( ch == '\'' && ( pos == 0 || ! isalnum( s[ pos - 1 ] ) ) ) )
+	{
+		for ( i = pos + 1; i < end && s[ i ] != ch; ++i )
+			if ( s[ i ] == '\\' )
+				++i;
+
+		tok.type = T_STR;
+		tok.len = min( i + 1, end ) - pos;
+		return tok;
+	}
+
+	if ( isalpha( ch ) || ch == '_' || isdigit( ch ) )
+	{
+		for ( i = pos + 1; i < end && ( isalnum( s[ i ] ) || s[ i ] == '_' || ( isdigit( ch ) && ( s[ i ] == '.' || s[ i ] == '\'' ) ) ); ++i );
+		tok.type = isdigit( ch ) ? T_NUM : T_ID;
+		tok.len = i - pos;
+		return tok;
+	}
+
+	tok.type = T_PUNCT;
+	tok.len = 1;
+	return tok;
+}
+
+
+/***************************************************
+PARSE_ARGS
+Split the macro arguments between the parenthesis
+at open, returning the closing parenthesis position
+****************************************************/
+size_t parse_args( const string &s, size_t open, size_t end, vector < size_t > &from, vector < size_t > &to )
+{
+	int depth = 0;
+	token tok;
+
+	from.clear( );
+	to.clear( );
+
+	for ( size_t pos = open; ; pos = tok.pos + tok.len )
+	{
+		tok = next_token( s, pos, end );
+
+		if ( tok.type == T_END )
+			return string::npos;
+
+		if ( tok.type != T_PUNCT )
+			continue;
+
+		char ch = s[ tok.pos ];
+
+		if ( ch == '(' || ch == '[' || ch == '{' )
+		{
+			if ( depth++ == 0 )
+				from.push_back( tok.pos + 1 );
+		}
+		else
+			if ( ch == ')' || ch == ']' || ch == '}' )
+			{
+				if ( --depth == 0 )
+				{
+					to.push_back( tok.pos );
+					return tok.pos;
+				}
+			}
+			else
+				if ( ch == ',' && depth == 1 )
+				{
+					to.push_back( tok.pos );
+					from.push_back( tok.pos + 1 );
+				}
+	}
+}
+
+
+/***************************************************
+LITERAL
+Return the content of an argument made only of a
+string literal, or an empty string otherwise
+****************************************************/
+string literal( const string &s, size_t from, size_t to )
+{
+	token tok = next_token( s, from, to );
+
+	if ( tok.type != T_STR || s[ tok.pos ] != '"' || next_token( s, tok.pos + tok.len, to ).type != T_END )
+		return "";
+
+	return s.substr( tok.pos + 1, tok.len - 2 );
+}
+
+
+/***************************************************
+SCAN_CODE
+Scan the code from pos, collecting the identifiers
+and (if src is set) the element requests to bind,
+until identifier term is found at the top level or
+end is reached
+****************************************************/
+size_t scan_code( const string &s, size_t pos, size_t end, const char *term, usage &u, const source *src = NULL )
+{
+	int depth = 0, arg;
+	token tok, next;
+	vector < size_t > from, to;
+
+	for ( ; ; pos = tok.pos + tok.len )
+	{
+		tok = next_token( s, pos, end );
+
+		if ( tok.type == T_END )
+			return end;
+
+		if ( tok.type == T_PUNCT )
+		{
+			if ( s[ tok.pos ] == '{' )
+				++depth;
+			else
+				if ( s[ tok.pos ] == '}' )
+					--depth;
+			continue;
+		}
+
+		if ( tok.type != T_ID )
+			continue;
+
+		string id = s.substr( tok.pos, tok.len );
+
+		if ( term != NULL && depth == 0 && id == term )
+			return tok.pos;
+
+		u.ids.insert( id );
+
+		if ( id == "v" )
+			continue;
+
+		if ( src == NULL )
+			continue;
+
+		if ( id == "V" || id == "VL" )
+			arg = 0;
+		else
+			if ( id == "VS" || id == "VLS" )
+				arg = 1;
+			else
+				continue;
+
+		next = next_token( s, tok.pos + tok.len, end );
+		if ( next.type != T_PUNCT || s[ next.pos ] != '(' || parse_args( s, next.pos, end, from, to ) == string::npos || ( int ) from.size( ) <= arg )
+			continue;
+
+		string lab = literal( s, from[ arg ], to[ arg ] );
+		if ( lab.empty( ) )
+			continue;
+
+		++n_look;
+
+		if ( elements.count( lab ) == 0 )
+		{
+			fprintf( stderr, "%s:%d: warning: element '%s' is not in the model structure\n", src->name.c_str( ), src->line( tok.pos ), lab.c_str( ) );
+			++n_warn;
+			continue;
+		}
+
+		u.binds.push_back( tok.pos + tok.len );
+		++n_bound;
+	}
+}
+
+
+/***************************************************
+READ_MACROS
+Collect the macro definitions in a file
+****************************************************/
+void read_macros( const source *src )
+{
+	size_t i, pos;
+	token tok;
+	macro_def def;
+	vector < size_t > from, to;
+	const string &s = src->text;
+
+	for ( pos = 0; ; pos = tok.pos + tok.len )
+	{
+		tok = next_token( s, pos, s.size( ) );
+
+		if ( tok.type == T_END )
+			return;
+
+		if ( tok.type != T_DIR )
+			continue;
+
+		size_t end = tok.pos + tok.len;
+		token cmd = next_token( s, tok.pos + 1, end );
+		if ( cmd.type != T_ID || s.compare( cmd.pos, cmd.len, "define" ) != 0 )
+			continue;
+
+		token name = next_token( s, cmd.pos + cmd.len, end );
+		if ( name.type != T_ID )
+			continue;
+
+		i = name.pos + name.len;
+		def.params.clear( );
+
+		if ( i < end && s[ i ] == '(' )	// function-like macro
+		{
+			if ( ( i = parse_args( s, i, end, from, to ) ) == string::npos )
+				continue;
+
+			for ( size_t j = 0; j < from.size( ); ++j )
+			{
+				token par = next_token( s, from[ j ], to[ j ] );
+				if ( par.type == T_ID )
+					def.params.insert( s.substr( par.pos, par.len ) );
+			}
+
+			++i;
+		}
+
+		def.body = s.substr( i, end - i );
+		macros.insert( make_pair( s.substr( name.pos, name.len ), def ) );
+	}
+}
+
+
+/***************************************************
+INCLUDED
+Load the local file included by a directive, if any
+****************************************************/
+source *included( const string &dir )
+{
+	size_t q1 = dir.find( '"' ), q2 = dir.rfind( '"' );
+	token cmd = next_token( dir, 1, dir.size( ) );
+
+	if ( cmd.type != T_ID || dir.compare( cmd.pos, cmd.len, "include" ) != 0 || q1 == q2 )
+		return NULL;
+
+	return load( dir.substr( q1 + 1, q2 - q1 - 1 ) );
+}
+
+
+/***************************************************
+READ_MODEL
+Collect the macro definitions in a model file and
+in the local files it includes, recursively
+****************************************************/
+void read_model( const source *src, set < const source * > &done )
+{
+	token tok;
+	source *inc;
+	const string &s = src->text;
+
+	if ( ! done.insert( src ).second )
+		return;
+
+	read_macros( src );
+
+	for ( size_t pos = 0; ; pos = tok.pos + tok.len )
+	{
+		tok = next_token( s, pos, s.size( ) );
+
+		if ( tok.type == T_END )
+			return;
+
+		if ( tok.type == T_DIR && ( inc = included( s.substr( tok.pos, tok.len ) ) ) != NULL )
+			read_model( inc, done );
+	}
+}
+
+
+/***************************************************
+EXPAND_MACROS
+Add the usage of the macros used by the code,
+recursively
+****************************************************/
+void expand_macros( usage &u )
+{
+	set < string > done( no_expand, no_expand + sizeof( no_expand ) / sizeof( no_expand[ 0 ] ) );
+	vector < string > todo( u.ids.begin( ), u.ids.end( ) );
+
+	todo.push_back( "EQ_USER_VARS" );
+
+	while ( ! todo.empty( ) )
+	{
+		string id = todo.back( );
+		todo.pop_back( );
+
+		if ( ! done.insert( id ).second )
+			continue;
+
+		auto range = macros.equal_range( id );
+		for ( auto it = range.first; it != range.second; ++it )
+		{
+			usage mu;
+			scan_code( it->second.body, 0, it->second.body.size( ), NULL, mu );
+
+			for ( auto &par : it->second.params )
+				mu.ids.erase( par );
+
+			for ( auto &mid : mu.ids )
+				if ( done.count( mid ) == 0 )
+					todo.push_back( mid );
+
+			u.merge( mu );
+		}
+	}
+}
+
+
+/***************************************************
+COPY_BOUND
+Copy the code, binding the element requests
+****************************************************/
+void copy_bound( ostream &out, const string &s, size_t from, size_t to, const usage &u )
+{
+	for ( auto b : u.binds )
+		if ( b > from && b <= to )
+		{
+			out << s.substr( from, b - from ) << "_ID";
+			from = b;
+		}
+
+	out << s.substr( from, to - from );
+}
+
+
+/***************************************************
+DECLARE
+Write the declarations of the temporary variables
+used by an equation
+****************************************************/
+void declare( ostream &out, const usage &u )
+{
+	int i, n = sizeof( locals ) / sizeof( locals[ 0 ] );
+	string ints, objs, links, files;
+
+	for ( i = 0; i < n; ++i )
+		if ( u.ids.count( locals[ i ] ) )
+		{
+			string name = locals[ i ];
+
+			if ( name.size( ) == 1 && name != "f" )
+				ints += ( ints.empty( ) ? "" : ", " ) + name + " = 0";
+			else
+				if ( name.compare( 0, 4, "curl" ) == 0 )
+					links += ( links.empty( ) ? "*" : ", *" ) + name + " = NULL";
+				else
+					if ( name == "f" )
+						files = "*f = NULL";
+					else
+						objs += ( objs.empty( ) ? "*" : ", *" ) + name + " = NULL";
+		}
+
+	out << "\tdouble res = def_res;\n";
+	out << "\tobject *p = var->up, *c = caller;\n";
+
+	if ( ! ints.empty( ) )
+		out << "\tint " << ints << ";\n";
+
+	if ( u.ids.count( "v" ) > 0 )
+		out << "\tdouble v[ USER_D_VARS ];\n";
+
+	if ( ! objs.empty( ) )
+		out << "\tobject " << objs << ";\n";
+
+	if ( ! links.empty( ) )
+		out << "\tnetLink " << links << ";\n";
+
+	if ( ! files.empty( ) )
+		out << "\tFILE " << files << ";\n";
+
+	out << "\tEQ_USER_VARS\n";
+}
+
+
+/***************************************************
+EQUATION
+Compile one equation macro at pos to a free
+function, returning the position after it
+****************************************************/
+size_t equation( ostream &out, const source *src, const string &kind, size_t pos, size_t end )
+{
+	size_t close, body, term;
+	token tok;
+	usage u;
+	vector < size_t > from, to;
+	const string &s = src->text;
+	const char *file = src->name.c_str( );
+
+	tok = next_token( s, pos + kind.size( ), end );
+	if ( tok.type != T_PUNCT || s[ tok.pos ] != '(' || ( close = parse_args( s, tok.pos, end, from, to ) ) == string::npos )
+	{
+		fprintf( stderr, "%s:%d: error: invalid %s\n", file, src->line( pos ), kind.c_str( ) );
+		exit( 1 );
+	}
+
+	string args = s.substr( from[ 0 ], close - from[ 0 ] );
+	string lab = literal( s, from[ 0 ], to[ 0 ] );
+	if ( lab.empty( ) )
+	{
+		fprintf( stderr, "%s:%d: error: %s label must be a string literal\n", file, src->line( pos ), kind.c_str( ) );
+		exit( 1 );
+	}
+
+	if ( variables.count( lab ) == 0 )
+	{
+		fprintf( stderr, "%s:%d: warning: variable '%s' is not in the model structure\n", file, src->line( pos ), lab.c_str( ) );
+		++n_warn;
+	}
+
+	++n_eqs;
+	string name = "eq_" + lab;
+	if ( eq_names[ name ]++ > 0 )
+		name += "_" + to_string( eq_names[ name ] );
+
+	out << "#line " << src->line( pos ) << " \"" << file << "\"\n";
+
+	if ( kind == "EQUATION_DUMMY" )
+	{
+		out << "static bool " << name << "_reg = ( aot_eqs.insert( aot_eqs.end( ), { EQUATION_DUMMY( " << args << " ) } ), true );\n";
+		return close + 1;
+	}
+
+	bool batch = ( kind == "EQUATION_BATCH" );
+	body = close + 1;
+	term = scan_code( s, body, end, batch ? "RESULT_BATCH" : "RESULT", u, src );
+
+	if ( term >= end )
+	{
+		fprintf( stderr, "%s:%d: error: %s '%s' without %s\n", file, src->line( pos ), kind.c_str( ), lab.c_str( ), batch ? "RESULT_BATCH" : "RESULT" );
+		exit( 1 );
+	}
+
+	if ( batch )
+		close = term + strlen( "RESULT_BATCH" ) - 1;
+	else
+	{
+		tok = next_token( s, term + strlen( "RESULT" ), end );
+		if ( tok.type != T_PUNCT || s[ tok.pos ] != '(' || ( close = parse_args( s, tok.pos, end, from, to ) ) == string::npos || from.size( ) != 1 )
+		{
+			fprintf( stderr, "%s:%d: error: invalid RESULT\n", file, src->line( term ) );
+			exit( 1 );
+		}
+
+		scan_code( s, from[ 0 ], to[ 0 ], NULL, u, src );
+	}
+
+	expand_macros( u );
+
+	if ( batch )
+		out << "static void " << name << "_batch( object *caller, variable *var, o_vecT &batch_objs, vector < double > &batch_res )\n{\n";
+	else
+		out << "static double " << name << "( object *caller, variable *var )\n{\n";
+
+	declare( out, u );
+
+	out << "#line " << src->line( body ) << " \"" << file << "\"\n";
+	copy_bound( out, s, body, term, u );
+
+	if ( batch )
+		out << ";\n}\n\nstatic double " << name << "( object *caller, variable *var )\n{\n\treturn var->cal_batch( caller, " << name << "_batch );\n}\n";
+	else
+	{
+		out << "; res = ";
+		copy_bound( out, s, from[ 0 ], to[ 0 ], u );
+		out << ";\n\treturn res;\n}\n";
+	}
+
+	out << "static bool " << name << "_reg = aot_add( \"" << lab << "\", " << name << " );\n";
+
+	return close + 1;
+}
+
+
+/***************************************************
+REGION
+Compile the equations in the code from pos to end,
+following the local equation files included
+****************************************************/
+void region( ostream &out, const source *src, size_t pos, size_t end )
+{
+	token tok;
+	const string &s = src->text;
+
+	for ( ; ; )
+	{
+		tok = next_token( s, pos, end );
+		out << s.substr( pos, tok.pos - pos );	// white space and comments
+
+		if ( tok.type == T_END )
+			return;
+
+		string txt = s.substr( tok.pos, tok.len );
+
+		if ( tok.type == T_DIR )
+		{
+			const source *inc = included( txt );
+
+			if ( inc != NULL )
+			{
+				out << "// " << txt << "\n";
+				region( out, inc, 0, inc->text.size( ) );
+				out << "#line " << src->line( tok.pos + tok.len ) << " \"" << src->name << "\"\n";
+			}
+			else
+				out << txt;
+
+			pos = tok.pos + tok.len;
+			continue;
+		}
+
+		if ( tok.type == T_ID && ( txt == "EQUATION" || txt == "EQUATION_DUMMY" || txt == "EQUATION_BATCH" ) )
+		{
+			pos = equation( out, src, txt, tok.pos, end );
+			out << "#line " << src->line( pos ) << " \"" << src->name << "\"\n";
+			continue;
+		}
+
+		fprintf( stderr, "%s:%d: error: unexpected '%s' outside equations\n", src->name.c_str( ), src->line( tok.pos ), txt.c_str( ) );
+		exit( 1 );
+	}
+}
+
+
+/***************************************************
+READ_STRUCTURE
+Get the elements in the model structure of a
+configuration file
+****************************************************/
+bool read_structure( const char *name )
+{
+	string line, kind, lab;
+	ifstream in( name );
+
+	if ( ! in )
+		return false;
+
+	while ( getline( in, line ) && line.compare( 0, 4, "DATA" ) != 0 )
+	{
+		istringstream ls( line );
+		if ( ! ( ls >> kind >> lab ) )
+			continue;
+
+		if ( kind == "Var:" || kind == "Func:" || kind == "Param:" )
+			elements.insert( lab );
+
+		if ( kind == "Var:" || kind == "Func:" )
+			variables.insert( lab );
+	}
+
+	return ! elements.empty( );
+}
+
+
+/***************************************************
+MAIN
+****************************************************/
+int main( int argc, char *argv[ ] )
+{
+	int i = 1;
+	size_t begin, end;
+	string lsd_src;
+	source *model, *head;
+	token tok;
+
+	if ( argc > 2 && ! strcmp( argv[ 1 ], "-i" ) )
+	{
+		lsd_src = argv[ 2 ];
+		if ( ! lsd_src.empty( ) && lsd_src.back( ) != '/' )
+			lsd_src += '/';
+		i = 3;
+	}
+
+	if ( argc - i != 3 )
+	{
+		fprintf( stderr, "Usage: %s [-i LSD_SRC_DIR] MODEL.cpp CONFIGURATION.lsd OUTPUT.cpp\n", argv[ 0 ] );
+		return 1;
+	}
+
+	string model_name = argv[ i ];
+	size_t slash = model_name.rfind( '/' );
+	if ( slash != string::npos )
+	{
+		model_dir = model_name.substr( 0, slash + 1 );
+		model_name = model_name.substr( slash + 1 );
+	}
+
+	if ( ( model = load( model_name ) ) == NULL )
+	{
+		fprintf( stderr, "%s: cannot read model file '%s'\n", argv[ 0 ], argv[ i ] );
+		return 1;
+	}
+
+	if ( ! read_structure( argv[ i + 1 ] ) )
+	{
+		fprintf( stderr, "%s: cannot read model structure in '%s'\n", argv[ 0 ], argv[ i + 1 ] );
+		return 1;
+	}
+
+	// macros that may use temporary variables
+	for ( auto hname : { "fun_head.h", "fun_head_fast.h" } )
+		if ( ( head = load( lsd_src + hname, false ) ) != NULL )
+			read_macros( head );
+
+	// locate the equations region
+	const string &s = model->text;
+	begin = end = string::npos;
+	for ( size_t pos = 0; ; pos = tok.pos + tok.len )
+	{
+		tok = next_token( s, pos, s.size( ) );
+
+		if ( tok.type == T_END )
+			break;
+
+		if ( tok.type == T_ID && s.compare( tok.pos, tok.len, "MODELBEGIN" ) == 0 )
+			begin = tok.pos;
+
+		if ( tok.type == T_ID && s.compare( tok.pos, tok.len, "MODELEND" ) == 0 )
+			end = tok.pos;
+	}
+
+	set < const source * > done;
+	read_model( model, done );
+
+	if ( begin == string::npos || end == string::npos || end < begin )
+	{
+		fprintf( stderr, "%s: MODELBEGIN/MODELEND not found in '%s'\n", argv[ 0 ], argv[ i ] );
+		return 1;
+	}
+
+	ostringstream out;
+
+	out << "// generated by lsdAOT from '" << model_name << "', do not edit\n";
+	out << "#line 1 \"" << model_name << "\"\n";
+	out << s.substr( 0, begin );
+	out << "\n#if ! defined FAST_LOOKUP || ! defined _NW_\n";
+	out << "#error \"ahead-of-time compiled equations require FAST_LOOKUP and the no-window version\"\n";
+	out << "#endif\n\n";
+	out << "static vector < pair < string, eq_funcT > > aot_eqs;\n\n";
+	out << "static bool aot_add( const char *lab, eq_funcT eq )\n{\n\taot_eqs.push_back( make_pair( string( lab ), eq ) );\n\treturn true;\n}\n\n";
+	out << "#line " << model->line( begin ) << " \"" << model_name << "\"\n";
+
+	region( out, model, begin + strlen( "MODELBEGIN" ), end );
+
+	out << "MODEL_AOT( aot_eqs )\n";
+	out << "#line " << model->line( end ) << " \"" << model_name << "\"\n";
+	out << s.substr( end + strlen( "MODELEND" ) );
+
+	ofstream fout( argv[ i + 2 ] );
+	if ( ! ( fout << out.str( ) ) )
+	{
+		fprintf( stderr, "%s: cannot write '%s'\n", argv[ 0 ], argv[ i + 2 ] );
+		return 1;
+	}
+
+	printf( "%s: %d equations compiled, %d of %d element requests bound, %d warnings\n", argv[ 0 ], n_eqs, n_bound, n_look, n_warn );
+
+	return 0;
+}
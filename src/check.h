@@ -127,10 +127,13 @@ BROTHER
 ****************************************************/
 inline object *brother( object *c )
 {
-	if ( c == NULL || c->next == NULL )
+	if ( c == NULL )
 		return NULL;
 
-	return c->next;
+	// skip objects pending deletion in parallel jobs
+	for ( c = c->next; c != NULL && c->deferred; c = c->next );
+
+	return c;
 }
 
 
@@ -37,17 +37,22 @@
 #include <cstring>
 #include <cctype>
 #include <cmath>
+#include <cstdint>
 #include <ctime>
 #include <csignal>
 #include <new>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <functional>
 #include <unordered_map>
 #include <unordered_set>
 #include <mutex>
+#include <shared_mutex>
 #include <condition_variable>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <csetjmp>
 #include <sys/stat.h>
 #include <zlib.h>
@@ -58,9 +63,11 @@
 #undef THIS
 #else
 #include <unistd.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <errno.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <wordexp.h>
 #endif
 
@@ -153,26 +160,103 @@ using namespace std;
 struct object;
 struct variable;
 struct bridge;
+struct reduce_spec;
 struct mnode;
 struct netNode;
 struct netLink;
 
+// hash and comparison of C string labels (no string copy on look-ups)
+struct lab_hash
+{
+	size_t operator( )( const char *s ) const
+	{ size_t h = ( size_t ) 14695981039346656037ull; for ( ; *s != '\0'; ++s ) h = ( h ^ ( unsigned char ) *s ) * ( size_t ) 1099511628211ull; return h; };
+};
+
+struct lab_equal
+{
+	bool operator( )( const char *a, const char *b ) const
+	{ return strcmp( a, b ) == 0; };
+};
+
 // special types used for fast equation, object and variable lookup
 typedef function < double( object *caller, variable *var ) > eq_funcT;
 typedef pair < string, bridge * > b_pairT;
 typedef pair < double, object * > o_pairT;
-typedef pair < string, variable * > v_pairT;
 typedef vector < object * > o_vecT;
+typedef function < void( object *caller, variable *var, o_vecT &batch_objs, vector < double > &batch_res ) > batch_funcT;
 typedef unordered_map < string, eq_funcT > eq_mapT;
 typedef unordered_map < string, bridge * > b_mapT;
 typedef unordered_map < double, object * > o_mapT;
 typedef unordered_map < string, string > p_mapT;
-typedef unordered_map < string, variable * > v_mapT;
+typedef unordered_map < const char *, int, lab_hash, lab_equal > l_mapT;
 typedef unordered_set < object * > o_setT;
 
+struct var_layout						// variables slots of an object type
+{
+	atomic < int * > slots;				// [0]: label IDs covered, [1 + ID]: slot (-1: none)
+	int used;							// slots assigned
+
+	var_layout( void ) : slots( new int[ 1 ]( ) ), used( 0 ) { };
+
+	int add( int id );					// get (or assign) the slot of label ID
+};
+
+struct var_slots						// variables by label ID, in type slots
+{
+	var_layout *lay;					// slots of the object type (shared)
+	vector < variable * > vars;			// variables by slot
+
+	var_slots( void ) : lay( NULL ) { };
+
+	variable *find( int id ) const		// variable with label ID (or NULL)
+	{
+		int s, *tab;
+		if ( lay == NULL || id < 0 || id >= ( tab = lay->slots.load( memory_order_acquire ) )[ 0 ] ||
+			 ( s = tab[ id + 1 ] ) < 0 || s >= ( int ) vars.size( ) )
+			return NULL;
+		return vars[ s ];
+	};
+	size_t size( void ) const { return vars.size( ); };
+	void clear( void ) { vars.clear( ); };
+	void reserve( size_t n ) { vars.reserve( n ); };
+
+	void bind( int obj_id );			// use the slots of the object type
+	void erase( int id );				// remove variable with label ID
+	void insert( int id, variable *cv );// add variable with label ID
+};
+
 #ifndef _NP_
-typedef lock_guard < recursive_mutex > rec_lguardT;
-typedef unique_lock < recursive_mutex > rec_uniqlT;
+struct comp_lock						// compute-once lock word (recursive)
+{
+	static const unsigned waiting = 1u << 31;	// flag for threads blocked in wait table
+
+	atomic < unsigned > state;			// owning thread tag (0: idle) and waiting flag
+	unsigned depth;						// lock nesting by the owning thread
+
+	comp_lock( void ) : state( 0 ), depth( 0 ) { };
+
+	static unsigned self( void )		// tag of the current thread (never 0)
+	{ static thread_local const unsigned tag = new_tag( ); return tag; };
+	bool try_lock( void )
+	{
+		unsigned s = 0, me = self( );
+		if ( ! state.compare_exchange_strong( s, me, memory_order_acquire ) && ( s & ~ waiting ) != me )
+			return false;
+		++depth;
+		return true;
+	};
+	void lock( void )
+	{ if ( ! try_lock( ) ) wait( ); };
+	void unlock( void )
+	{ if ( --depth == 0 && ( state.exchange( 0, memory_order_release ) & waiting ) ) wake( ); };
+
+	static unsigned new_tag( void );	// get a new thread tag
+	void wait( void );					// block until lock is free (contended case)
+	void wake( void );					// release threads blocked on the lock
+};
+
+typedef lock_guard < comp_lock > rec_lguardT;
+typedef unique_lock < comp_lock > rec_uniqlT;
 #endif
 
 #ifdef _WIN32
@@ -185,12 +269,17 @@ typedef pid_t handleT;
 struct object
 {
 	char *label;
+	atomic < bool > deferred;			// deletion deferred to the end of a parallel job
 	bool deleting;						// indicate deletion in process
+	atomic < bool > detached;			// created in a parallel job, not attached yet
 	bool to_compute;
 	int acounter;
+	int id;								// label ID (see lab_id)
 	int lstCntUpd;						// period of last counter update
+	long serial;						// object serial number (creation order)
 	bridge *b;
 	object *next;
+	object *prev;						// previous sibling (unlinking hint)
 	object *up;
 	variable *v;
 	object *hook;
@@ -200,12 +289,15 @@ struct object
 
 	o_vecT hooks;
 	b_mapT b_map;						// fast lookup map to object bridges
-	v_mapT v_map;						// fast lookup map to variables
+	var_slots v_map;					// fast lookup slots to variables (by label ID)
 
 #ifndef _NP_
-	mutex parallel_comp;				// mutex lock for parallel computations
+	comp_lock parallel_comp;			// lock for parallel computations
 #endif
 
+	static void *operator new( size_t sz );		// allocate from objects pool
+	static void operator delete( void *p, size_t sz );	// release to objects pool
+
 	bool load_param( const char *file_name, int repl, FILE *f );
 	bool load_struct( FILE *f );
 	bool under_computation( void );
@@ -215,9 +307,11 @@ struct object
 	double cal( const char *l, int lag = 0 );
 	double cal( object *caller, const char *l, int lag = 0 );
 	double cal( object *caller, const char *l, int lag, bool force_search );
+	double cal( object *caller, int id, int lag );
 	double count( const char *lab1, int lag = 0, bool cond = false, const char *lab2 = "", const char *lop = "", double value = NAN );
 	double count_all( const char *lab1, int lag = 0, bool cond = false, const char *lab2 = "", const char *lop = "", double value = NAN );
 	double increment( const char *lab, double value );
+	double lag_sum( const char *lab, int num, int lag = 0 );
 	double initturbo( const char *label, double num );
 	double initturbo_cond( const char *label );
 	double init_stub_net( const char *lab, const char* gen, long numNodes = 0, long par1 = 0, double par2 = 0.0 );
@@ -229,6 +323,7 @@ struct object
 	double last_cal( const char *lab );
 	double med( const char *lab1, int lag = 0, bool cond = false, const char *lab2 = "", const char *lop = "", double value = NAN );
 	double multiply( const char *lab, double value );
+	double multi_reduce( const char *lab, int n, const reduce_spec *spec, double *res, vector < double > *vals = NULL, int lag = 0 );
 	double overall_max( const char *lab1, int lag = 0, bool cond = false, const char *lab2 = "", const char *lop = "", double value = NAN );
 	double overall_min( const char *lab1, int lag = 0, bool cond = false, const char *lab2 = "", const char *lop = "", double value = NAN );
 	double perc( const char *lab1, double p, int lag = 0, bool cond = false, const char *lab2 = "", const char *lop = "", double value = NAN );
@@ -264,6 +359,7 @@ struct object
 	object *draw_rnd( const char *lo );
 	object *draw_rnd( const char *lo, const char *lv, int lag = 0 );
 	object *draw_rnd( const char *lo, const char *lv, int lag, double tot );
+	int draw_rnd_batch( const char *lo, const char *lv, int lag, int n, bool replace, o_vecT &list );
 	object *hyper_next( const char *lab );
 	object *hyper_next( void );
 	object *lat_down( void );
@@ -276,14 +372,17 @@ struct object
 	object *search_err( const char *lab, bool no_search, const char *errmsg );
 	object *search_node_net( const char *lab, long id );
 	object *search_var_cond( const char *lab, double value, int lag = 0 );
+	int search_var_cond_all( const char *lab, double value, o_vecT &list, int lag = 0 );
 	object *shuffle_nodes_net( const char *lab );
 	object *turbosearch( const char *label, double tot, double num );
 	object *turbosearch_cond( const char *label, double value );
 	variable *add_empty_var( const char *str );
+	variable *add_var_from_example( variable *example, variable *last = NULL );
 	variable *search_var( object *caller, const char *label, bool no_error = false, bool no_search = false, bool search_sons = false );
+	variable *search_var( object *caller, int id, bool no_error = false, bool no_search = false, bool search_sons = false );
 	variable *search_var_err( object *caller, const char *label, bool no_search, bool search_sons, const char *errmsg );
+	variable *search_var_err( object *caller, int id, bool no_search, bool search_sons, const char *errmsg );
 	void add_obj( const char *label, int num, int propagate );
-	void add_var_from_example( variable *example );
 	void chg_lab( const char *lab );
 	void chg_var_lab( const char *old, const char *n );
 	void collect_cemetery( variable *caller = NULL );
@@ -328,14 +427,25 @@ struct variable
 	int period;
 	int period_range;
 	int start;
+	int rnd_t;							// period of last counter-based draw
+	unsigned rnd_cnt;					// counter-based draws in period rnd_t
+	unsigned rnd_key;					// label hash keying counter-based draws
+	int id;								// label ID (see lab_id)
+	int dep_pos;						// position in dependency wave results (-1: none)
+	int stream_id;						// streamed series id (-1: not streamed)
+	int win;							// saved data window size (0: all periods)
+	int head;							// position of current value in val[] (circular)
+	int roll_k;							// rolling window size (0: none)
+	int roll_cnt;						// values added since exact window sums (-1: stale)
 	double *data;
 	double *val;
 	double deb_cnd_val;
+	double roll_sum[ 2 ];				// sums of last roll_k values (from lags 0 and 1)
 	object *up;
 	variable *next;
 
 #ifndef _NP_
-	recursive_mutex parallel_comp;		// mutex lock for parallel computation
+	comp_lock parallel_comp;			// lock for parallel computation
 #endif
 
 	eq_funcT eq_func;					// pointer to equation function for fast look-up
@@ -343,10 +453,31 @@ struct variable
 	variable( void );					// empty constructor
 	variable( const variable &v );		// copy constructor
 
+	static void *operator new( size_t sz );		// allocate from variables pool
+	static void operator delete( void *p, size_t sz );	// release to variables pool
+
+	double &saved( int time )			// saved value in time (windowed if streamed)
+	{ return data[ win > 0 ? ( time - start ) % win : time - start ]; };
+	double &lagged( int lag )			// value with lag (circular val[] buffer)
+	{ int i = head + lag; return val[ i > num_lag ? i - num_lag - 1 : i ]; };
+	void shift( double value )			// store new current value, dropping oldest lag
+	{ if ( roll_k > 0 ) roll_add( value ); if ( --head < 0 ) head = num_lag; val[ head ] = value; };
+
 	double cal( object *caller, int lag );
+	double cal_batch( object *caller, const batch_funcT &body );
 	double fun( object *caller );
+	double roll( int first );
 	void empty( bool no_lock = false );
 	void init( object *_up, const char *_label, int _num_lag, double *val, int _save );
+	void roll_add( double value );
+};
+
+struct reduce_spec						// element reduction specification for multi_reduce
+{
+	const char *lab;					// variable or parameter label
+	const char *op;						// reduction: "SUM", "AVE", "CNT", "MAX" or "MIN"
+	const char *lop;					// "CNT" condition operator ("" to count non-zero)
+	double value;						// "CNT" condition value
 };
 
 struct bridge
@@ -471,20 +602,23 @@ struct lsdstack
 class result							// results file object
 {
 	FILE *f;							// uncompressed file pointer
+	bool dobin;							// binary columnar .lcr format
 	bool docsv;							// comma separated .csv text format
 	bool dozip;							// compressed file flag
 	bool firstCol;						// flag for first column in line
 	gzFile fz;							// compressed file pointer
 
+	void columns_recursive( object *r, vector < variable * > &cols );	// list saved series
 	void title_recursive( object *r, int i );	// write file header (recursively)
 	void data_recursive( object *r, int i );	// save a single time step (recursively)
 
 	public:
 
-	result( const char *fname, const char *fmode, bool dozip = false, bool docsv = false );
+	result( const char *fname, const char *fmode, bool dozip = false, bool docsv = false, bool dobin = false );
 										// constructor
 	~result( void );					// destructor
 
+	bool columns( object *root, int initstep, int endtstep );	// write binary columns
 	void data( object *root, int initstep, int endtstep = 0 );	// write data
 	void title( object *root, int flag );	// write file header
 };
@@ -497,6 +631,101 @@ struct profile							// profiled variable object
 	profile( ) { ticks = 0; comp = 0; };// constructor
 };
 
+struct slab_pool						// fixed-size blocks for objects or variables
+{
+	size_t size;						// block size (aligned)
+	size_t used;						// blocks used in last chunk
+	void *free_list;					// released blocks (linked by first word)
+	vector < char * > chunks;			// allocated chunks of SLAB_CHUNK blocks
+
+#ifndef _NP_
+	mutex lock;							// pool access lock
+#endif
+
+	slab_pool( size_t _size );			// constructor
+
+	void *alloc( void );				// get a block
+	void release( void *p );			// return a block to the pool
+};
+
+struct prof_node						// equation profiler call tree node
+{
+	int id;								// equation label ID
+	int up;								// caller node (-1: none)
+	long long calls;					// number of computations
+	unsigned long long incl;			// inclusive time (ticks)
+	unsigned long long excl;			// exclusive time (ticks)
+	vector < pair < int, int > > sons;	// callee label IDs and nodes
+};
+
+struct prof_frame						// equation being profiled
+{
+	int node;							// call tree node
+	unsigned long long start;			// start time (ticks)
+	unsigned long long sons;			// time in callees (ticks)
+};
+
+struct prof_event						// long computation for the trace timeline
+{
+	int id;								// equation label ID
+	unsigned long long start;			// start time since run start (ticks)
+	unsigned long long dur;				// duration (ticks)
+};
+
+struct prof_thread						// equation profiler data of one thread
+{
+	int tid;							// thread index (0: first to compute)
+	int cur;							// node being computed
+	vector < prof_node > nodes;			// call tree (node 0: thread root)
+	vector < prof_frame > stack;		// equations being computed
+	vector < prof_event > events;		// long computations
+};
+
+struct dist_node						// element of a distribution index
+{
+	double val;							// element value (sort key)
+	double sum;							// sum of values in subtree
+	double wsum;						// rank-weighted sum of values in subtree
+	long ser;							// object serial number (tie break key)
+	uint64_t prio;						// heap priority (hash of serial number)
+	unsigned stamp;						// last update pass
+	int cnt;							// elements in subtree
+	int l, r;							// children (-1 if none)
+	object *obj;						// indexed object
+};
+
+struct dist_index						// incremental order-statistics index
+{
+	int root;							// tree root node (-1 if empty)
+	unsigned stamp;						// current update pass
+	vector < dist_node > nodes;			// node pool
+	vector < int > free_nodes;			// released nodes available for reuse
+	unordered_map < object *, int > pos;// node of each indexed object
+
+	dist_index( void );					// constructor
+
+	double gini( void );				// Gini index of the distribution
+	double select( int k );				// k-th smallest value (0-based)
+	double sum_below( int k );			// sum of the k smallest values
+	double total( void );				// sum of all values
+	int rank( object *o );				// rank of object value (0-based, -1 if absent)
+	int size( void );					// number of elements
+	void clear( void );					// remove all elements
+	void mark( void );					// start a new update pass
+	void remove( object *o );			// remove object from index
+	void sorted( vector < o_pairT > &out );// all (value, object) in ascending order
+	void sweep( void );					// remove objects not updated in the pass
+	void update( object *o, double x );	// insert object or change its value
+
+	bool less( int a, int b );			// internal tree operations
+	int erase( int n, int e );
+	int insert( int n, int e );
+	int merge( int a, int b );
+	void pull( int n );
+	void split( int n, int e, int &a, int &b );
+	void walk( int n, vector < o_pairT > &out );
+};
+
 struct nolh								// near-orthogonal Latin hypercube description
 {
 	int kMin;
@@ -508,33 +737,99 @@ struct nolh								// near-orthogonal Latin hypercube description
 	int *table;
 };
 
+struct dep_reject { };					// side effect rejected in dependency wave
+
 #ifndef _NP_
+struct dep_undo							// undo data of variable computed in dependency wave
+{
+	int task;							// label ID of the wave variable computed
+	int last_update;					// previous time of last update
+	int next_update;					// previous time of next update
+	double drop;						// oldest lag dropped by the computation
+	variable *var;						// variable instance computed
+};
+
+struct dep_link							// request of a variable in dependency wave
+{
+	variable *from;						// variable instance requesting
+	variable *to;						// variable instance requested
+};
+
+struct upd_job							// chunked parallel update job
+{
+	atomic < size_t > next;				// next task to take
+	atomic < int > pending;				// threads still working in the job
+	condition_variable done;			// completion barrier signal
+	mutex lock;							// completion barrier lock
+	size_t chunk;						// instances per task (if no task bounds)
+	vector < dep_link > links;			// variables requested (dependency waves only)
+	vector < dep_undo > undos;			// variables computed (dependency waves only)
+	vector < function < void( void ) > > funcs;	// engine tasks, instead of variables (see run_tasks)
+	vector < size_t > tasks;			// task bounds in vars (empty: fixed chunks)
+	vector < variable * > vars;			// variable instances to update
+
+	size_t num_tasks( void )			// number of tasks in the job
+	{ return ! funcs.empty( ) ? funcs.size( ) : tasks.empty( ) ? ( vars.size( ) + chunk - 1 ) / chunk : tasks.size( ) - 1; };
+	bool take( size_t &first, size_t &last )	// get instances range of next task
+	{
+		size_t k = next++;
+		if ( k >= num_tasks( ) )
+			return false;
+		first = tasks.empty( ) ? k * chunk : tasks[ k ];
+		last = tasks.empty( ) ? min( first + chunk, vars.size( ) ) : tasks[ k + 1 ];
+		return true;
+	};
+};
+
+struct mut_op							// deferred structural change in parallel job
+{
+	char type;							// 'a': add objects, 'd': delete object, 's': sort, 'n': number object
+	int lag;							// lag of sorting variables
+	size_t pos;							// position of job task making the change
+	object *obj;						// first added, deleted, sorting or created object
+	string lab;							// label of added or sorted objects
+	string var1;						// sorting variable ("": network node id)
+	string var2;						// second sorting variable ("": none)
+	string dir;							// sorting direction
+};
+
 struct worker							// multi-thread parallel worker data structure
 {
-	bool free;
-	bool running;
-	bool errored;
+	atomic < bool > free;				// waiting for a computation
+	atomic < bool > running;			// not stopped
+	atomic < bool > errored;			// stopped on error
 	bool user_excpt;
 	char err_msg1[ MAX_BUFF_SIZE ];
 	char err_msg2[ MAX_BUFF_SIZE ];
 	char err_msg3[ MAX_BUFF_SIZE ];
+	condition_variable idle;			// signal worker free or stopped
 	condition_variable run;
 	exception_ptr pexcpt;
 	int signum;
 	jmp_buf env;
+	mutex idle_lock;					// lock for idle signal
 	mutex lock;
 	thread thr;
 	thread::id thr_id;
+	upd_job *job;
 	variable *var;
+	vector < dep_link > links;			// variables requested in dependency wave
+	vector < dep_undo > undos;			// variables computed in dependency wave
+	vector < mut_op > muts;				// deferred structural changes in job
 
 	worker( void );						// constructor
 	~worker( void );					// destructor
 
+	bool cal_job( void );				// compute chunks of a job
+	bool cal_var( void );				// compute a single variable instance
 	bool check( void );					// handle worker problems
 	static void signal_wrapper( int signun );	// wrapper for signal_handler
+	void cal( upd_job *job );			// start worker job calculation
 	void cal( variable *var );			// start worker calculation
 	void cal_worker( void );			// worker thread code
 	void signal( int signum );			// signal handler
+	void signal_idle( void );			// signal worker free or stopped
+	void wait_free( void );				// wait worker free or stopped
 };
 #endif
 
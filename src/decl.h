@@ -55,6 +55,18 @@ Relevant flags (when defined):
 #define SRV_MAX_CORES 64				// maximum number of cores to use in a server
 #define MAX_WAIT_TIME 10				// maximum wait time for a variable computation ( sec.)
 #define MAX_TIMEOUT 100					// maximum timeout for multi-thread scheduler (millisec.)
+#define MAX_DRAW_TRIES 100				// maximum redraws for rounding errors in batch random draws
+#define PAR_CHUNK_MIN 64				// minimum instances per parallel update chunk
+#define PAR_CHUNK_THR 4					// target parallel update chunks per thread
+#define PAR_SORT_MIN 16384				// minimum keys per parallel sort chunk
+#define COMP_SLOTS 64					// waiting slots for contended parallel computation locks
+#define FORKSTAT -4321					// run_parallel return in forked run instance
+#define DEP_WARM 6						// warm-up periods recording equation dependencies
+#define PROF_MIN_USEC 100				// minimum profiled computation time in trace (usec)
+#define PROF_MAX_EVENTS 1000000			// maximum computations in profiler trace per thread
+#define PROF_TOP 20						// equations in profiler log summary
+#define STREAM_WIN 64					// initial periods kept in memory per streamed series
+#define STREAM_RING ( 1 << 22 )			// streamed results writer buffer size (bytes)
 #define MAX_LEVEL 10					// maximum number of object levels (plotting only)
 #define MAX_OBJ_CHK	10000000			// maximum number of objects to check when searching
 #define ERR_LIM 5						// maximum number of repeated error messages
@@ -71,6 +83,8 @@ Relevant flags (when defined):
 #define CSV_SEP ","						// single char string with the .csv format separator
 #define SENS_SEP " ,;|/#\t\n"			// sensitivity data valid separators
 #define USER_D_VARS 1000				// number of user double variables
+#define SLAB_CHUNK 1024					// blocks per object/variable pool chunk
+#define LAG_SLABS 4						// largest lagged values vector from pools
 #define UPD_PER 0.2						// update period during simulation run in s
 #define NO_DESCR ""						// no description available text
 #define LEGACY_NO_DESCR "(no description available)" // legacy description (do not change)
@@ -116,6 +130,7 @@ double alapl( double mu, double alpha1, double alpha2 );// draw from an asymmetr
 double alaplcdf( double mu, double alpha1, double alpha2, double x );	// asymmetric laplace cdf
 double bernoulli( double p );							// draw from a Bernoulli distribution
 double beta( double alpha, double beta );				// draw from a beta distribution
+double beta_ctr( object *obj, variable *var, double alpha, double beta );	// counter-based beta draw
 double betacdf( double alpha, double beta, double x );	// beta cumulative distribution function
 double betacf( double a, double b, double x );			// beta distribution function
 double binomial( double p, double t );					// draw from a binomial distribution
@@ -131,11 +146,13 @@ double gamma( double alpha, double beta = 1 );			// draw from a gamma distributi
 double geometric( double p );							// draw from a geometric distribution
 double init_lattice( int init_color = -0xffffff, double nrow = 100, double ncol = 100, double pixW = 0, double pixH = 0 );
 double lnorm( double mu, double sigma );				// draw from a lognormal distribution
+double lnorm_ctr( object *obj, variable *var, double mu, double sigma );	// counter-based lognormal draw
 double lnormcdf( double mu, double sigma, double x );	// lognormal cumulative distribution function
 double max( double a, double b );
 double median( vector < double > & v );
 double min( double a, double b );
 double norm( double mean, double dev );
+double norm_ctr( object *obj, variable *var, double mean, double dev );	// counter-based normal draw
 double normcdf( double mu, double sigma, double x );	// normal cumulative distribution function
 double pareto( double mu, double alpha );
 double paretocdf( double mu, double alpha, double x );
@@ -143,20 +160,26 @@ double poisson( double m );
 double poissoncdf( double lambda, double k );			// poisson cumulative distribution function
 double read_lattice( double line, double col );
 double ran1( long *unused = 0 );
+double rnd_ctr( object *obj, variable *var );			// counter-based uniform draw in (0,1)
 double round( double r );
 double round_digits( double value, int digits );
 double save_lattice( const char fname[ ] = "lattice" );
 double student( double n );								// draw from a Student-T distribution
 double unifcdf( double a, double b, double x );			// uniform cumulative distribution function
 double uniform( double min, double max );
+double uniform_ctr( object *obj, variable *var, double min, double max );	// counter-based uniform draw
 double uniform_int( double min, double max );
 double update_lattice( double line, double col, double val = 1 );
 double weibull( double a, double b );					// draw from a Weibull distribution
+int lab_id( const char *lab );							// interned integer ID of element label
+void batch_vals( const o_vecT &objs, const char *lab, int lag, vector < double > &vals );	// values in a batch of objects
 void close_lattice( void );
 void deb_log( bool on, int time = 0 );					// control debug mode
 void error_hard( const char *boxTitle, const char *boxText, bool defQuit, const char *logFmt, ... );
 void init_random( unsigned seed );						// reset the random number generator seed
+void set_window( const char *lab, int num );			// set variable rolling window size
 void set_fast( int level );								// enable fast mode
+void set_index( const char *lab, bool on = true );		// set parameter value index
 void *set_random( int gen );							// set random generator
 
 
@@ -180,6 +203,7 @@ extern int sim_num;
 extern int t;
 extern unsigned seed;
 extern object *root;
+extern void ( *restore_func )( void );	// user function called after resuming a checkpoint
 
 #ifndef _NW_
 extern int i_values[ ];					// user temporary variables copy
@@ -202,14 +226,20 @@ bool abort_run_threads( void );
 bool add_rt_plot_tab( const char *w, int id_sim );
 bool add_unsaved( void );
 bool alloc_save_mem( object *r );
+bool bench_open( const char *arg );
+bool branch_params( const char *fname, map < string, string > &pars );
+bool branch_run( void );
 bool alloc_save_var( variable *v );
 bool check_cond( double val1, int lopc, double val2 );
 bool check_res_dir( const char *path, const char *sim_name = NULL );
+bool ckpt_load( const char *fname );
+bool ckpt_save( const char *fname );
 bool contains( FILE *f, const char *lab, int len );
 bool create_maverag( void );
 bool create_res_dir( const char *path );
 bool create_series( bool mc, vector < string > var_names );
 bool has_descr_text( description *d );
+bool index_find( variable *cv, double value, object *&res, o_vecT *list = NULL );
 bool is_equation_header( const char *line, char *var, char *updt_in );
 bool load_description( const char *msg, FILE *f );
 bool load_prev_configuration( void );
@@ -220,20 +250,27 @@ bool save_sensitivity( FILE *f );
 bool search_parallel( object *r );
 bool sensitivity_clean_dir( const char *path );
 bool sensitivity_too_large( long numSaPts );
+bool set_random_state( const string &state );
 bool sort_listbox( int box, int order, object *r );
 bool stop_parallel( void );
+bool stream_open( const char *fname );
+bool stream_read( variable *v, int time, double &value );
+bool stream_write( variable *v, int time, double value );
 bool unsaved_change( bool );
 bool unsaved_change( void );
 char *NOLH_valid_tables( int k, char *out, int sz );
 char *fmt_ttip_descr( char *out, description *d, int outSz, bool init = true );
 char *upload_eqfile( void );
+const char *lab_name( int id );
 description *add_description( const char *lab, int type = 4, const char *text = NULL, const char *init = NULL, char initial = 'n', char observe = 'n' );
 description *change_description( const char *lab_old, const char *lab = NULL, int type = -1, const char *text = NULL, const char *init = NULL, char initial = '\0', char observe = '\0' );
 description *search_description( const char *lab, bool add_missing = true );
 double lower_bound( double a, double b, double marg, double marg_eq, int dig = 16 );
+double prof_incl( int id );
 double upper_bound( double a, double b, double marg, double marg_eq, int dig = 16 );
 double t_star( int df, double cl );
 double z_star( double cl );
+double *lag_alloc( int n );
 double *log_data( double *data, int start, int end, int ser, const char *err_msg );
 int browse( object *r );
 int check_label( const char *lab, object *r );
@@ -253,6 +290,7 @@ int rnd_int( int min, int max );
 int run_parallel( bool nw, const char *exec, const char *simname, int fseed, int runs, int thrrun, int parruns );
 int shrink_gnufile( void );
 int uniform_int_0( int max );
+int window_size( variable *v );
 long num_sensitivity_points( sense *rsens );
 object *check_net_struct( object *caller, const char *nodeLab, bool noErr = false );
 object *go_brother( object *c );
@@ -261,6 +299,10 @@ object *restore_pos( object * );
 object *sensitivity_parallel( object *o, sense *s );
 object *skip_next_obj( object *t );
 object *skip_next_obj( object *t, int *count );
+slab_pool &lag_slab( int n );
+string random_state( void );
+unsigned rnd_ctr_key( const char *lab );
+variable *dep_enter( variable *v );
 void NOLH_clear( void );
 void add_cemetery( variable *v );
 void add_da_plot_tab( const char *w, int id_plot );
@@ -269,6 +311,11 @@ void ancestors( object *r, FILE *f, bool html = true );
 void assign( object *r, int *idx, const char *lab );
 void attach_instance_number( char *outh, char *outv, object *r, int outSz );
 void auto_document( const char *lab, const char *which, bool append = false );
+void bench_end( void );
+void bench_run( int seed );
+void bench_save( void );
+void bench_step( int t );
+void branch_wait( void );
 void canvas_binds( int n );
 void center_plot( void );
 void chg_obj_num( object **c, int value, int all, int pippo[ ], int cfrom );
@@ -295,6 +342,16 @@ void create_table_init( object *r, FILE *frep );
 void dataentry_sensitivity( sense *s, int nval = 0 );
 void deb_show( object *r, const char *hl_var, int mode );
 void delete_bridge( object *d );
+void dep_call( variable *v, int lag );
+void dep_delete( object *r );
+void dep_effect( const char *lab );
+void dep_forget( variable *v );
+void dep_leave( variable *prev );
+void dep_period( object *r );
+void dep_read( const char *lab );
+void dep_store( variable *v );
+void dep_use( variable *v );
+void dep_vacant( const char *lab );
 void detach_parallel( void );
 void disable_plot( void );
 void draw_buttons( void );
@@ -318,6 +375,10 @@ void get_saved( object *n, FILE *out, const char *sep, bool all_var = false );
 void get_var_descr( const char *lab, char *desc, int descr_len );
 void histograms( void );
 void histograms_cs( void );
+void index_add( object *obj );
+void index_del( object *obj );
+void index_move( variable *cv, double old, double value );
+void index_reset( void );
 void init_map( void );
 void init_math_error( void );
 void init_plot( int i, int id_sim );
@@ -327,6 +388,8 @@ void insert_labels_mem( object *r, int *num_v, const char *lab = NULL );
 void insert_obj_num( object *r, const char *tag, const char *ind, int *idx, int *count );
 void insert_object( const char *w, object *r, bool netOnly = false, object *above = NULL );
 void insert_store_mem( object *r, int max_v, int *num_v, const char *lab = NULL );
+void lab_freeze( bool freeze );
+void lag_free( double *p, int n );
 void link_cells( object *root, const char *lab );
 void log_parallel( bool nw );
 void monitor_parallel( bool nw );
@@ -345,6 +408,10 @@ void plot_phase_diagram( void );
 void plot_rt( variable *var );
 void plot_tseries( void );
 void prepare_plot( object *r, int id_sim );
+void prof_enter( variable *v );
+void prof_leave( void );
+void prof_save( const char *base );
+void prof_start( void );
 void put_line( int x1, int y1, int x2 );
 void put_node( int x, int y, const char *str, bool sel );
 void put_text( const char *str, const char *num, int x, int y, const char *str2 );
@@ -355,7 +422,9 @@ void reset_description( object *r );
 void reset_end( object *r );
 void reset_plot( void );
 void run( void );
-void run_parallel_exec( bool nw, int id, string cmd );
+void run_parallel_exec( int id, string cmd );
+void sampler_dirty( int id );
+void sampler_reset( void );
 void save_cells( object *r, const char *lab );
 void save_data1( void );
 void save_datazip( void );
@@ -405,6 +474,10 @@ void sort_cs_asc( char **s, char **t, double **v, int nv, int nt, int c );
 void sort_cs_desc( char **s, char **t, double **v, int nv, int nt, int c );
 void statistics( void );
 void statistics_cross( void );
+void stream_add( variable *v );
+void stream_close( object *r, const char *fname );
+void stream_drop( variable *v );
+void stream_step( void );
 void tex_report_end( FILE *f );
 void tex_report_head( FILE *f, bool table = true );
 void tex_report_init( object *r, FILE *f, bool table = true );
@@ -427,12 +500,20 @@ void write_str( object *r, FILE *frep, int dep, const char *prefix );
 void write_var( object *r, variable *v, FILE *frep );
 
 #ifndef _NP_
+bool mut_defer( object *r, bool own = false );
+void mut_apply( vector < mut_op > &log, const vector < bool > *drop = NULL );
+void mut_end( void );
+void mut_number( object *r );
+void mut_start( size_t n );
+int task_threads( void );
 void parallel_update( variable *v, object* p, object *caller = NULL );
+void run_tasks( vector < function < void( void ) > > &tasks );
 #endif
 
 // global internal variables (not visible to the users)
 extern FILE *log_file;			// log file, if any
 extern bool brCovered;			// browser cover currently covered
+extern bool dep_waving;			// dependency waves being computed
 extern bool eq_dum;				// current equation is dummy
 extern bool error_hard_thread;	// flag to error_hard() called in worker thread
 extern bool idle_loop;			// indicates in main idle loop (no running operation)
@@ -487,7 +568,13 @@ extern int add_to_tot;			// type of totals file generated (bool)
 extern int choice;				// Tcl menu control variable (main window)
 extern int choice_g;			// Tcl menu control variable ( structure window)
 extern int cur_plt;				// current graph plot number
+extern int dep_state;			// dependency scheduler state (0:off, 1:recording, 2:waves)
 extern int dobar;				// output a progress bar to the log/standard output
+extern int dobench;				// save benchmark records (bool)
+extern int dobin;				// produce binary columnar .lcr results files (bool)
+extern int doprof;				// profile equations computation (bool)
+extern int dowaves;				// schedule equations in dependency waves (bool)
+extern int dostream;			// stream saved series to disk during the run (bool)
 extern int docsv;				// produce .csv text results files (bool)
 extern int doover;				// overwrite results folder (bool)
 extern int dozip;				// compressed results file flag (bool)
@@ -503,15 +590,18 @@ extern int parallel_disable;	// flag to control parallel mode
 extern int prof_aggr_time;		// show aggregate profiling times
 extern int prof_min_msecs;		// profile only variables taking more than X msecs.
 extern int prof_obs_only;		// profile only observed variables
+extern int prof_on;				// equations profiler active (bool)
 extern int saveConf;			// save configuration on results saving (bool)
 extern int series_saved;		// number of series saved
 extern int lsd_stack;				// LSD stack call level
 extern int stack_info;			// LSD stack control
+extern int start_step;			// first time step of current run (>1 if resumed)
 extern int strWindowOn;			// control the presentation of the model structure window (bool)
 extern int watch;				// allow for graph generation interruption (bool)
 extern int when_debug;			// next debug stop time step (0 for none )
 extern int wr_warn_cnt;			// invalid write operations warning counter
 extern long nodesSerial;		// network node serial number global counter
+extern long objSerial;			// object serial number global counter
 extern map< string, profile > prof;// set of saved profiling times
 extern mt19937 mt32;			// Mersenne-Twister 32 bits generator
 extern nolh NOLH[ NOLH_TABS ];	// characteristics of NOLH tables
@@ -520,6 +610,9 @@ extern object *currObj;			// pointer to current object in browser
 extern object *wait_delete;		// LSD object waiting for deletion
 extern o_setT obj_list;			// list with all existing LSD objects
 extern sense *rsense;			// LSD sensitivity analysis structure
+extern unordered_map < int, int > roll_wins;// rolling window sizes by variable label ID
+extern unordered_set < int > idx_pars;// indexed parameter label IDs
+extern bool samplers_on;		// random draw samplers in use (writes tracked)
 extern variable *cemetery;		// LSD saved data from deleted objects
 extern variable *last_cemetery;	// LSD last saved data from deleted objects
 extern vector < string > res_list;// list of results files last saved
@@ -533,6 +626,12 @@ extern mutex lock_obj_list;		// lock for object list for parallel manipulation
 extern mutex lock_run_logs;		// lock run_logs for parallel updating
 extern string run_log;			// consolidated runs log
 extern thread run_monitor;		// thread monitoring parallel instances
+extern thread_local vector < dep_link > *dep_links;// variables requested in dependency wave in thread (NULL: none)
+extern thread_local vector < dep_undo > *dep_log;// variables computed in dependency wave in thread (NULL: none)
+extern thread_local long mut_cnt;// objects created by current job task in thread
+extern thread_local object *mut_owner;// object of current job task in thread
+extern thread_local size_t mut_pos;// position of current job task in thread
+extern thread_local vector < mut_op > *mut_log;// deferred structural changes in thread (NULL: none)
 extern vector < string > run_logs;// list of log files produced in parallel run
 #endif
 
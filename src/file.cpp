@@ -174,13 +174,13 @@ void object::save_param( FILE *f )
 			cv1 = cur->search_var( NULL, cv->label );
 			if ( cv1->param == 1 )
 				if ( cv1->data_loaded == '+' )
-					fprintf( f, "\t%.15g", cv1->val[ 0 ] );
+					fprintf( f, "\t%.15g", cv1->lagged( 0 ) );
 				else
 					fprintf( f, "\t%c", '0' );
 			else
 				for ( i = 0; i < cv->num_lag; ++i )
 					if ( cv1->data_loaded == '+' )
-						fprintf( f, "\t%.15g", cv1->val[ i ] );
+						fprintf( f, "\t%.15g", cv1->lagged( i ) );
 					else
 						fprintf( f, "\t%c", '0' );
 		}
@@ -261,7 +261,9 @@ bool object::load_param( const char *file_name, int repl, FILE *f )
 		for ( cur = this; cur != NULL; repl == 1 ? cur = cur->hyper_next( label ) : cur = NULL )
 		{
 			cv1 = cur->search_var( NULL, cv->label );
-			cv1->val = new double[ cv->num_lag + 1 ];
+			cv1->val = lag_alloc( cv->num_lag + 1 );
+			cv1->head = 0;
+			cv1->roll_cnt = -1;
 			cv1->param = cv->param;
 			cv1->num_lag = cv->num_lag;
 			cv1->save = cv->save;
@@ -276,7 +278,7 @@ bool object::load_param( const char *file_name, int repl, FILE *f )
 				if ( fscanf( f, "%lf", &app ) != 1 )
 					return false;
 				else
-					cv1->val[ 0 ] = app;
+					cv1->lagged( 0 ) = app;
 			}
 			else
 			{
@@ -866,6 +868,7 @@ void unload_configuration ( bool full )
 	actual_steps = 0;							// reset steps counter
 	findexSens = 0;								// reset sensitivity serial number
 	nodesSerial = 0;							// reset network node serial number
+	objSerial = 0;								// reset object serial number
 
 #ifndef _NW_
 	currObj = NULL;								// no current object pointer
@@ -1349,7 +1352,7 @@ void get_sa_limits( object *r, FILE *out, const char *sep )
 		else
 			strcpy( type, "variable" );
 
-		fprintf( out, "%s%s%s%s%d%s%s%s%g%s%g%s%g%s\"%s\"\n", cs->label, sep, type, sep, cs->param == 1 ? 0 : cs->lag + 1, sep, cs->integer ? "integer" : "real", sep, cv != NULL ? cv->val[ cs->lag ] : NAN, sep, min, sep, max, sep, lab != NULL ? lab : "" );
+		fprintf( out, "%s%s%s%s%d%s%s%s%g%s%g%s%g%s\"%s\"\n", cs->label, sep, type, sep, cs->param == 1 ? 0 : cs->lag + 1, sep, cs->integer ? "integer" : "real", sep, cv != NULL ? cv->lagged( cs->lag ) : NAN, sep, min, sep, max, sep, lab != NULL ? lab : "" );
 
 		delete [ ] lab;
 	}
@@ -1525,6 +1528,60 @@ void result::data_recursive( object *r, int i )
 	for ( cv = r->v; cv != NULL; cv = cv->next )
 	{
 		if ( cv->save == 1 )
+		{
+			if ( cv->start <= i && cv->end >= i && ! is_nan( cv->saved( i ) ) )
+			{
+				if ( dozip )
+				{
+					if ( docsv )
+						gzprintf( fz, "%s%.*G", firstCol ? "" : CSV_SEP, SIG_DIG, cv->saved( i ) );
+					else
+						gzprintf( fz, "%.*G\t", SIG_DIG, cv->saved( i ) );
+				}
+				else
+				{
+					if ( docsv )
+						fprintf( f, "%s%.*G", firstCol ? "" : CSV_SEP, SIG_DIG, cv->saved( i ) );
+					else
+						fprintf( f, "%.*G\t", SIG_DIG, cv->saved( i ) );
+				}
+			}
+			else
+			{
+				if ( dozip )		// save NaN as n/a
+				{
+					if ( docsv )
+						gzprintf( fz, "%s%s", firstCol ? "" : CSV_SEP, nonavail );
+					else
+						gzprintf( fz, "%s\t", nonavail );
+				}
+				else
+				{
+					if ( docsv )
+						fprintf( f, "%s%s", firstCol ? "" : CSV_SEP, nonavail );
+					else
+						fprintf( f, "%s\t", nonavail );
+				}
+			}
+
+			firstCol = false;
+		}
+	}
+
+	for ( cb = r->b; cb != NULL; cb = cb->next )
+	{
+		if ( cb->head == NULL )
+			continue;
+
+		cur = cb->head;
+		if ( cur->to_compute )
+			for ( ; cur != NULL; cur = cur->next )
+				data_recursive( cur, i );
+	}
+
+	if ( r->up == NULL )
+	{
+		for ( cv = cemetery; cv != NULL; cv = cv->next )
 		{
 			if ( cv->start <= i && cv->end >= i && ! is_nan( cv->data[ i - cv->start ] ) )
 			{
@@ -1543,9 +1600,9 @@ void result::data_recursive( object *r, int i )
 						fprintf( f, "%.*G\t", SIG_DIG, cv->data[ i - cv->start ] );
 				}
 			}
-			else
+			else					// save NaN as n/a
 			{
-				if ( dozip )		// save NaN as n/a
+				if ( dozip )
 				{
 					if ( docsv )
 						gzprintf( fz, "%s%s", firstCol ? "" : CSV_SEP, nonavail );
@@ -1557,67 +1614,808 @@ void result::data_recursive( object *r, int i )
 					if ( docsv )
 						fprintf( f, "%s%s", firstCol ? "" : CSV_SEP, nonavail );
 					else
-						fprintf( f, "%s\t", nonavail );
+						fprintf(f, "%s\t", nonavail );
 				}
 			}
 
-			firstCol = false;
-		}
-	}
+			firstCol = false;
+		}
+	}
+}
+
+
+/***************************************************
+COLUMNS
+Saves all data to a binary columnar (.lcr) file:
+- header: "LSDCOLR\0", version, flags (1=zlib
+  compressed columns), columns, rows, first time
+  step, all as 32-bit little-endian integers
+- directory: for each column, data offset and size
+  (64-bit), start and end time steps, name offset
+  and length in the names table (32-bit)
+- names table: "label lab_tit" of each column
+- data: one block per column, with the rows as raw
+  little-endian doubles (NaN if not available),
+  8-byte aligned, so uncompressed files can be
+  memory mapped, or a zlib stream per column
+***************************************************/
+#define LCR_VERSION 1
+#define LCR_DIR_SIZE 32
+
+static void put_u32( unsigned char *b, uint32_t x )
+{
+	for ( int k = 0; k < 4; ++k, x >>= 8 )
+		b[ k ] = x & 0xFF;
+}
+
+static void put_u64( unsigned char *b, uint64_t x )
+{
+	for ( int k = 0; k < 8; ++k, x >>= 8 )
+		b[ k ] = x & 0xFF;
+}
+
+static uint32_t get_u32( const unsigned char *b )
+{
+	return b[ 0 ] | b[ 1 ] << 8 | b[ 2 ] << 16 | ( uint32_t ) b[ 3 ] << 24;
+}
+
+static bool write_lcr( FILE *f, bool dozip, int initstep, int nrows, const vector < string > &labels, const vector < int > &starts, const vector < int > &ends, function < void( int j, vector < double > &col ) > fill_col )
+{
+	bool ok, swap;
+	char *names;
+	int i, j, k, ncols = labels.size( );
+	uint16_t one = 1;
+	uint64_t off, name_len, data_off;
+	unsigned char head[ 32 ], *dir;
+	vector < double > col;
+	vector < unsigned char > buf;
+
+	swap = ( *( unsigned char * ) & one != 1 );	// big-endian host?
+
+	name_len = 0;
+	for ( auto &lab : labels )
+		name_len += lab.size( );
+
+	memcpy( head, "LSDCOLR", 8 );
+	put_u32( head + 8, LCR_VERSION );
+	put_u32( head + 12, dozip ? 1 : 0 );
+	put_u32( head + 16, ncols );
+	put_u32( head + 20, nrows );
+	put_u32( head + 24, initstep );
+	put_u32( head + 28, 0 );
+
+	dir = new unsigned char[ ncols * LCR_DIR_SIZE + 1 ];
+	names = new char[ name_len + 1 ];
+
+	// data follow header, directory and names, aligned to 8 bytes
+	data_off = 32 + ncols * LCR_DIR_SIZE + name_len;
+	data_off = ( data_off + 7 ) & ~ ( uint64_t ) 7;
+
+	ok = fwrite( head, 1, 32, f ) == 32;
+	ok = ok && fseek( f, data_off, SEEK_SET ) == 0;	// directory and names written last
+
+	col.resize( nrows );
+	off = data_off;
+	name_len = 0;
+
+	for ( j = 0; ok && j < ncols; ++j )
+	{
+		// get the available data, NaN elsewhere
+		fill( col.begin( ), col.end( ), NAN );
+		fill_col( j, col );
+
+		if ( swap )
+			for ( i = 0; i < nrows; ++i )
+			{
+				unsigned char *c = ( unsigned char * ) & col[ i ];
+				for ( k = 0; k < 4; ++k )
+					std::swap( c[ k ], c[ 7 - k ] );
+			}
+
+		uLongf size = nrows * sizeof( double );
+
+		if ( dozip )
+		{
+			buf.resize( compressBound( size ) );
+			size = buf.size( );
+			ok = compress2( buf.data( ), & size, ( const Bytef * ) col.data( ), nrows * sizeof( double ), Z_DEFAULT_COMPRESSION ) == Z_OK &&
+				 fwrite( buf.data( ), 1, size, f ) == size;
+		}
+		else
+			ok = fwrite( col.data( ), 1, size, f ) == size;
+
+		put_u64( dir + j * LCR_DIR_SIZE, off );
+		put_u64( dir + j * LCR_DIR_SIZE + 8, size );
+		put_u32( dir + j * LCR_DIR_SIZE + 16, starts[ j ] );
+		put_u32( dir + j * LCR_DIR_SIZE + 20, ends[ j ] );
+		put_u32( dir + j * LCR_DIR_SIZE + 24, name_len );
+		put_u32( dir + j * LCR_DIR_SIZE + 28, labels[ j ].size( ) );
+		memcpy( names + name_len, labels[ j ].c_str( ), labels[ j ].size( ) );
+
+		name_len += labels[ j ].size( );
+		off += size;
+
+		// keep uncompressed columns 8-byte aligned
+		if ( off % 8 != 0 )
+		{
+			static const char pad[ 8 ] = { 0 };
+			ok = ok && fwrite( pad, 1, 8 - off % 8, f ) == 8 - off % 8;
+			off += 8 - off % 8;
+		}
+	}
+
+	ok = ok && fseek( f, 32, SEEK_SET ) == 0;
+	ok = ok && fwrite( dir, 1, ncols * LCR_DIR_SIZE, f ) == ( size_t ) ncols * LCR_DIR_SIZE;
+	ok = ok && fwrite( names, 1, name_len, f ) == name_len;
+
+	delete [ ] dir;
+	delete [ ] names;
+
+	return ok && ! ferror( f );
+}
+
+bool result::columns( object *root, int initstep, int endtstep )
+{
+	bool ok;
+	vector < int > starts, ends;
+	vector < string > labels;
+	vector < variable * > cols;
+
+	if ( f == NULL )
+		return false;
+
+	columns_recursive( root, cols );
+
+	for ( auto cv : cols )
+	{
+		labels.push_back( string( cv->label ) + " " + cv->lab_tit );
+		starts.push_back( cv->start );
+		ends.push_back( cv->end );
+	}
+
+	ok = write_lcr( f, dozip, initstep, endtstep - initstep + 1, labels, starts, ends,
+			   [ & ]( int j, vector < double > &col )
+	{
+		// copy the available contiguous block of data
+		variable *cv = cols[ j ];
+		int from = max( initstep, cv->start );
+		int to = min( endtstep, cv->end );
+
+		if ( cv->data != NULL && from <= to )
+			memcpy( & col[ from - initstep ], cv->data + ( from - cv->start ), ( to - from + 1 ) * sizeof( double ) );
+	} );
+
+	// close now to catch buffered write errors
+	ok = fclose( f ) == 0 && ok;
+	f = NULL;
+
+	return ok;
+}
+
+void result::columns_recursive( object *r, vector < variable * > &cols )
+{
+	bridge *cb;
+	object *cur;
+	variable *cv;
+
+	for ( cv = r->v; cv != NULL; cv = cv->next )
+		if ( cv->save == 1 )
+		{
+			set_lab_tit( cv );
+			cols.push_back( cv );
+		}
+
+	for ( cb = r->b; cb != NULL; cb = cb->next )
+	{
+		if ( cb->head == NULL )
+			continue;
+
+		cur = cb->head;
+		if ( cur->to_compute )
+			for ( ; cur != NULL; cur = cur->next )
+				columns_recursive( cur, cols );
+	}
+
+	if ( r->up == NULL )
+		for ( cv = cemetery; cv != NULL; cv = cv->next )
+			cols.push_back( cv );
+}
+
+
+/***************************************************
+STREAMING RESULTS
+In streaming mode (-w), saved series keep only a
+window of periods in memory (see variable::saved),
+initially STREAM_WIN and doubled as larger lags are
+requested (see stream_grow). Every STREAM_WIN / 2
+periods the values older than half of each series'
+window are handed to a background writer thread, through a ring buffer,
+which appends them to a spool (.lcs) file. The writer thread sleeps while
+the buffer is empty, and the producers while it is full:
+- header: "LSDCOLS\0", version (32-bit)
+- 'S' records: series id and start time step
+- 'D' records: series id, first time step, number
+  of values and the values (host byte order)
+- 'E' records: series id, end time step, live flag
+  (0 if object was deleted), name length and name
+- 'Z' record: end of run
+At the end of the run, the spool is converted to a
+regular binary columnar (.lcr) results file and
+removed. Series in objects deleted during the run
+are written at deletion and are not kept in the
+cemetery.
+***************************************************/
+#define LCS_VERSION 1
+
+FILE *stream_f = NULL;					// streamed series spool file
+int stream_last;						// last period of periodic flushing
+string stream_name;						// spool file name
+vector < int > stream_done;				// last period flushed by series id
+vector < variable * > stream_vars;		// live streamed series by series id
+
+#ifndef _NP_
+atomic < bool > stream_stop;			// signal writer thread to finish
+atomic < size_t > stream_head;			// ring buffer write position (producer)
+atomic < size_t > stream_tail;			// ring buffer read position (writer)
+char *stream_buf = NULL;				// ring buffer to writer thread
+condition_variable stream_data;			// ring buffer not empty (or stop)
+condition_variable stream_room;			// ring buffer not full (or drained)
+mutex lock_ring;						// lock for ring buffer waits
+mutex lock_stream;						// serialize producer threads
+thread stream_thr;						// writer thread
+
+// write to the spool file whatever is in the ring buffer
+void stream_writer( void )
+{
+	size_t head, tail, k;
+
+	while ( true )
+	{
+		tail = stream_tail.load( memory_order_relaxed );
+		head = stream_head.load( memory_order_acquire );
+
+		if ( head == tail )
+		{
+			unique_lock < mutex > lock( lock_ring );
+			stream_data.wait( lock, [ tail ] { return stream_stop || stream_head.load( memory_order_acquire ) != tail; } );
+
+			if ( stream_head.load( memory_order_acquire ) == tail )
+				break;					// stopped with nothing left
+
+			continue;
+		}
+
+		k = min( head - tail, ( size_t ) STREAM_RING - tail % STREAM_RING );
+		fwrite( stream_buf + tail % STREAM_RING, 1, k, stream_f );
+
+		{
+			lock_guard < mutex > lock( lock_ring );
+			stream_tail.store( tail + k, memory_order_release );
+		}
+		stream_room.notify_all( );
+	}
+}
+
+// wait the writer thread to empty the ring buffer
+static void stream_drain( void )
+{
+	unique_lock < mutex > lock( lock_ring );
+	stream_room.wait( lock, [ ] { return stream_tail.load( memory_order_acquire ) == stream_head.load( memory_order_acquire ); } );
+}
+#endif
+
+// hand bytes to the writer thread, waiting if ring buffer is full
+static void stream_put( const void *p, size_t n )
+{
+#ifndef _NP_
+	const char *c = ( const char * ) p;
+	size_t head, k;
+
+	while ( n > 0 )
+	{
+		head = stream_head.load( memory_order_relaxed );
+		k = STREAM_RING - ( head - stream_tail.load( memory_order_acquire ) );
+
+		if ( k == 0 )
+		{
+			unique_lock < mutex > lock( lock_ring );
+			stream_room.wait( lock, [ head ] { return head - stream_tail.load( memory_order_acquire ) < STREAM_RING; } );
+			continue;
+		}
+
+		k = min( { n, k, ( size_t ) STREAM_RING - head % STREAM_RING } );
+		memcpy( stream_buf + head % STREAM_RING, c, k );
+
+		{
+			lock_guard < mutex > lock( lock_ring );
+			stream_head.store( head + k, memory_order_release );
+		}
+		stream_data.notify_one( );
+
+		c += k;
+		n -= k;
+	}
+#else
+	fwrite( p, 1, n, stream_f );
+#endif
+}
+
+// write series values up to time step 'to' not yet flushed
+static void stream_flush( int id, int to )
+{
+	int i, n, from = stream_done[ id ] + 1;
+	unsigned char rec[ 13 ];
+	vector < double > vals;
+	variable *cv = stream_vars[ id ];
+
+	if ( cv == NULL || from > to )
+		return;
+
+	n = to - from + 1;
+	vals.resize( n );
+	rec[ 0 ] = 'D';
+	put_u32( rec + 1, id );
+	put_u32( rec + 5, from );
+	put_u32( rec + 9, n );
+	stream_put( rec, 13 );
+
+	for ( i = 0; i < n; ++i )			// at most a window of values
+		vals[ i ] = cv->saved( from + i );
+
+	stream_put( vals.data( ), n * sizeof( double ) );
+
+	stream_done[ id ] = to;
+}
+
+// write series end record and stop streaming it
+static void stream_end( int id, bool live )
+{
+	unsigned char rec[ 14 ];
+	variable *cv = stream_vars[ id ];
+
+	stream_flush( id, cv->end );
+
+	rec[ 0 ] = 'E';
+	put_u32( rec + 1, id );
+	put_u32( rec + 5, cv->end );
+	rec[ 9 ] = live ? 1 : 0;
+	put_u32( rec + 10, strlen( cv->label ) + 1 + strlen( cv->lab_tit ) );
+	stream_put( rec, 14 );
+	stream_put( cv->label, strlen( cv->label ) );
+	stream_put( " ", 1 );
+	stream_put( cv->lab_tit, strlen( cv->lab_tit ) );
+
+	stream_vars[ id ] = NULL;
+	cv->stream_id = -1;
+}
+
+// live series in the same order as result::columns
+static void stream_cols( object *r, vector < variable * > &cols )
+{
+	bridge *cb;
+	object *cur;
+	variable *cv;
+
+	for ( cv = r->v; cv != NULL; cv = cv->next )
+		if ( cv->save == 1 && cv->stream_id >= 0 )
+		{
+			set_lab_tit( cv );
+			cols.push_back( cv );
+		}
+
+	for ( cb = r->b; cb != NULL; cb = cb->next )
+	{
+		if ( cb->head == NULL )
+			continue;
+
+		cur = cb->head;
+		if ( cur->to_compute )
+			for ( ; cur != NULL; cur = cur->next )
+				stream_cols( cur, cols );
+	}
+}
+
+// convert the spool file to a binary columnar (.lcr) file
+static bool stream_convert( const char *fname )
+{
+	bool ok;
+	char tag = 0;
+	int id, from, n;
+	unsigned char rec[ 12 ];
+	uint32_t len;
+	FILE *f, *fo;
+	struct chunkT { long off; int from, n; };
+	vector < int > starts, ends, order[ 2 ];
+	vector < string > labels, names;
+	vector < vector < chunkT > > chunks;
+
+	f = fopen( stream_name.c_str( ), "rb" );
+	if ( f == NULL || fread( rec, 1, 12, f ) != 12 || memcmp( rec, "LSDCOLS", 8 ) != 0 )
+	{
+		if ( f != NULL )
+			fclose( f );
+		return false;
+	}
+
+	// index the spool records (values stay on disk)
+	while ( fread( & tag, 1, 1, f ) == 1 && tag != 'Z' )
+	{
+		if ( fread( rec, 1, 8, f ) != 8 )
+			break;
+
+		id = get_u32( rec );
+		if ( id < 0 || ( tag == 'S' ? id != ( int ) starts.size( ) : id >= ( int ) starts.size( ) ) )
+			break;
+
+		switch ( tag )
+		{
+			case 'S':
+				starts.push_back( get_u32( rec + 4 ) );
+				ends.push_back( 0 );
+				names.push_back( "" );
+				chunks.resize( id + 1 );
+				continue;
+
+			case 'D':
+				if ( fread( rec, 1, 4, f ) != 4 )
+					break;
+				from = get_u32( rec + 4 );
+				n = get_u32( rec );
+				chunks[ id ].push_back( { ftell( f ), from, n } );
+				fseek( f, n * sizeof( double ), SEEK_CUR );
+				continue;
+
+			case 'E':
+				ends[ id ] = get_u32( rec + 4 );
+				if ( fread( rec, 1, 5, f ) != 5 )
+					break;
+				len = get_u32( rec + 1 );
+				names[ id ].resize( len );
+				if ( fread( & names[ id ][ 0 ], 1, len, f ) != len )
+					break;
+				order[ rec[ 0 ] ? 0 : 1 ].push_back( id );
+				continue;
+		}
+
+		break;							// invalid record
+	}
+
+	if ( tag != 'Z' || ( fo = fopen( fname, "wb" ) ) == NULL )
+	{
+		fclose( f );
+		return false;
+	}
+
+	// live series first, then the ones in deleted objects, as in .res files
+	order[ 0 ].insert( order[ 0 ].end( ), order[ 1 ].begin( ), order[ 1 ].end( ) );
+
+	vector < int > cstart, cend;
+	for ( auto i : order[ 0 ] )
+	{
+		labels.push_back( names[ i ] );
+		cstart.push_back( starts[ i ] );
+		cend.push_back( ends[ i ] );
+	}
+
+	ok = write_lcr( fo, dozip, 0, actual_steps + 1, labels, cstart, cend,
+			   [ & ]( int j, vector < double > &col )
+	{
+		for ( auto &c : chunks[ order[ 0 ][ j ] ] )
+		{
+			int from = max( 0, c.from ), to = min( actual_steps, c.from + c.n - 1 );
+
+			if ( from <= to )
+			{
+				fseek( f, c.off + ( from - c.from ) * sizeof( double ), SEEK_SET );
+				if ( fread( & col[ from ], sizeof( double ), to - from + 1, f ) != ( size_t ) ( to - from + 1 ) )
+					break;
+			}
+		}
+	} );
+
+	ok = fclose( fo ) == 0 && ok;
+	fclose( f );
+
+	return ok;
+}
+
+
+/***************************************************
+STREAM_OPEN
+Create the spool file and start the writer thread
+***************************************************/
+bool stream_open( const char *fname )
+{
+	unsigned char head[ 12 ];
+
+	stream_close( NULL, NULL );			// just in case
+
+	stream_f = fopen( fname, "wb" );
+	if ( stream_f == NULL )
+		return false;
+
+	stream_name = fname;
+	stream_last = 0;
+	stream_done.clear( );
+	stream_vars.clear( );
+
+	memcpy( head, "LSDCOLS", 8 );
+	put_u32( head + 8, LCS_VERSION );
+
+#ifndef _NP_
+	if ( stream_buf == NULL )
+		stream_buf = new char[ STREAM_RING ];
+
+	stream_head = stream_tail = 0;
+	stream_stop = false;
+	stream_thr = thread( stream_writer );
+#endif
+
+	stream_put( head, 12 );
+
+	return true;
+}
+
+
+/***************************************************
+STREAM_ADD
+Register a saved series for streaming
+***************************************************/
+void stream_add( variable *v )
+{
+	unsigned char rec[ 9 ];
+
+	if ( stream_f == NULL )
+		return;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_stream );
+#endif
+
+	v->stream_id = stream_vars.size( );
+	stream_vars.push_back( v );
+	stream_done.push_back( v->start - 1 );
+
+	rec[ 0 ] = 'S';
+	put_u32( rec + 1, v->stream_id );
+	put_u32( rec + 5, v->start );
+	stream_put( rec, 9 );
+}
+
+
+/***************************************************
+STREAM_DROP
+Write all remaining values of a series in an object
+being deleted
+***************************************************/
+void stream_drop( variable *v )
+{
+	if ( stream_f == NULL || v->stream_id < 0 )
+		return;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_stream );
+#endif
+
+	stream_end( v->stream_id, false );
+}
+
+
+/***************************************************
+STREAM_STEP
+Flush the values which are leaving the in-memory
+window, every half window, after time step t
+***************************************************/
+void stream_step( void )
+{
+	if ( stream_f == NULL || t - stream_last < STREAM_WIN / 2 )
+		return;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_stream );
+#endif
+
+	for ( int id = 0; id < ( int ) stream_vars.size( ); ++id )
+		if ( stream_vars[ id ] != NULL )
+			stream_flush( id, t - stream_vars[ id ]->win / 2 );
+
+	stream_last = t;
+}
+
+
+/***************************************************
+STREAM_GROW
+Enlarge the in-memory window of a streamed series
+to hold lag past periods, reading back from the
+spool file the periods already written to disk.
+Must be called holding the streaming lock (see
+stream_read). Return false if the window cannot
+be enlarged
+***************************************************/
+bool stream_grow( variable *v, int lag )
+{
+	char tag;
+	int i, id, from, n, win, first, last;
+	unsigned char rec[ 12 ];
+	double *data;
+	vector < double > vals;
+	FILE *f;
+
+	if ( stream_f == NULL || v->stream_id < 0 || v->win == 0 )
+		return false;
+
+#ifndef _NP_
+	stream_drain( );
+#endif
+	fflush( stream_f );
+
+	for ( win = v->win; win <= lag; win *= 2 );
+
+	data = ( double * ) malloc( win * sizeof( double ) );
+	if ( data == NULL )
+		return false;
+
+	// periods still in memory
+	last = min( t, v->end );
+	for ( i = max( v->start, last - v->win + 1 ); i <= last; ++i )
+		data[ ( i - v->start ) % win ] = v->saved( i );
+
+	// periods in the new window only on disk
+	first = max( v->start, last - win + 1 );
+	last -= v->win;
+
+	f = fopen( stream_name.c_str( ), "rb" );
+	if ( f == NULL || fread( rec, 1, 12, f ) != 12 )
+	{
+		if ( f != NULL )
+			fclose( f );
+		free( data );
+		return false;
+	}
+
+	while ( fread( & tag, 1, 1, f ) == 1 && tag != 'Z' && fread( rec, 1, 8, f ) == 8 )
+	{
+		if ( tag == 'S' )
+			continue;
+
+		if ( tag == 'E' )
+		{
+			if ( fread( rec, 1, 5, f ) != 5 )
+				break;
+			fseek( f, get_u32( rec + 1 ), SEEK_CUR );
+			continue;
+		}
+
+		if ( tag != 'D' || fread( rec + 8, 1, 4, f ) != 4 )
+			break;
+
+		id = get_u32( rec );
+		from = get_u32( rec + 4 );
+		n = get_u32( rec + 8 );
+
+		if ( id != v->stream_id || from > last || from + n - 1 < first )
+		{
+			fseek( f, n * sizeof( double ), SEEK_CUR );
+			continue;
+		}
+
+		vals.resize( n );
+		if ( fread( vals.data( ), sizeof( double ), n, f ) != ( size_t ) n )
+			break;
+
+		for ( i = max( from, first ); i <= min( from + n - 1, last ); ++i )
+			data[ ( i - v->start ) % win ] = vals[ i - from ];
+	}
+
+	fclose( f );
+
+	free( v->data );
+	v->data = data;
+	v->win = win;
+
+	return true;
+}
+
+
+/***************************************************
+STREAM_READ
+Get the saved value of a series in period time,
+enlarging the in-memory window of streamed series
+if required. Streamed series are read holding the
+streaming lock, so their window cannot be replaced
+meanwhile by another thread.
+Return false if the value is not available
+***************************************************/
+bool stream_read( variable *v, int time, double &value )
+{
+#ifndef _NP_
+	unique_lock < mutex > lock( lock_stream, defer_lock );
+	if ( v->stream_id >= 0 )
+		lock.lock( );
+#endif
+	if ( v->win > 0 && t - time >= v->win && ! stream_grow( v, t - time ) )
+		return false;
+
+	value = v->saved( time );
+	return true;
+}
+
 
-	for ( cb = r->b; cb != NULL; cb = cb->next )
+/***************************************************
+STREAM_WRITE
+Rewrite the saved value of a series in a past
+period time, holding the streaming lock for
+streamed series as in stream_read.
+Return false if the period was already written to
+disk
+***************************************************/
+bool stream_write( variable *v, int time, double value )
+{
+#ifndef _NP_
+	unique_lock < mutex > lock( lock_stream, defer_lock );
+	if ( v->stream_id >= 0 )
+		lock.lock( );
+#endif
+	// streamed periods older than half window may be already on disk
+	if ( v->win > 0 && time <= t - v->win / 2 )
+		return false;
+
+	v->saved( time ) = value;
+	return true;
+}
+
+
+/***************************************************
+STREAM_CLOSE
+Flush the remaining values of live series, stop
+the writer thread and, if fname is not NULL,
+convert the spool file into the .lcr file fname
+(the spool file is always removed)
+***************************************************/
+void stream_close( object *r, const char *fname )
+{
+	vector < variable * > cols;
+
+	if ( stream_f == NULL )
+		return;
+
+	if ( r != NULL && fname != NULL )
 	{
-		if ( cb->head == NULL )
-			continue;
+#ifndef _NP_
+		lock_guard < mutex > lock( lock_stream );
+#endif
+		stream_cols( r, cols );
 
-		cur = cb->head;
-		if ( cur->to_compute )
-			for ( ; cur != NULL; cur = cur->next )
-				data_recursive( cur, i );
+		for ( auto cv : cols )
+			stream_end( cv->stream_id, true );
+
+		stream_put( "Z", 1 );
 	}
 
-	if ( r->up == NULL )
+#ifndef _NP_
 	{
-		for ( cv = cemetery; cv != NULL; cv = cv->next )
-		{
-			if ( cv->start <= i && cv->end >= i && ! is_nan( cv->data[ i - cv->start ] ) )
-			{
-				if ( dozip )
-				{
-					if ( docsv )
-						gzprintf( fz, "%s%.*G", firstCol ? "" : CSV_SEP, SIG_DIG, cv->data[ i - cv->start ] );
-					else
-						gzprintf( fz, "%.*G\t", SIG_DIG, cv->data[ i - cv->start ] );
-				}
-				else
-				{
-					if ( docsv )
-						fprintf( f, "%s%.*G", firstCol ? "" : CSV_SEP, SIG_DIG, cv->data[ i - cv->start ] );
-					else
-						fprintf( f, "%.*G\t", SIG_DIG, cv->data[ i - cv->start ] );
-				}
-			}
-			else					// save NaN as n/a
-			{
-				if ( dozip )
-				{
-					if ( docsv )
-						gzprintf( fz, "%s%s", firstCol ? "" : CSV_SEP, nonavail );
-					else
-						gzprintf( fz, "%s\t", nonavail );
-				}
-				else
-				{
-					if ( docsv )
-						fprintf( f, "%s%s", firstCol ? "" : CSV_SEP, nonavail );
-					else
-						fprintf(f, "%s\t", nonavail );
-				}
-			}
-
-			firstCol = false;
-		}
+		lock_guard < mutex > lock( lock_ring );
+		stream_stop = true;
 	}
+	stream_data.notify_one( );
+	stream_thr.join( );
+#endif
+
+	fclose( stream_f );
+	stream_f = NULL;
+
+	// unregister any series not saved
+	for ( auto cv : stream_vars )
+		if ( cv != NULL )
+			cv->stream_id = -1;
+
+	stream_vars.clear( );
+	stream_done.clear( );
+
+	if ( fname != NULL && ! stream_convert( fname ) )
+		plog( "\nWarning: cannot convert streamed results to file '%s'\n", fname );
+
+	remove( stream_name.c_str( ) );
 }
 
 
@@ -1732,11 +2530,12 @@ void result::title_recursive( object *r, int header )
 CONSTRUCTOR
 Open the appropriate file for saving the results
 ***************************************************/
-result::result( const char *fname, const char *fmode, bool dozip, bool docsv )
+result::result( const char *fname, const char *fmode, bool dozip, bool docsv, bool dobin )
 {
+	this->dobin = dobin;
 	this->docsv = docsv;
 	this->dozip = dozip;		// save local class flag
-	if ( dozip )
+	if ( dozip && ! dobin )		// binary files compress by column
 		fz = gzopen( fname, fmode );
 	else
 		f = fopen( fname, fmode );
@@ -1749,10 +2548,11 @@ Close the results file
 ***************************************************/
 result::~result( void )
 {
-	if ( dozip )
+	if ( dozip && ! dobin )
 		gzclose( fz );
 	else
-		fclose( f );
+		if ( f != NULL )
+			fclose( f );
 }
 
 
@@ -1798,3 +2598,502 @@ int count_lines( const char *fname, bool dozip )
 
 	return n;
 }
+
+
+/***************************************************
+CHECKPOINTS
+Save and restore the complete state of a run after
+a time step, to resume it later (options -k and -y)
+in a zlib-compressed binary (.lck) file, in host byte
+order:
+- header: "LSDCKPT\0", version, byte order mark
+- run: configuration name, seed, last time step,
+  object and network node serials, engine flags,
+  generators state, rolling windows and
+  parameter indexes setup
+- objects: recursively from root, the label,
+  serial, counters, hooks (by serial), variables
+  (lags, updating control, counter-based draws,
+  rolling sums and saved series up to the time step)
+  and the number of instances and the contents of
+  each descendant object type
+- cemetery: saved series of deleted objects
+The structure is matched against the loaded
+configuration, adding or deleting object instances
+as needed, so the configuration must be the same
+(other than the number of time steps). Network and
+C++ extension data are not saved.
+***************************************************/
+#define LCK_VERSION 3
+#define LCK_BOM 0x01020304
+
+void ( *restore_func )( void ) = NULL;	// set by RESTORE_SIM( ) in the model
+gzFile ckpt_f;							// checkpoint file
+bool ckpt_ok;							// no error reading/writing checkpoint
+bool ckpt_ext;							// unsaved network/extension data found
+
+static void ckpt_put( const void *p, size_t n )
+{
+	if ( ckpt_ok && n > 0 && gzwrite( ckpt_f, p, n ) != ( int ) n )
+		ckpt_ok = false;
+}
+
+template < class T > static void ckpt_put( T x )
+{
+	ckpt_put( & x, sizeof( T ) );
+}
+
+static void ckpt_put_str( const char *s )
+{
+	ckpt_put( ( uint32_t ) strlen( s ) );
+	ckpt_put( s, strlen( s ) );
+}
+
+static void ckpt_get( void *p, size_t n )
+{
+	if ( ckpt_ok && n > 0 && gzread( ckpt_f, p, n ) != ( int ) n )
+		ckpt_ok = false;
+}
+
+template < class T > static T ckpt_get( void )
+{
+	T x = T( );
+	ckpt_get( & x, sizeof( T ) );
+	return x;
+}
+
+static string ckpt_get_str( void )
+{
+	uint32_t n = ckpt_get < uint32_t > ( );
+	string s;
+
+	if ( ! ckpt_ok || n > MAX_BUFF_SIZE * 100 )
+	{
+		ckpt_ok = false;
+		return s;
+	}
+
+	s.resize( n );
+	ckpt_get( & s[ 0 ], n );
+	return s;
+}
+
+static void ckpt_save_var( variable *v )
+{
+	int n;
+
+	ckpt_put_str( v->label );
+	ckpt_put( ( int32_t ) v->param );
+	ckpt_put( ( int32_t ) v->num_lag );
+	ckpt_put( ( int32_t ) v->head );
+	ckpt_put( ( int32_t ) v->last_update );
+	ckpt_put( ( int32_t ) v->next_update );
+	ckpt_put( ( int32_t ) v->rnd_t );
+	ckpt_put( ( uint32_t ) v->rnd_cnt );
+	ckpt_put( ( int32_t ) v->roll_k );
+	ckpt_put( ( int32_t ) v->roll_cnt );
+	ckpt_put( v->roll_sum, 2 * sizeof( double ) );
+
+	ckpt_put( ( uint8_t ) ( v->val != NULL && v->num_lag >= 0 ) );
+	if ( v->val != NULL && v->num_lag >= 0 )
+		ckpt_put( v->val, ( v->num_lag + 1 ) * sizeof( double ) );
+
+	// saved series up to the current time step
+	if ( ( v->save || v->savei ) && v->data != NULL && v->win == 0 )
+		n = max( min( t, v->end ) - v->start + 1, 0 );
+	else
+		n = 0;
+
+	ckpt_put( ( int32_t ) v->start );
+	ckpt_put( ( int32_t ) n );
+	ckpt_put( v->data, n * sizeof( double ) );
+}
+
+static void ckpt_save_obj( object *r )
+{
+	uint32_t n;
+	bridge *cb;
+	object *cur;
+	variable *cv;
+
+	ckpt_put_str( r->label );
+	ckpt_put( ( int64_t ) r->serial );
+	ckpt_put( ( int32_t ) r->acounter );
+	ckpt_put( ( int32_t ) r->lstCntUpd );
+	ckpt_put( ( uint8_t ) r->to_compute );
+	ckpt_put( ( int64_t ) ( r->hook != NULL ? r->hook->serial : 0 ) );
+	ckpt_put( ( uint32_t ) r->hooks.size( ) );
+	for ( auto h : r->hooks )
+		ckpt_put( ( int64_t ) ( h != NULL ? h->serial : 0 ) );
+
+	if ( r->node != NULL || r->cext != NULL )
+		ckpt_ext = true;
+
+	for ( n = 0, cv = r->v; cv != NULL; cv = cv->next, ++n );
+	ckpt_put( n );
+	for ( cv = r->v; cv != NULL; cv = cv->next )
+		ckpt_save_var( cv );
+
+	for ( n = 0, cb = r->b; cb != NULL; cb = cb->next, ++n );
+	ckpt_put( n );
+	for ( cb = r->b; cb != NULL; cb = cb->next )
+	{
+		ckpt_put_str( cb->blabel );
+		for ( n = 0, cur = cb->head; cur != NULL; cur = cur->next, ++n );
+		ckpt_put( n );
+		for ( cur = cb->head; cur != NULL; cur = cur->next )
+			ckpt_save_obj( cur );
+	}
+}
+
+static bool ckpt_load_var( object *r )
+{
+	int n, start;
+	string lab = ckpt_get_str( );
+	variable *v = r->v_map.find( lab_id( lab.c_str( ) ) );
+
+	if ( ! ckpt_ok || v == NULL )
+	{
+		plog( "\nError: variable '%s' not found in object '%s'\n", lab.c_str( ), r->label );
+		return false;
+	}
+
+	v->param = ckpt_get < int32_t > ( );
+	n = ckpt_get < int32_t > ( );
+	v->head = ckpt_get < int32_t > ( );
+	v->last_update = ckpt_get < int32_t > ( );
+	v->next_update = ckpt_get < int32_t > ( );
+	v->rnd_t = ckpt_get < int32_t > ( );
+	v->rnd_cnt = ckpt_get < uint32_t > ( );
+	v->roll_k = ckpt_get < int32_t > ( );
+	v->roll_cnt = ckpt_get < int32_t > ( );
+	ckpt_get( v->roll_sum, 2 * sizeof( double ) );
+
+	if ( n != v->num_lag )
+	{
+		plog( "\nError: variable '%s' has %d lag(s) in checkpoint and %d in configuration\n", v->label, n, v->num_lag );
+		return false;
+	}
+
+	if ( ckpt_get < uint8_t > ( ) )
+	{
+		if ( v->val == NULL )
+			return ckpt_ok = false;
+
+		ckpt_get( v->val, ( n + 1 ) * sizeof( double ) );
+	}
+
+	start = ckpt_get < int32_t > ( );
+	n = ckpt_get < int32_t > ( );
+
+	if ( n > 0 )
+	{
+		if ( start + n - 1 > max_step )
+		{
+			plog( "\nError: checkpoint has more time steps than configuration (%d)\n", max_step );
+			return false;
+		}
+
+		// use C stdlib to be able to deallocate memory for deleted objects
+		free( v->data );
+		v->data = ( double * ) malloc( ( max_step - start + 1 ) * sizeof( double ) );
+		if ( v->data == NULL )
+			return ckpt_ok = false;
+
+		v->start = start;
+		v->end = max_step;
+		v->win = 0;
+		ckpt_get( v->data, n * sizeof( double ) );
+	}
+	else
+		if ( ( v->save || v->savei ) && v->data != NULL )
+			for ( n = v->start; n <= t && n <= v->end; ++n )
+				v->saved( n ) = NAN;		// not saved when checkpointed
+
+	return ckpt_ok;
+}
+
+static bool ckpt_load_obj( object *r, unordered_map < long, object * > &serials, vector < pair < object *, vector < int64_t > > > &hooks )
+{
+	uint32_t i, m, n, nb;
+	bridge *cb;
+	object *cur, *ex;
+	string lab = ckpt_get_str( );
+	vector < int64_t > hk;
+
+	if ( ! ckpt_ok || lab != r->label )
+	{
+		plog( "\nError: object '%s' does not match '%s' in checkpoint\n", r->label, lab.c_str( ) );
+		return false;
+	}
+
+	r->serial = ckpt_get < int64_t > ( );
+	r->acounter = ckpt_get < int32_t > ( );
+	r->lstCntUpd = ckpt_get < int32_t > ( );
+	r->to_compute = ckpt_get < uint8_t > ( );
+	serials[ r->serial ] = r;
+
+	hk.push_back( ckpt_get < int64_t > ( ) );
+	for ( n = ckpt_get < uint32_t > ( ), i = 0; ckpt_ok && i < n; ++i )
+		hk.push_back( ckpt_get < int64_t > ( ) );
+
+	hooks.push_back( make_pair( r, hk ) );
+
+	for ( n = ckpt_get < uint32_t > ( ), i = 0; ckpt_ok && i < n; ++i )
+		if ( ! ckpt_load_var( r ) )
+			return false;
+
+	for ( nb = ckpt_get < uint32_t > ( ); ckpt_ok && nb > 0; --nb )
+	{
+		lab = ckpt_get_str( );
+		n = ckpt_get < uint32_t > ( );
+
+		if ( ! ckpt_ok || ( cb = r->search_bridge( lab.c_str( ), true ) ) == NULL )
+		{
+			plog( "\nError: object '%s' not found in '%s'\n", lab.c_str( ), r->label );
+			return false;
+		}
+
+		// match the number of instances
+		for ( m = 0, cur = cb->head; cur != NULL; cur = cur->next, ++m );
+
+		if ( n > m )
+		{
+			ex = cb->head != NULL ? cb->head : blueprint->search( lab.c_str( ) );
+			if ( ex == NULL || r->add_n_objects2( lab.c_str( ), n - m, ex ) == NULL )
+				return false;
+		}
+
+		for ( ; m > n; --m )
+		{
+			for ( cur = cb->head; cur->next != NULL; cur = cur->next );
+			cur->delete_obj( );
+		}
+
+		for ( cur = cb->head; ckpt_ok && cur != NULL; cur = cur->next )
+			if ( ! ckpt_load_obj( cur, serials, hooks ) )
+				return false;
+	}
+
+	return ckpt_ok;
+}
+
+
+/***************************************************
+CKPT_SAVE
+Save the state of the current run after time step t
+to a checkpoint file (written to a temporary file,
+flushed to disk and then renamed over the previous
+checkpoint, to be safe if interrupted)
+***************************************************/
+bool ckpt_save( const char *fname )
+{
+	uint32_t n;
+	string tmp = string( fname ) + ".tmp";
+	variable *cv;
+
+	if ( ( ckpt_f = gzopen( tmp.c_str( ), "wb1" ) ) == Z_NULL )
+		return false;
+
+	ckpt_ok = true;
+	ckpt_ext = false;
+
+	ckpt_put( "LSDCKPT", 8 );
+	ckpt_put( ( uint32_t ) LCK_VERSION );
+	ckpt_put( ( uint32_t ) LCK_BOM );
+
+	ckpt_put_str( clean_file( simul_name ) );
+	ckpt_put( ( uint32_t ) ( seed - 1 ) );
+	ckpt_put( ( int32_t ) t );
+	ckpt_put( ( int64_t ) objSerial );
+	ckpt_put( ( int64_t ) nodesSerial );
+	ckpt_put( ( uint8_t ) no_saved );
+	ckpt_put( ( uint8_t ) no_search );
+	ckpt_put( ( uint8_t ) no_zero_instance );
+	ckpt_put( ( uint8_t ) use_nan );
+	ckpt_put_str( random_state( ).c_str( ) );
+
+	ckpt_put( ( uint32_t ) roll_wins.size( ) );
+	for ( auto &w : roll_wins )
+	{
+		ckpt_put_str( lab_name( w.first ) );
+		ckpt_put( ( int32_t ) w.second );
+	}
+
+	ckpt_put( ( uint32_t ) idx_pars.size( ) );
+	for ( auto id : idx_pars )
+		ckpt_put_str( lab_name( id ) );
+
+	ckpt_save_obj( root );
+
+	for ( n = 0, cv = cemetery; cv != NULL; cv = cv->next, ++n );
+	ckpt_put( n );
+	for ( cv = cemetery; cv != NULL; cv = cv->next )
+	{
+		ckpt_put_str( cv->label );
+		ckpt_put_str( cv->lab_tit != NULL ? cv->lab_tit : "" );
+		ckpt_put( ( uint8_t ) cv->save );
+		ckpt_put( ( uint8_t ) cv->savei );
+		ckpt_put( ( int32_t ) cv->start );
+		ckpt_put( ( int32_t ) cv->end );
+		ckpt_put( cv->data, ( cv->end - cv->start + 1 ) * sizeof( double ) );
+	}
+
+	ckpt_put( "END", 4 );
+
+	if ( gzclose( ckpt_f ) != Z_OK )
+		ckpt_ok = false;
+
+#ifndef _WIN32
+	// make sure the data is on disk before replacing the previous checkpoint
+	int fd = open( tmp.c_str( ), O_RDONLY );
+	if ( fd < 0 || fsync( fd ) != 0 )
+		ckpt_ok = false;
+	if ( fd >= 0 )
+		close( fd );
+#endif
+
+	if ( ! ckpt_ok || rename( tmp.c_str( ), fname ) != 0 )
+	{
+		remove( tmp.c_str( ) );
+		return false;
+	}
+
+	if ( ckpt_ext )
+		plog( "\nWarning: network and C++ extension data are not saved in checkpoints\n" );
+
+	return true;
+}
+
+
+/***************************************************
+CKPT_LOAD
+Restore the state of a run from a checkpoint file,
+after the configuration was loaded and the run set
+up, so the run continues from the next time step
+***************************************************/
+bool ckpt_load( const char *fname )
+{
+	bool zero_inst = no_zero_instance;
+	char magic[ 8 ], end[ 4 ];
+	int i, last;
+	uint32_t n;
+	unsigned run_seed;
+	long obj_serial, node_serial;
+	bool flags[ 4 ];
+	string name, rnd, lab;
+	variable *cv;
+	unordered_map < long, object * > serials;
+	vector < pair < object *, vector < int64_t > > > hooks;
+
+	if ( ( ckpt_f = gzopen( fname, "rb" ) ) == Z_NULL )
+	{
+		plog( "\nError: cannot open checkpoint file '%s'\n", fname );
+		return false;
+	}
+
+	ckpt_ok = true;
+
+	ckpt_get( magic, 8 );
+	if ( ! ckpt_ok || memcmp( magic, "LSDCKPT", 8 ) || ckpt_get < uint32_t > ( ) != LCK_VERSION || ckpt_get < uint32_t > ( ) != LCK_BOM )
+	{
+		plog( "\nError: invalid or incompatible checkpoint file '%s'\n", fname );
+		gzclose( ckpt_f );
+		return false;
+	}
+
+	name = ckpt_get_str( );
+	run_seed = ckpt_get < uint32_t > ( );
+	last = ckpt_get < int32_t > ( );
+	obj_serial = ckpt_get < int64_t > ( );
+	node_serial = ckpt_get < int64_t > ( );
+	for ( i = 0; i < 4; ++i )
+		flags[ i ] = ckpt_get < uint8_t > ( );
+	rnd = ckpt_get_str( );
+
+	if ( ! ckpt_ok || last < 1 || last >= max_step )
+	{
+		plog( "\nError: checkpoint at time step %d cannot be resumed with %d time steps\n", last, max_step );
+		gzclose( ckpt_f );
+		return false;
+	}
+
+	if ( name != clean_file( simul_name ) )
+		plog( "\nWarning: checkpoint saved from configuration '%s'\n", name.c_str( ) );
+
+	// engine setup applied to existing and new objects
+	for ( n = ckpt_get < uint32_t > ( ); ckpt_ok && n > 0; --n )
+	{
+		lab = ckpt_get_str( );
+		set_window( lab.c_str( ), ckpt_get < int32_t > ( ) );
+	}
+
+	for ( n = ckpt_get < uint32_t > ( ); ckpt_ok && n > 0; --n )
+		set_index( ckpt_get_str( ).c_str( ) );
+
+	// rebuild the objects tree without collecting deleted objects
+	no_zero_instance = false;
+	actual_steps = 0;
+
+	if ( ! ckpt_load_obj( root, serials, hooks ) )
+		ckpt_ok = false;
+
+	no_zero_instance = zero_inst;
+
+	for ( auto &h : hooks )
+	{
+		h.first->hook = h.second[ 0 ] != 0 && serials.count( h.second[ 0 ] ) > 0 ? serials[ h.second[ 0 ] ] : NULL;
+		h.first->hooks.clear( );
+		for ( i = 1; i < ( int ) h.second.size( ); ++i )
+			h.first->hooks.push_back( h.second[ i ] != 0 && serials.count( h.second[ i ] ) > 0 ? serials[ h.second[ i ] ] : NULL );
+	}
+
+	empty_cemetery( );
+
+	for ( n = ckpt_ok ? ckpt_get < uint32_t > ( ) : 0; ckpt_ok && n > 0; --n )
+	{
+		cv = new variable;
+		lab = ckpt_get_str( );
+		cv->label = new char[ lab.size( ) + 1 ];
+		strcpy( cv->label, lab.c_str( ) );
+		lab = ckpt_get_str( );
+		cv->lab_tit = new char[ lab.size( ) + 1 ];
+		strcpy( cv->lab_tit, lab.c_str( ) );
+		cv->save = ckpt_get < uint8_t > ( );
+		cv->savei = ckpt_get < uint8_t > ( );
+		cv->start = ckpt_get < int32_t > ( );
+		cv->end = ckpt_get < int32_t > ( );
+		cv->num_lag = 0;
+		cv->val = lag_alloc( 1 );
+		cv->val[ 0 ] = NAN;
+		cv->data = ( double * ) malloc( max( cv->end - cv->start + 1, 1 ) * sizeof( double ) );
+		ckpt_get( cv->data, max( cv->end - cv->start + 1, 0 ) * sizeof( double ) );
+		add_cemetery( cv );
+	}
+
+	ckpt_get( end, 4 );
+	gzclose( ckpt_f );
+
+	if ( ! ckpt_ok || memcmp( end, "END", 4 ) || ! set_random_state( rnd ) )
+	{
+		plog( "\nError: invalid or incompatible checkpoint file '%s'\n", fname );
+		return false;
+	}
+
+	objSerial = obj_serial;
+	nodesSerial = node_serial;
+	no_saved = flags[ 0 ];
+	no_search = flags[ 1 ];
+	no_zero_instance = flags[ 2 ];
+	use_nan = flags[ 3 ];
+
+	seed = run_seed + 1;					// next run seed (as after run start)
+	actual_steps = last;
+	t = last + 1;
+
+	// let the model reset its own state (global pointers, etc.)
+	if ( restore_func != NULL )
+		restore_func( );
+
+	return true;
+}
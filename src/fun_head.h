@@ -201,13 +201,22 @@ const bool no_pointer_init = true;
 			var->dummy = true; \
 			p->cal( p, ( char * ) Y, 0, true ); \
 		} \
-		res = var->val[ 0 ]; \
+		res = var->lagged( 0 ); \
+		goto end; \
+	}
+
+#define EQUATION_BATCH( X ) \
+	if ( ! strcmp( label, X ) ) { \
+		res = var->cal_batch( caller, [ & ]( object *caller, variable *var, o_vecT &batch_objs, vector < double > &batch_res ) {
+
+#define RESULT_BATCH \
+		} ); \
 		goto end; \
 	}
 
 #else
 // use fast map method for equation look-up
-#define MODELBEGIN \
+#define MODEL_FUN \
 	double variable::fun( object *caller ) \
 	{ \
 		double res = def_res; \
@@ -226,7 +235,10 @@ const bool no_pointer_init = true;
 		res = ( eq_func )( caller, this ); \
 		EQ_TEST_RESULT \
 		return res; \
-	} \
+	}
+
+#define MODELBEGIN \
+	MODEL_FUN \
 	void init_map( ) \
 	{ \
 		eq_map = \
@@ -236,6 +248,15 @@ const bool no_pointer_init = true;
 		}; \
 	}
 
+// equations compiled ahead of time to free functions (see aot.cpp), in a
+// vector of (label, function) pairs in definition order
+#define MODEL_AOT( X ) \
+	MODEL_FUN \
+	void init_map( ) \
+	{ \
+		eq_map = eq_mapT( X.begin( ), X.end( ) ); \
+	}
+
 #define EQUATION( X ) \
 	{ string( X ), [ ]( object *caller, variable *var ) \
 		{ \
@@ -264,12 +285,35 @@ const bool no_pointer_init = true;
 				var->dummy = true; \
 				var->up->cal( var->up, ( char * ) Y, 0, true ); \
 			} \
-			return var->val[ 0 ]; \
+			return var->lagged( 0 ); \
+		} \
+	},
+
+#define EQUATION_BATCH( X ) \
+	{ string( X ), [ ]( object *caller, variable *var ) \
+		{ \
+			return var->cal_batch( caller, [ ]( object *caller, variable *var, o_vecT &batch_objs, vector < double > &batch_res ) \
+				{ \
+					EQ_BEGIN
+
+#define RESULT_BATCH \
+					; \
+					( void ) res; \
+					DEBUG_CODE \
+				} ); \
 		} \
 	},
 
 #endif
 
+// batch equations: instances being computed, their inputs and results
+#define BATCH_N ( ( int ) batch_objs.size( ) )
+#define BATCH_OBJ( I ) ( batch_objs[ I ] )
+#define BATCH_RES( I ) batch_res[ I ]
+#define BATCH_V( X, Y ) batch_vals( batch_objs, ( char * ) X, 0, Y )
+#define BATCH_VL( X, L, Y ) batch_vals( batch_objs, ( char * ) X, L, Y )
+#define CYCLE_BATCH( I ) for ( I = 0; I < BATCH_N; ++I )
+
 // redefine as macro to avoid conflicts with C++ version in <cmath.h>
 #define abs( X ) _abs( X )
 #define pi M_PI
@@ -297,16 +341,31 @@ const bool no_pointer_init = true;
 #define NO_ZERO_INSTANCE { no_zero_instance = true; }
 #define USE_ZERO_INSTANCE { no_zero_instance = false; }
 #define PARAMETER { var->param = 1; }
+#define USE_WINDOW( X, Y ) set_window( ( char * ) X, Y )
+#define NO_WINDOW( X ) set_window( ( char * ) X, 0 )
+#define USE_INDEX( X ) set_index( ( char * ) X, true )
+#define NO_INDEX( X ) set_index( ( char * ) X, false )
+#define RESTORE_SIM( X ) static bool restore_sim_set = ( restore_func = X, true )
 
 #define RND ( ran1( ) )
 #define RND_SEED ( ( double ) seed - 1 )
 #define RND_GENERATOR( X ) set_random( ( int ) X )
 #define RND_SETSEED( X ) { seed = ( unsigned ) X; init_random( seed ); }
+#define RND_CTR ( rnd_ctr( p, var ) )
+#define RND_CTRS( O ) ( CHK_PTR_DBL( O ) rnd_ctr( O, var ) )
+#define UNIFORM_CTR( X, Y ) ( uniform_ctr( p, var, X, Y ) )
+#define UNIFORM_CTRS( O, X, Y ) ( CHK_PTR_DBL( O ) uniform_ctr( O, var, X, Y ) )
+#define NORM_CTR( X, Y ) ( norm_ctr( p, var, X, Y ) )
+#define NORM_CTRS( O, X, Y ) ( CHK_PTR_DBL( O ) norm_ctr( O, var, X, Y ) )
+#define LNORM_CTR( X, Y ) ( lnorm_ctr( p, var, X, Y ) )
+#define LNORM_CTRS( O, X, Y ) ( CHK_PTR_DBL( O ) lnorm_ctr( O, var, X, Y ) )
+#define BETA_CTR( X, Y ) ( beta_ctr( p, var, X, Y ) )
+#define BETA_CTRS( O, X, Y ) ( CHK_PTR_DBL( O ) beta_ctr( O, var, X, Y ) )
 #define SLEEP( X ) msleep( ( unsigned ) X )
 
 #define CONFIG ( ( const char * ) simul_name )
 #define PATH ( ( const char * ) path )
-#define CURRENT ( var->val[ 0 ] )
+#define CURRENT ( var->lagged( 0 ) )
 #define THIS ( p )
 #define CALLER ( c )
 #define NAME ( ( const char * ) p->label )
@@ -331,6 +390,13 @@ const bool no_pointer_init = true;
 #define VS( O, X ) ( CHK_PTR_DBL( O ) O->cal( O, ( char * ) X, 0 ) )
 #define VLS( O, X, Y ) ( CHK_PTR_DBL( O ) O->cal( O, ( char * ) X, Y ) )
 
+// interned label ID look-up, resolved once per call site (X must be constant)
+#define LAB_ID( X ) ( [ ]( ) -> int { static const int _lab_id = lab_id( X ); return _lab_id; }( ) )
+#define V_ID( X ) ( p->cal( p, LAB_ID( X ), 0 ) )
+#define VL_ID( X, Y ) ( p->cal( p, LAB_ID( X ), Y ) )
+#define VS_ID( O, X ) ( CHK_PTR_DBL( O ) O->cal( O, LAB_ID( X ), 0 ) )
+#define VLS_ID( O, X, Y ) ( CHK_PTR_DBL( O ) O->cal( O, LAB_ID( X ), Y ) )
+
 #define SUM( X ) ( p->sum( ( char * ) X, 0, false, "", "", 0. ) )
 #define SUML( X, L ) ( p->sum( ( char * ) X, L, false, "", "", 0. ) )
 #define SUMS( O, X ) ( CHK_PTR_DBL( O ) O->sum( ( char * ) X, 0, false, "", "", 0. ) )
@@ -403,6 +469,13 @@ const bool no_pointer_init = true;
 #define SD_CNDS( O, X, T, R, V ) ( CHK_PTR_DBL( O ) O->sd( ( char * ) X, 0, true, ( char * ) T, ( char * ) R, V ) )
 #define SD_CNDLS( O, X, T, R, V, L ) ( CHK_PTR_DBL( O ) O->sd( ( char * ) X, L, true, ( char * ) T, ( char * ) R, V ) )
 
+#define REDUCE( X, S, R ) ( p->multi_reduce( ( char * ) X, sizeof( S ) / sizeof( reduce_spec ), S, R ) )
+#define REDUCEL( X, S, R, L ) ( p->multi_reduce( ( char * ) X, sizeof( S ) / sizeof( reduce_spec ), S, R, NULL, L ) )
+#define REDUCES( O, X, S, R ) ( CHK_PTR_DBL( O ) O->multi_reduce( ( char * ) X, sizeof( S ) / sizeof( reduce_spec ), S, R ) )
+#define REDUCELS( O, X, S, R, L ) ( CHK_PTR_DBL( O ) O->multi_reduce( ( char * ) X, sizeof( S ) / sizeof( reduce_spec ), S, R, NULL, L ) )
+#define REDUCE_VAL( X, S, R, V ) ( p->multi_reduce( ( char * ) X, sizeof( S ) / sizeof( reduce_spec ), S, R, & V ) )
+#define REDUCE_VALS( O, X, S, R, V ) ( CHK_PTR_DBL( O ) O->multi_reduce( ( char * ) X, sizeof( S ) / sizeof( reduce_spec ), S, R, & V ) )
+
 #define COUNT( X ) ( p->count( ( char * ) X, 0, false, "", "", 0. ) )
 #define COUNTS( O, X ) ( CHK_PTR_DBL( O ) O->count( ( char * ) X, 0, false, "", "", 0. ) )
 #define COUNT_CND( X, T, R, V ) ( p->count( ( char * ) X, 0, true, ( char * ) T, ( char * ) R, V ) )
@@ -439,6 +512,8 @@ const bool no_pointer_init = true;
 #define SEARCH_CNDL( X, Y, L ) ( p->search_var_cond( ( char * ) X, Y, L ) )
 #define SEARCH_CNDS( O, X, Y ) ( CHK_PTR_OBJ( O ) O->search_var_cond( ( char * ) X, Y, 0 ) )
 #define SEARCH_CNDLS( O, X, Y, L ) ( CHK_PTR_OBJ( O ) O->search_var_cond( ( char * ) X, Y, L ) )
+#define SEARCH_CND_ALL( X, Y, V ) ( p->search_var_cond_all( ( char * ) X, Y, V ) )
+#define SEARCH_CND_ALLS( O, X, Y, V ) ( CHK_PTR_DBL( O ) O->search_var_cond_all( ( char * ) X, Y, V ) )
 #define SEARCH_INST( X ) ( p->search_inst( X, true ) )
 #define SEARCH_INSTS( O, X ) ( CHK_PTR_DBL( O ) O->search_inst( X, true ) )
 
@@ -452,6 +527,14 @@ const bool no_pointer_init = true;
 #define RNDDRAW_TOTL( X, Y, L, Z ) ( p->draw_rnd( ( char * ) X, ( char * ) Y, L, Z ) )
 #define RNDDRAW_TOTS( O, X, Y, Z ) ( CHK_PTR_OBJ( O ) O->draw_rnd( ( char * ) X, ( char * ) Y, 0, Z ) )
 #define RNDDRAW_TOTLS( O, X, Y, L, Z ) ( CHK_PTR_OBJ( O ) O->draw_rnd( ( char * ) X, ( char * ) Y, L, Z ) )
+#define RNDDRAW_BATCH( X, Y, N, V ) ( p->draw_rnd_batch( ( char * ) X, ( char * ) Y, 0, N, true, V ) )
+#define RNDDRAW_BATCHL( X, Y, L, N, V ) ( p->draw_rnd_batch( ( char * ) X, ( char * ) Y, L, N, true, V ) )
+#define RNDDRAW_BATCHS( O, X, Y, N, V ) ( CHK_PTR_DBL( O ) O->draw_rnd_batch( ( char * ) X, ( char * ) Y, 0, N, true, V ) )
+#define RNDDRAW_BATCHLS( O, X, Y, L, N, V ) ( CHK_PTR_DBL( O ) O->draw_rnd_batch( ( char * ) X, ( char * ) Y, L, N, true, V ) )
+#define RNDDRAW_BATCH_NOREP( X, Y, N, V ) ( p->draw_rnd_batch( ( char * ) X, ( char * ) Y, 0, N, false, V ) )
+#define RNDDRAW_BATCH_NOREPL( X, Y, L, N, V ) ( p->draw_rnd_batch( ( char * ) X, ( char * ) Y, L, N, false, V ) )
+#define RNDDRAW_BATCH_NOREPS( O, X, Y, N, V ) ( CHK_PTR_DBL( O ) O->draw_rnd_batch( ( char * ) X, ( char * ) Y, 0, N, false, V ) )
+#define RNDDRAW_BATCH_NOREPLS( O, X, Y, L, N, V ) ( CHK_PTR_DBL( O ) O->draw_rnd_batch( ( char * ) X, ( char * ) Y, L, N, false, V ) )
 
 #define WRITE( X, Y ) ( p->write( ( char * ) X, Y, t, 0 ) )
 #define WRITEL( X, Y, L ) ( p->write( ( char * ) X, Y, L, 0 ) )
@@ -680,7 +763,7 @@ char msg[ MAX_BUFF_SIZE ];							// legacy auxiliary buffer
 	if ( ! strcmp( label, X ) ) { \
 		last_update--; \
 		if ( c == NULL ) { \
-			res = val[ 0 ]; \
+			res = lagged( 0 ); \
 			goto end; \
 		}
 
@@ -741,7 +824,7 @@ char msg[ MAX_BUFF_SIZE ];							// legacy auxiliary buffer
 
 #define DEBUG \
 	f = fopen( "log.txt", "a" ); \
-	fprintf( f, "t=%d\t%s\t(cur=%g)\n", t, var->label, var->val[0] ); \
+	fprintf( f, "t=%d\t%s\t(cur=%g)\n", t, var->label, var->lagged( 0 ) ); \
 	fclose( f );
 
 #define DEBUG_AT( X ) \
@@ -45,8 +45,15 @@ char nonavail[ ] = "NA";	// string for unavailable values (use R default)
 char tabs[ ] = "5c 7.5c 10c 12.5c 15c 17.5c 20c";	// Log window tabs
 double def_res = 0;			// default equation result
 int add_to_tot = false;		// flag to append results to existing totals file (bool)
+int branch_step = 0;		// time step to branch alternative scenarios (0: none)
+int ckpt_every = 0;			// time steps between checkpoints (0: none)
 int dobar = false;			// output a progress bar to the log/standard output
+int dobench = false;		// save benchmark records (bool)
+int dobin = false;			// produce binary columnar .lcr results files (bool)
 int docsv = false;			// produce .csv text results files (bool)
+int dostream = false;		// stream saved series to disk during the run (bool)
+int dowaves = false;		// schedule equations in dependency waves (bool)
+int doprof = false;			// profile equations computation (bool)
 int doover = false;			// overwrite results folder (bool)
 int dozip = true;			// compressed results file flag (bool)
 int max_step = 100;			// default number of simulation runs
@@ -96,6 +103,8 @@ char *eq_file = NULL;		// equation file content
 char *exec_file = NULL;		// name of executable file
 char *exec_path = NULL;		// path of executable file
 char *log_filename = NULL;	// name of log file, if any
+char *bench_filename = NULL;// name of benchmark file, if any
+char *ckpt_filename = NULL;	// name of checkpoint file to resume from, if any
 char *rootLsd = NULL;		// path of LSD root directory
 char *path = NULL;			// path of current configuration
 char *sens_file = NULL;		// current sensitivity analysis file
@@ -144,9 +153,11 @@ int lsd_stack;					// LSD stack call level
 int stack_info = 0;			// LSD stack control
 int stop;					// activity interruption flag (Tcl boolean)
 int t;						// current time step
+int start_step = 1;			// first time step of current run (>1 if resumed)
 int when_debug;				// next debug stop time step (0 for none)
 int wr_warn_cnt;			// invalid write operations warning counter
 long nodesSerial = 1;		// network node's serial number global counter
+long objSerial = 0;			// object's serial number global counter
 lsdstack *stacklog = NULL;	// LSD stack
 map < string, profile > prof;// set of saved profiling times
 object *blueprint = NULL;	// LSD blueprint (effective model in use)
@@ -157,6 +168,8 @@ o_setT obj_list;			// set with all existing LSD objects
 sense *rsense = NULL;		// LSD sensitivity analysis structure
 variable *cemetery = NULL;	// LSD saved data from deleted objects
 variable *last_cemetery = NULL;// LSD last saved data from deleted objects
+vector < handleT > branch_pids;// branched scenarios process id's
+vector < string > branch_files;// alternative scenarios configuration files
 vector < string > res_list;	// list of results files last saved
 FILE *log_file = NULL;		// log file, if any
 
@@ -200,7 +213,7 @@ Tcl_Interp *inter = NULL;	// global Tcl interpreter in LSD
 #else
 // command line strings
 const char lsdCmdMsg[ ] = "This is the No Window version of LSD.";
-const char lsdCmdHlp[ ] = "Command line options:\n'-f FILENAME.lsd [-s SEED] [-e RUNS] to run a single configuration file\n'-f FILE_BASE_NAME -s FIRST_NUM [-e LAST_NUM]' for batch sequential mode\n'-o PATH' to save result file(s) to a different subdirectory\n'-l FILENAME' to save all output to a (log) file\n'-t' to produce comma separated (.csv) text result file(s)\n'-r' for skipping the generation of intermediate result file(s)\n'-p' for skipping the generation of totals file\n'-g' for the generation of a single grand total file\n'-z' for preventing the generation of compressed result file(s)\n'-b' for showing a progress bar\n'-c MAX_THREADS[:MAX_RUNS]' to set maximum parallel threads/runs to use\n";
+const char lsdCmdHlp[ ] = "Command line options:\n'-f FILENAME.lsd [-s SEED] [-e RUNS] to run a single configuration file\n'-f FILE_BASE_NAME -s FIRST_NUM [-e LAST_NUM]' for batch sequential mode\n'-o PATH' to save result file(s) to a different subdirectory\n'-l FILENAME' to save all output to a (log) file\n'-t' to produce comma separated (.csv) text result file(s)\n'-x' to produce binary columnar (.lcr) result file(s)\n'-w' to stream saved series to disk during the run (implies -x)\n'-r' for skipping the generation of intermediate result file(s)\n'-p' for skipping the generation of totals file\n'-g' for the generation of a single grand total file\n'-z' for preventing the generation of compressed result file(s)\n'-b' for showing a progress bar\n'-c MAX_THREADS[:MAX_RUNS]' to set maximum parallel threads/runs to use\n'-d' to compute independent equations concurrently in dependency waves\n'-q' to profile equations (Chrome trace .json and flame graph .folded files)\n'-j FILE.json[:LABEL,...]' to save benchmark records per time step, timing the listed equations\n'-k STEPS' to save a checkpoint (.lck) file every STEPS time steps and at the end of each run\n'-y FILE.lck' to resume a single run from a checkpoint file\n'-a STEP:FILE.lsd[,FILE.lsd...]' to branch each run after STEP time steps into the listed scenarios (changed parameters only)\n";
 #endif
 
 
@@ -212,7 +225,9 @@ int lsdmain( int argn, const char **argv )
 	char *str;
 	const char *app;
 	int i, j = 0, k = 0;
+#ifndef _NW_
 	object *r;
+#endif
 
 	path = new char[ strlen( "" ) + 1 ];
 	simul_name = new char[ strlen( "" ) + 1 ];
@@ -238,7 +253,7 @@ int lsdmain( int argn, const char **argv )
 #ifdef _NW_
 
 	dozip = no_window = true;			// to preserve compatibility
-	dobar = doover = docsv = no_res = no_tot = grandTotal = false;
+	dobar = dobench = dobin = doover = docsv = dostream = dowaves = doprof = no_res = no_tot = grandTotal = false;
 	findex = -1;						// no default
 	fend = 0;							// no file number limit
 
@@ -279,6 +294,47 @@ int lsdmain( int argn, const char **argv )
 				strcpy( log_filename, argv[ 1 + i ] );
 				continue;
 			}
+			// read -j parameter : save benchmark records to a (JSON) file
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'j' && 1 + i < argn && strlen( argv[ 1 + i ] ) > 0 )
+			{
+				delete [ ] bench_filename;
+				bench_filename = new char[ strlen( argv[ 1 + i ] ) + 1 ];
+				strcpy( bench_filename, argv[ 1 + i ] );
+				continue;
+			}
+			// read -k parameter : save checkpoints every number of time steps
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'k' && 1 + i < argn && strlen( argv[ 1 + i ] ) > 0 )
+			{
+				sscanf( argv[ i + 1 ], "%d", & ckpt_every );
+				continue;
+			}
+			// read -y parameter : resume run from a checkpoint file
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'y' && 1 + i < argn && strlen( argv[ 1 + i ] ) > 0 )
+			{
+				delete [ ] ckpt_filename;
+				ckpt_filename = new char[ strlen( argv[ 1 + i ] ) + 1 ];
+				strcpy( ckpt_filename, argv[ 1 + i ] );
+				continue;
+			}
+			// read -a parameter : branch alternative scenarios at a time step
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'a' && 1 + i < argn && strlen( argv[ 1 + i ] ) > 0 )
+			{
+				sscanf( argv[ i + 1 ], "%d", & branch_step );
+				branch_files.clear( );
+
+				if ( ( app = strchr( argv[ i + 1 ], ':' ) ) != NULL )
+				{
+					str = new char[ strlen( app ) + 1 ];
+					strcpy( str, app + 1 );
+
+					for ( app = strtok( str, "," ); app != NULL; app = strtok( NULL, "," ) )
+						branch_files.push_back( app );
+
+					delete [ ] str;
+				}
+
+				continue;
+			}
 			// read -c parameter : max number of cores
 			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'c' && 1 + i < argn && strlen( argv[ 1 + i ] ) > 0 )
 			{
@@ -304,6 +360,34 @@ int lsdmain( int argn, const char **argv )
 				docsv = true;
 				continue;
 			}
+			// read -x parameter : produce binary columnar .lcr results files
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'x' )
+			{
+				i--;					// no parameter for this option
+				dobin = true;
+				continue;
+			}
+			// read -d parameter : schedule equations in dependency waves
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'd' )
+			{
+				i--;					// no parameter for this option
+				dowaves = true;
+				continue;
+			}
+			// read -q parameter : profile equations computation
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'q' )
+			{
+				i--;					// no parameter for this option
+				doprof = true;
+				continue;
+			}
+			// read -w parameter : stream saved series to disk during the run
+			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'w' )
+			{
+				i--;					// no parameter for this option
+				dostream = dobin = true;// streamed series are saved as .lcr
+				continue;
+			}
 			// read -r parameter : do not produce intermediate .res files
 			if ( argv[ i ][ 0 ] == '-' && argv[ i ][ 1 ] == 'r' )
 			{
@@ -403,6 +487,47 @@ int lsdmain( int argn, const char **argv )
 			sim_num = fend;
 	}
 
+	if ( ( ckpt_every > 0 || ckpt_filename != NULL ) && dostream )
+	{
+		fprintf( stderr, "\nCheckpoints ('-k' and '-y') cannot be used with streaming ('-w').\n%s\n%s\n", lsdCmdMsg, lsdCmdHlp );
+		myexit( 6 );
+	}
+
+	if ( branch_step != 0 || branch_files.size( ) > 0 )
+	{
+		if ( branch_step < 1 || branch_step >= max_step || branch_files.size( ) == 0 )
+		{
+			fprintf( stderr, "\nInvalid -a time step (1 to %d) and/or scenario file(s).\n%s\n%s\n", max_step - 1, lsdCmdMsg, lsdCmdHlp );
+			myexit( 6 );
+		}
+
+		if ( batch_sequential || dostream )
+		{
+			fprintf( stderr, "\nOption '-a' requires a single configuration file and cannot be used with streaming ('-w').\n%s\n%s\n", lsdCmdMsg, lsdCmdHlp );
+			myexit( 6 );
+		}
+
+		for ( auto &b : branch_files )
+			if ( ( f = fopen( b.c_str( ), "r" ) ) == NULL )
+			{
+				fprintf( stderr, "\nScenario file '%s' not found.\n", b.c_str( ) );
+				myexit( 7 );
+			}
+			else
+				fclose( f );
+	}
+
+	if ( ckpt_filename != NULL )
+	{
+		if ( batch_sequential )
+		{
+			fprintf( stderr, "\nOption '-y' requires a single configuration file.\n%s\n%s\n", lsdCmdMsg, lsdCmdHlp );
+			myexit( 6 );
+		}
+
+		sim_num = 1;				// only the checkpointed run is resumed
+	}
+
 	if ( log_filename != NULL )
 	{
 		if ( save_alt_path && strncmp( log_filename, alt_path, strlen( alt_path ) ) != 0 )
@@ -423,6 +548,12 @@ int lsdmain( int argn, const char **argv )
 		}
 	}
 
+	if ( bench_filename != NULL && ! bench_open( bench_filename ) )
+	{
+		fprintf( stderr, "\nCannot create the benchmark file '%s'.\n", bench_filename );
+		myexit( 11 );
+	}
+
 #ifndef _NP_
 
 	if ( k > 0 )
@@ -435,6 +566,16 @@ int lsdmain( int argn, const char **argv )
 			max_threads = j;
 	}
 
+	// concurrent runs would distort the benchmark timings
+	if ( dobench && max_runs > 1 )
+	{
+		printf( "\nParallel runs request ignored, benchmarking runs sequentially.\n" );
+		max_runs = 1;
+
+		if ( j > 0 )
+			max_threads = j;
+	}
+
 	if ( max_runs > 1 )
 		max_threads = max( min( j, max_threads / max_runs ), 1 );
 
@@ -448,7 +589,10 @@ int lsdmain( int argn, const char **argv )
 			grandTotal = false;
 		}
 
-		return run_parallel( no_window, argv[ 0 ], simul_name, seed, sim_num, max_threads, max_runs );
+		i = run_parallel( no_window, argv[ 0 ], simul_name, seed, sim_num, max_threads, max_runs );
+
+		if ( i != FORKSTAT )		// forked instance proceeds as a regular run
+			return i;
 	}
 
 #else
@@ -827,16 +971,20 @@ void run( void )
 	if ( strlen( simul_name ) == 0 || strlen( struct_file ) == 0  )
 		return;					// it should never get here... just in case
 
+	lab_freeze( false );		// in case an aborted run left the labels frozen
+
 #ifndef _NP_
 	// check if there are parallel computing variables
 	if ( parallel_disable || max_threads < 2 )
 		parallel_mode = parallel_ready = false;
 	else
 	{
-		parallel_mode = search_parallel( root );
+		parallel_mode = dowaves || search_parallel( root );
 		parallel_ready = true;
 	}
 
+	mut_log = NULL;				// discard changes deferred by an aborted run
+
 	// start multi-thread workers
 	if ( parallel_mode )
 		workers = new worker[ max_threads ];
@@ -921,6 +1069,21 @@ void run( void )
 		series_saved = 0;
 		t = 1;
 
+		// streaming results mode: open the spool file before saving memory is set
+		if ( dostream && ! no_res )
+		{
+			if ( ! batch_sequential )
+				snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d.lcs", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? clean_file( simul_name ) : simul_name, seed );
+			else
+				snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d_%d.lcs", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? clean_file( simul_name ) : simul_name, findex, seed );
+
+			if ( ! stream_open( fname ) )
+			{
+				fprintf( stderr, "\nCannot create the streamed results file '%s'.\n", fname );
+				myexit( 11 );
+			}
+		}
+
 		if ( ! alloc_save_mem( root ) )
 		{
 #ifndef _NW_
@@ -943,6 +1106,13 @@ void run( void )
 
 		seed++;
 		pause_run = false;
+
+		if ( doprof )
+			prof_start( );
+
+		if ( dobench )
+			bench_run( seed - 1 );
+
 		debug_flag = false;
 		error_hard_thread = false;
 		worker_ready = true;
@@ -953,9 +1123,26 @@ void run( void )
 		no_search = false;
 		done_in = 0;
 		wr_warn_cnt = 0;
+		// resume from checkpoint, if required
+		if ( ckpt_filename != NULL )
+		{
+			if ( ! ckpt_load( ckpt_filename ) )
+			{
+				fprintf( stderr, "\nCannot resume from checkpoint file '%s'.\n", ckpt_filename );
+				myexit( 12 );
+			}
+
+			if ( fast_mode < 2 )
+				plog( "\nResuming from checkpoint '%s' after case %d (seed=%d)...", ckpt_filename, t - 1, seed - 1 );
+		}
+
+		index_reset( );		// parameter indexes and random draw samplers
+		sampler_reset( );	// are rebuilt when used
+		start_step = t;
 		start = last_update = clock( );
+		lab_freeze( true );	// look up element labels without locking
 
-		for ( t = 1; quit == 0 && t <= max_step; ++t )
+		for ( ; quit == 0 && t <= max_step; ++t )
 		{
 			// update the percentage done bar, if needed
 			if ( no_window && dobar )
@@ -980,7 +1167,32 @@ void run( void )
 #endif
 			{
 				actual_steps = t;
+
+				if ( dowaves )
+					dep_period( root );
+
 				root->update( true, false );
+
+				if ( dostream )
+					stream_step( );
+
+				if ( dobench )
+					bench_step( t );
+
+				if ( ckpt_every > 0 && ( t % ckpt_every == 0 || t == max_step ) && quit == 0 )
+				{
+					if ( ! batch_sequential )
+						snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d.lck", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? clean_file( simul_name ) : simul_name, seed - 1 );
+					else
+						snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d_%d.lck", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? clean_file( simul_name ) : simul_name, findex, seed - 1 );
+
+					if ( ! ckpt_save( fname ) )
+						plog( "\nError: cannot save checkpoint file '%s'\n", fname );
+				}
+
+				// fork the alternative scenarios from the shared state
+				if ( branch_step == t && quit == 0 )
+					branch_run( );
 			}
 
 			perc_done = min( 100 * ( ( i - 1 ) + ( double ) t / max_step ) / sim_num, 100 );
@@ -1068,6 +1280,8 @@ void run( void )
 
 		unsavedData = true;			// flag unsaved simulation results
 		running = false;
+		dep_state = 0;				// stop dependency recording (short runs)
+		lab_freeze( false );
 		deb_log( false );			// close debug log file, if any
 		end = clock( );
 
@@ -1092,9 +1306,23 @@ void run( void )
 		close_sim( );
 		user_exception = false;
 
+		// save the equations profile of the run, if required
+		if ( doprof )
+		{
+			if ( ! batch_sequential )
+				snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? clean_file( simul_name ) : simul_name, seed - 1 );
+			else
+				snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d_%d", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? clean_file( simul_name ) : simul_name, findex, seed - 1 );
+
+			prof_save( fname );
+		}
+
 		reset_end( root );
 		root->emptyturbo( );
 
+		if ( dobench )
+			bench_save( );
+
 		if ( quit != 2 && ( sim_num > 1 || no_window ) )
 		{
 			// save results for multiple simulation runs, if any
@@ -1121,11 +1349,11 @@ void run( void )
 				if ( ! no_res )
 				{
 					if ( ! batch_sequential )
-						snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d.%s", path_out, sep_out, name_out, seed - 1, docsv ? "csv" : "res" );
+						snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d.%s", path_out, sep_out, name_out, seed - 1, dobin ? "lcr" : docsv ? "csv" : "res" );
 					else
-						snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d_%d.%s", path_out, sep_out, name_out, findex, seed - 1, docsv ? "csv" : "res" );
+						snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d_%d.%s", path_out, sep_out, name_out, findex, seed - 1, dobin ? "lcr" : docsv ? "csv" : "res" );
 
-					if ( dozip )
+					if ( dozip && ! dobin )
 						strcatn( fname, ".gz", MAX_PATH_LENGTH );
 
 					res_list.push_back( fname );
@@ -1133,10 +1361,25 @@ void run( void )
 					if ( fast_mode < 2 )
 						plog( "Saving results to file %s... ", fname );
 
-					rf = new result( fname, "wt", dozip, docsv );	// create results file object
-					rf->title( root, 1 );						// write header
-					rf->data( root, 0, actual_steps );			// write all data
-					delete rf;									// close file and delete object
+					if ( dostream )			// convert the streamed series to columns
+						stream_close( root, fname );
+					else
+					{
+						if ( dobin )
+						{	// binary columns, compressed by block if required
+							rf = new result( fname, "wb", dozip, false, true );
+							if ( ! rf->columns( root, 0, actual_steps ) )
+								plog( "\nError: cannot write results file '%s'\n", fname );
+						}
+						else
+						{
+							rf = new result( fname, "wt", dozip, docsv );	// create results file object
+							rf->title( root, 1 );				// write header
+							rf->data( root, 0, actual_steps );	// write all data
+						}
+
+						delete rf;								// close file and delete object
+					}
 
 					if ( fast_mode < 2 )
 						plog( "Done\n" );
@@ -1184,6 +1427,9 @@ void run( void )
 				if ( fast_mode < 2 )
 					plog( "Nothing to save: no element selected\n" );
 
+			if ( dobench )
+				bench_end( );
+
 			if ( i == sim_num )									// last run?
 			{
 				if ( batch_sequential )							// last batch file?
@@ -1216,8 +1462,19 @@ void run( void )
 #endif
 			}
 		}
+
+		// discard streamed series not saved above, if any
+		if ( dostream )
+			stream_close( root, NULL );
+
+		// finish the scenarios branched from this run
+		if ( branch_pids.size( ) > 0 )
+			branch_wait( );
 	}	// end of run
 
+	if ( dostream )
+		stream_close( root, NULL );
+
 	if ( fast_mode == 2 )
 		plog( "\nFinished processing configuration file(s)\n" );
 
@@ -1238,6 +1495,243 @@ void run( void )
 }
 
 
+/*********************************
+BRANCH_PARAMS
+Read the parameter values in the DATA
+section of a configuration file, keyed
+by parameter label, values separated by
+single spaces in instances order
+*********************************/
+bool branch_params( const char *fname, map < string, string > &pars )
+{
+	bool data = false;
+	char *line, lab[ MAX_ELEM_LENGTH ], *p;
+	int i;
+	string vals;
+	FILE *f;
+
+	if ( ( f = fopen( fname, "r" ) ) == NULL )
+		return false;
+
+	pars.clear( );
+	line = new char[ MAX_FILE_SIZE ];	// many instances make long lines
+
+	while ( fgets( line, MAX_FILE_SIZE, f ) != NULL )
+	{
+		if ( ! data )
+		{
+			data = ( strncmp( line, "DATA", 4 ) == 0 );
+			continue;
+		}
+
+		if ( strncmp( line, "END_DATA", 8 ) == 0 )
+			break;
+
+		// 'Param: LABEL LAGS SAVE LOADED DEBUG PLOT' then the values
+		if ( strncmp( line, "Param:", 6 ) != 0 || sscanf( line + 6, "%99s", lab ) != 1 )
+			continue;
+
+		strtok( line, " \t\r\n" );
+		for ( i = 0; i < 6 && strtok( NULL, " \t\r\n" ) != NULL; ++i );
+
+		for ( vals = ""; ( p = strtok( NULL, " \t\r\n" ) ) != NULL; )
+			vals += ( vals.length( ) > 0 ? " " : "" ) + string( p );
+
+		pars[ lab ] = vals;
+	}
+
+	fclose( f );
+	delete [ ] line;
+
+	return data;
+}
+
+
+/*********************************
+BRANCH_RUN
+Fork one child process per alternative
+scenario from the current state of the
+run, sharing the simulated periods as
+copy-on-write memory. Each child applies
+the parameters of its scenario configuration
+which differ from the running configuration,
+takes the scenario name for its output
+files and log, and finishes the current run
+only. The parent continues the running
+scenario. Returns true in the children
+*********************************/
+bool branch_run( void )
+{
+	char *lab, fname[ MAX_PATH_LENGTH ];
+	int i, j, k, chg;
+	object *cur;
+	variable *cv;
+	map < string, string > base, pars;
+
+	branch_pids.clear( );
+
+#ifndef _WIN32
+
+	if ( ! branch_params( struct_file, base ) )
+	{
+		plog( "\nError: cannot read parameters from configuration file '%s', no branching\n", struct_file );
+		return false;
+	}
+
+	if ( fast_mode < 2 )
+		plog( "\nBranching %d scenario(s) at case %d...", ( int ) branch_files.size( ), t );
+
+	fflush( stdout );
+	fflush( stderr );
+
+	for ( j = 0; j < ( int ) branch_files.size( ); ++j )
+	{
+		pid_t pid = fork( );
+
+		if ( pid != 0 )				// parent: keep child id to wait for it
+		{
+			if ( pid < 0 )
+				plog( "\nError: cannot create process for scenario '%s'\n", branch_files[ j ].c_str( ) );
+
+			branch_pids.push_back( pid );
+			continue;
+		}
+
+		// child: scenario name is the configuration file name without extension
+		delete [ ] simul_name;
+		simul_name = new char[ branch_files[ j ].length( ) + 1 ];
+		strcpy( simul_name, branch_files[ j ].c_str( ) );
+		k = strlen( simul_name ) - 4;
+		if ( k > 0 && strcasecmp( simul_name + k, ".lsd" ) == 0 )
+			simul_name[ k ] = '\0';
+
+		snprintf( fname, MAX_PATH_LENGTH, "%s%s%s_%d.log", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? clean_file( simul_name ) : simul_name, seed - 1 );
+
+		FILE *f = fopen( fname, "w+" );
+		if ( f != NULL )
+		{
+			dup2( fileno( f ), STDOUT_FILENO );
+			dup2( fileno( f ), STDERR_FILENO );
+			fclose( f );
+		}
+
+		// child reports the scenario configuration as the processed one
+		delete [ ] struct_file;
+		struct_file = new char[ branch_files[ j ].length( ) + 1 ];
+		strcpy( struct_file, branch_files[ j ].c_str( ) );
+
+		if ( ! branch_params( struct_file, pars ) )
+		{
+			fprintf( stderr, "\nCannot read parameters from configuration file '%s'.\n", branch_files[ j ].c_str( ) );
+			myexit( 8 );
+		}
+
+		// apply the changed values, repeating the last one for extra instances
+		chg = 0;
+		for ( auto &p : pars )
+		{
+			if ( base.count( p.first ) > 0 && base[ p.first ] == p.second )
+				continue;
+
+			lab = ( char * ) p.first.c_str( );
+			cv = root->search_var( NULL, lab, true );
+			if ( cv == NULL || cv->param != 1 )
+			{
+				plog( "\nWarning: parameter '%s' not found, scenario value ignored", lab );
+				continue;
+			}
+
+			istringstream ss( p.second );
+			vector < double > v;
+			for ( double x; ss >> x; v.push_back( x ) );
+
+			if ( v.size( ) == 0 )
+				continue;
+
+			for ( i = 0, cur = cv->up; cur != NULL; cur = cur->hyper_next( cur->label ), ++i )
+				if ( ( cv = cur->search_var( NULL, lab, true, true ) ) != NULL )
+					cv->lagged( 0 ) = v[ min( i, ( int ) v.size( ) - 1 ) ];
+
+			if ( fast_mode < 2 )
+				plog( "\nParameter '%s' set to: %s", lab, p.second.c_str( ) );
+
+			++chg;
+		}
+
+		if ( fast_mode < 2 )
+			plog( "\nScenario '%s' branched at case %d (seed=%d): %d parameter(s) changed\n", simul_name, t, seed - 1, chg );
+
+		if ( chg > 0 )
+		{
+			index_reset( );
+			sampler_reset( );
+		}
+
+#ifndef _NP_
+		// worker threads do not survive fork, release the parent's without joining
+		if ( parallel_mode && workers != NULL )
+		{
+			for ( i = 0; i < max_threads; ++i )
+			{
+				workers[ i ].running = false;
+				if ( workers[ i ].thr.joinable( ) )
+					workers[ i ].thr.detach( );
+			}
+
+			delete [ ] workers;
+			thr_ptr.clear( );
+			workers = new worker[ max_threads ];
+		}
+#endif
+
+		branch_pids.clear( );		// siblings are not children
+		branch_files.clear( );
+		branch_step = 0;
+		sim_num = cur_sim;			// just finish the current run
+		dobench = false;			// benchmark file belongs to parent
+
+		return true;
+	}
+
+#else
+
+	plog( "\nWarning: scenario branching is not supported in Windows, ignored\n" );
+
+#endif
+
+	return false;
+}
+
+
+/*********************************
+BRANCH_WAIT
+Wait for the alternative scenarios
+branched in the current run to finish
+*********************************/
+void branch_wait( void )
+{
+#ifndef _WIN32
+	int j, res;
+
+	for ( j = 0; j < ( int ) branch_pids.size( ); ++j )
+	{
+		if ( branch_pids[ j ] < 0 )
+			continue;
+
+		if ( waitpid( branch_pids[ j ], & res, 0 ) < 0 )
+			res = -1;
+		else
+			res = ( res == 0 ) ? 0 : WEXITSTATUS( res );
+
+		if ( res != 0 )
+			plog( "\nError: scenario '%s' finished with error code %d\n", branch_files[ j ].c_str( ), res );
+	}
+#endif
+
+	branch_pids.clear( );
+}
+
+
 /*********************************
 SET_VAR
 *********************************/
@@ -1414,9 +1908,15 @@ bool alloc_save_var( variable *v )
 
 		v->end = max_step;
 
+		// streamed series keep only a window of periods in memory, large
+		// enough to rewrite any stored lag (enlarged for larger saved lags)
+		v->win = ( dostream && v->save && ! v->savei && ! no_res ) ? STREAM_WIN : 0;
+		while ( v->win > 0 && v->win / 2 <= v->num_lag )
+			v->win *= 2;
+
 		// use C stdlib to be able to deallocate memory for deleted objects
 		free( v->data );
-		v->data = ( double * ) malloc( ( v->end - v->start + 1 ) * sizeof( double ) );
+		v->data = ( double * ) malloc( ( v->win > 0 ? v->win : v->end - v->start + 1 ) * sizeof( double ) );
 
 		if( v->data == NULL )
 		{
@@ -1433,7 +1933,10 @@ bool alloc_save_var( variable *v )
 		else
 		{
 			if ( v->num_lag > 0	 || v->param == 1 )
-				v->data[ 0 ] = v->val[ 0 ];
+				v->saved( v->start ) = v->lagged( 0 );
+
+			if ( v->win > 0 )
+				stream_add( v );
 
 			++series_saved;
 		}
@@ -1542,7 +2045,7 @@ bool search_parallel( object *r )
 /***************************************
 RUN_PARALLEL_EXEC
 ***************************************/
-void run_parallel_exec( bool nw, int id, string cmd )
+void run_parallel_exec( int id, string cmd )
 {
 	int res;
 
@@ -1552,9 +2055,43 @@ void run_parallel_exec( bool nw, int id, string cmd )
 	run_status[ id ] = res;
 }
 
+#ifndef _WIN32
+
+/***************************************
+RUN_PARALLEL_WAIT
+Wait for a forked run instance to finish
+***************************************/
+void run_parallel_wait( int id )
+{
+	int res;
+	pid_t pid;
+
+	{
+		lock_guard < mutex > lock( lock_run_pids );
+		pid = run_pids[ id ];
+	}
+
+	if ( waitpid( pid, & res, 0 ) < 0 )
+		res = -1;
+	else
+		res = ( res == 0 ) ? 0 : WEXITSTATUS( res );
+
+	lock_guard < mutex > lock( lock_run_status );
+	run_status[ id ] = res;
+}
+
+#endif
+
 
 /***************************************
 RUN_PARALLEL
+In Unix, the parallel instances are forked from the
+current process, which already holds the loaded
+configuration, so each instance gets a (copy on
+write) clone of the model template, instead of
+starting a new LSD process which parses it again.
+The child process returns FORKSTAT and proceeds
+running its set of seeds as a regular instance
 ***************************************/
 #define INISTAT -1234
 int run_parallel( bool nw, const char *exec, const char *simname, int fseed, int runs, int thrrun, int parruns )
@@ -1567,8 +2104,15 @@ int run_parallel( bool nw, const char *exec, const char *simname, int fseed, int
 	int dest_len = path_len + 5;
 	int log_len = path_len + name_len + 6;
 	int res_len = path_len + name_len + 9;
-	int cmd_len = strlen( exec ) + 2 * ( path_len + name_len ) + 50;
-	char dest_path[ dest_len ], log_file[ log_len ], res_file[ res_len ], cmd[ cmd_len ];
+	int cmd_len = strlen( exec ) + 2 * ( path_len + name_len ) + 80;
+	char dest_path[ dest_len ], log_file[ log_len ], res_file[ res_len ], cmd[ cmd_len ], ckpt_opt[ 16 ];
+	vector < string > run_cmds;
+	vector < int > run_seeds, run_nums;
+
+	if ( ckpt_every > 0 )
+		snprintf( ckpt_opt, 16, " -k %d", ckpt_every );
+	else
+		strcpy( ckpt_opt, "" );
 
 	alt_name = clean_file( simname );
 
@@ -1599,9 +2143,9 @@ int run_parallel( bool nw, const char *exec, const char *simname, int fseed, int
 			// results file names
 			for ( k = i; k < i + num + ( j <= sl ? 1 : 0 ); ++k )
 			{
-				snprintf( res_file, res_len, "%s%s%s_%d.%s", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? alt_name : simname, k, docsv ? "csv" : "res" );
+				snprintf( res_file, res_len, "%s%s%s_%d.%s", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? alt_name : simname, k, dobin ? "lcr" : docsv ? "csv" : "res" );
 
-				if ( dozip )
+				if ( dozip && ! dobin )
 					strcatn( res_file, ".gz", res_len );
 
 				if ( ! no_res )
@@ -1609,11 +2153,11 @@ int run_parallel( bool nw, const char *exec, const char *simname, int fseed, int
 			}
 
 			// command line
-			snprintf( cmd, cmd_len, "%s -c %d -f %s.lsd -s %d -e %d%s%s%s%s%s%s -l %s", exec, thrrun, simname, i, j <= sl ? num + 1 : num, no_res ? " -r" : "", no_tot ? " -p" : "", docsv ? " -t" : "", dozip ? "" : " -z", dobar ? " -b" : "", dest_path, log_file );
+			snprintf( cmd, cmd_len, "%s -c %d -f %s.lsd -s %d -e %d%s%s%s%s%s%s%s%s%s%s%s -l %s", exec, thrrun, simname, i, j <= sl ? num + 1 : num, no_res ? " -r" : "", no_tot ? " -p" : "", docsv ? " -t" : "", dobin ? " -x" : "", dostream ? " -w" : "", dowaves ? " -d" : "", doprof ? " -q" : "", ckpt_opt, dozip ? "" : " -z", dobar ? " -b" : "", dest_path, log_file );
 
-			run_pids.resize( run_pids.size( ) + 1 );
-			run_status.push_back( INISTAT );
-			run_threads.push_back( thread( run_parallel_exec, nw, run_status.size( ) - 1, string( cmd ) ) );
+			run_cmds.push_back( cmd );
+			run_seeds.push_back( i );
+			run_nums.push_back( j <= sl ? num + 1 : num );
 
 			j <= sl ? i += num + 1 : i += num;
 		}
@@ -1627,23 +2171,75 @@ int run_parallel( bool nw, const char *exec, const char *simname, int fseed, int
 			run_logs.push_back( log_file );
 
 			// results file name
-			snprintf( res_file, res_len, "%s%s%s_%d.%s", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? alt_name : simname, i, docsv ? "csv" : "res" );
+			snprintf( res_file, res_len, "%s%s%s_%d.%s", save_alt_path ? alt_path : path, strlen( save_alt_path ? alt_path : path ) > 0 ? "/" : "", save_alt_path ? alt_name : simname, i, dobin ? "lcr" : docsv ? "csv" : "res" );
 
-			if ( dozip )
+			if ( dozip && ! dobin )
 				strcatn( res_file, ".gz", res_len );
 
 			if ( ! no_res )
 				run_results.push_back( res_file );
 
 			// command line
-			snprintf( cmd, cmd_len, "%s -c %d -f %s.lsd -s %d -e 1%s%s%s%s%s%s -l %s", exec, thrrun, simname, i, no_res ? " -r" : "", no_tot ? " -p" : "", docsv ? " -t" : "", dozip ? "" : " -z", dobar ? " -b" : "", dest_path, log_file );
+			snprintf( cmd, cmd_len, "%s -c %d -f %s.lsd -s %d -e 1%s%s%s%s%s%s%s%s%s%s%s -l %s", exec, thrrun, simname, i, no_res ? " -r" : "", no_tot ? " -p" : "", docsv ? " -t" : "", dobin ? " -x" : "", dostream ? " -w" : "", dowaves ? " -d" : "", doprof ? " -q" : "", ckpt_opt, dozip ? "" : " -z", dobar ? " -b" : "", dest_path, log_file );
+
+			run_cmds.push_back( cmd );
+			run_seeds.push_back( i );
+			run_nums.push_back( 1 );
+		}
+	}
+
+	run_pids.resize( run_cmds.size( ) );
+	run_status.resize( run_cmds.size( ), INISTAT );
+
+#ifndef _WIN32
 
-			run_pids.resize( run_pids.size( ) + 1 );
-			run_status.push_back( INISTAT );
-			run_threads.push_back( thread( run_parallel_exec, nw, run_status.size( ) - 1, string( cmd ) ) );
+	// fork all instances while still single-threaded
+	fflush( stdout );
+	fflush( stderr );
+
+	for ( j = 0; j < ( int ) run_cmds.size( ); ++j )
+	{
+		pid_t pid = fork( );
+
+		if ( pid == 0 )				// child: run the assigned seeds
+		{
+			FILE *f = fopen( run_logs[ j ].c_str( ), "w+" );
+			if ( f != NULL )
+			{
+				dup2( fileno( f ), STDOUT_FILENO );
+				dup2( fileno( f ), STDERR_FILENO );
+				fclose( f );
+			}
+
+			seed = run_seeds[ j ];
+			sim_num = run_nums[ j ];
+			max_threads = thrrun;
+
+			run_logs.clear( );
+			run_pids.clear( );
+			run_status.clear( );
+			run_results.clear( );
+
+			return FORKSTAT;
 		}
+
+		if ( pid < 0 )
+			run_status[ j ] = -1;
+		else
+			run_pids[ j ] = pid;
 	}
 
+	for ( j = 0; j < ( int ) run_cmds.size( ); ++j )
+		if ( run_status[ j ] == INISTAT )
+			run_threads.push_back( thread( run_parallel_wait, j ) );
+
+#else
+
+	for ( j = 0; j < ( int ) run_cmds.size( ); ++j )
+		run_threads.push_back( thread( run_parallel_exec, j, run_cmds[ j ] ) );
+
+#endif
+
 	if ( nw )
 	{
 		// create an overall progress bar, using the average progress of threads
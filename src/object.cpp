@@ -49,6 +49,11 @@ value of up is then NULL).
 pointer to the next object in the linked chain of the descendant of the parent
 of this object.
 
+- object *prev;
+pointer to the previous object in the same linked chain, used as a hint to
+unlink deleted objects in constant time (checked before use, as not all code
+changing the chain updates it).
+
 - network *node;
 pointer to the data structure containing the network links from the object
 (see nets.cpp for the details)
@@ -129,7 +134,12 @@ from descendants the search goes up again, or from the parent down.
 
 - object *search_var_cond( char *lab, double value, int lag );
 Uses search_var, but returns the instance of the object that has the searched
-variable with the desired value equal to value.
+variable with the desired value equal to value. Parameters set with set_index
+are found in the hash index of their values instead.
+
+- int search_var_cond_all( char *lab, double value, o_vecT &list, int lag );
+As search_var_cond, but collects all the instances of the object that has the
+searched variable with the desired value in list, in creation order.
 
 - double overall_max( char *lab, int lag );
 Searches for the object having the variable lab. From that object, it considers
@@ -150,8 +160,8 @@ object. lab and lab2 must be in the same object.
 
 - void lsdqsort( char *obj, char *var, char *dir, int lag );
 Sorts the Objects whose label is obj according to the values of their
-variable var. The direction of sorting can be UP or DOWN. The method
-is just an interface for sort_asc and sort_desc below.
+variable var. The direction of sorting can be UP or DOWN. The values
+are computed once and sorted as cached keys (see sort_keys below).
 
 IMPORTANT:
 The initial Object must be the first element of the set of Objects to be sorted,
@@ -206,6 +216,10 @@ search_var( caller, label )
 that returns a variable whose name is label and then calls the method
 cal() for that variable (see variable::cal), that returns the desired value.
 
+- double cal( object *caller, int id, int lag );
+Same as above, but the element is identified by its interned label ID (see
+lab_id( ) in util.cpp) instead of the label string.
+
 - void init( object *_up, char *_label, bool _to_compute );
 Initialization for an object. Assigns _up to up and creates the label
 
@@ -248,9 +262,10 @@ and it si changed in n
 Add a variable before knowing its contents, setting to a default initialization
 values all the fields in the variable. It operates only on object this
 
-- void add_var_from_example( variable *example );
+- variable *add_var_from_example( variable *example, variable *last );
 Add a variable copying all the fields by the variable example.
-It operates only on object this
+It operates only on object this. If last is provided, the new variable is
+placed after it without further checks (used when creating new objects)
 
 - void empty( void ) ;
 Deletes all the contents of the object, freeing its memory. Used in delete_obj
@@ -268,11 +283,236 @@ see file.cpp
 
 #include "decl.h"
 
-char *qsort_lab;
-char *qsort_lab_secondary;
-int qsort_lag;
 object *globalcur;
 
+#ifndef _NP_
+mutex lock_layouts;						// lock for variables slots layouts
+#endif
+
+
+/****************************************************
+OBJ_SLAB / VAR_SLAB / LAG_SLAB
+Pools of objects, variables and small lagged values
+vectors (one per size up to LAG_SLABS values),
+created on first use and never destroyed, so they
+are available at any point of static initialization
+and exit
+****************************************************/
+slab_pool &obj_slab( void )
+{
+	static slab_pool *pool = new slab_pool( sizeof( object ) );
+	return *pool;
+}
+
+slab_pool &var_slab( void )
+{
+	static slab_pool *pool = new slab_pool( sizeof( variable ) );
+	return *pool;
+}
+
+slab_pool &lag_slab( int n )
+{
+	static slab_pool **pools = [ ]
+	{
+		slab_pool **p = new slab_pool *[ LAG_SLABS ];
+		for ( int i = 0; i < LAG_SLABS; ++i )
+			p[ i ] = new slab_pool( ( i + 1 ) * sizeof( double ) );
+		return p;
+	}( );
+
+	return *pools[ n - 1 ];
+}
+
+
+/****************************************************
+SLAB_POOL
+Fixed-size blocks pool used to allocate objects and
+variables, avoiding the general heap in the frequent
+creation and deletion of objects. Released blocks
+are reused first, and chunks are only returned to
+the system at exit
+****************************************************/
+slab_pool::slab_pool( size_t _size )
+{
+	size = ( _size + alignof( max_align_t ) - 1 ) / alignof( max_align_t ) * alignof( max_align_t );
+	used = SLAB_CHUNK;					// force new chunk on first allocation
+	free_list = NULL;
+}
+
+void *slab_pool::alloc( void )
+{
+	void *p;
+
+#ifndef _NP_
+	lock_guard < mutex > lock_slab( lock );
+#endif
+
+	if ( free_list != NULL )
+	{
+		p = free_list;
+		free_list = *( void ** ) p;
+		return p;
+	}
+
+	if ( used >= SLAB_CHUNK )
+	{
+		chunks.push_back( new char[ size * SLAB_CHUNK ] );
+		used = 0;
+	}
+
+	return chunks.back( ) + size * used++;
+}
+
+void slab_pool::release( void *p )
+{
+	if ( p == NULL )
+		return;
+
+#ifndef _NP_
+	lock_guard < mutex > lock_slab( lock );
+#endif
+
+	*( void ** ) p = free_list;
+	free_list = p;
+}
+
+
+/****************************************************
+OBJECT / VARIABLE
+Pooled allocation operators, using the general heap
+for any other size (derived types)
+****************************************************/
+void *object::operator new( size_t sz )
+{
+	if ( sz != sizeof( object ) )
+		return ::operator new( sz );
+
+	return obj_slab( ).alloc( );
+}
+
+void object::operator delete( void *p, size_t sz )
+{
+	if ( sz != sizeof( object ) )
+		::operator delete( p );
+	else
+		obj_slab( ).release( p );
+}
+
+void *variable::operator new( size_t sz )
+{
+	if ( sz != sizeof( variable ) )
+		return ::operator new( sz );
+
+	return var_slab( ).alloc( );
+}
+
+void variable::operator delete( void *p, size_t sz )
+{
+	if ( sz != sizeof( variable ) )
+		::operator delete( p );
+	else
+		var_slab( ).release( p );
+}
+
+
+/****************************************************
+VAR_LAYOUT::ADD
+Get the slot of the variables with label ID id in
+the objects of the type, assigning the next free slot
+if the label is new to the type. The slots table is
+only changed in place when not running: during a
+run other threads may be reading it, so a copy is
+published and the old table is kept until exit
+****************************************************/
+int var_layout::add( int id )
+{
+	int i, n, *tab, *tab1;
+	static vector < int * > retired;	// tables replaced during runs
+
+	tab = slots.load( memory_order_acquire );
+	if ( id < tab[ 0 ] && tab[ id + 1 ] >= 0 )
+		return tab[ id + 1 ];
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_layouts );
+
+	tab = slots.load( memory_order_relaxed );
+	if ( id < tab[ 0 ] && tab[ id + 1 ] >= 0 )
+		return tab[ id + 1 ];
+#endif
+
+	if ( running || id >= tab[ 0 ] )
+	{
+		n = max( id + 1, 2 * tab[ 0 ] );
+		tab1 = new int[ n + 1 ];
+		tab1[ 0 ] = n;
+
+		for ( i = 1; i <= n; ++i )
+			tab1[ i ] = i <= tab[ 0 ] ? tab[ i ] : -1;
+
+		if ( running )
+			retired.push_back( tab );
+		else
+			delete [ ] tab;
+
+		tab = tab1;
+	}
+
+	tab[ id + 1 ] = used++;
+	slots.store( tab, memory_order_release );
+
+	return tab[ id + 1 ];
+}
+
+
+/****************************************************
+VAR_SLOTS::BIND / ERASE / INSERT
+Maintain the fast look-up of the variables of an
+object, an array indexed by the slot assigned to
+each label in the object type (see var_layout), so
+all the instances of a type share the same slots
+****************************************************/
+void var_slots::bind( int obj_id )
+{
+	static unordered_map < int, var_layout * > *layouts = new unordered_map < int, var_layout * >;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_layouts );
+#endif
+
+	auto it = layouts->find( obj_id );
+	if ( it == layouts->end( ) )
+		it = layouts->emplace( obj_id, new var_layout ).first;
+
+	lay = it->second;
+	vars.clear( );
+}
+
+void var_slots::erase( int id )
+{
+	int s, *tab;
+
+	if ( lay == NULL || id < 0 || id >= ( tab = lay->slots.load( memory_order_acquire ) )[ 0 ] ||
+		 ( s = tab[ id + 1 ] ) < 0 || s >= ( int ) vars.size( ) )
+		return;
+
+	vars[ s ] = NULL;
+}
+
+void var_slots::insert( int id, variable *cv )
+{
+	int s;
+
+	if ( lay == NULL )
+		bind( -1 );						// object type not set
+
+	s = lay->add( id );
+	if ( s >= ( int ) vars.size( ) )
+		vars.resize( s + 1, NULL );
+
+	vars[ s ] = cv;
+}
+
 
 /****************************************************
 BRIDGE
@@ -339,11 +579,12 @@ void object::init( object *_up, const char *lab, bool _to_compute )
 {
 	up = _up;
 	v = NULL;
-	v_map.clear( );
-	next = NULL;
+	next = prev = NULL;
 	to_compute = _to_compute;
 	label = new char[ strlen( lab ) + 1 ];
 	strcpy( label, lab );
+	id = lab_id( label );
+	v_map.bind( id );
 	b = NULL;
 	b_map.clear( );
 	hook = NULL;
@@ -352,6 +593,13 @@ void object::init( object *_up, const char *lab, bool _to_compute )
 	cext = NULL;				// no C++ object extension yet
 	acounter = 0;				// "fail safe" when creating labels
 	lstCntUpd = 0;				// counter never updated
+	deferred = detached = false;
+#ifndef _NP_
+	if ( mut_log != NULL )
+		mut_number( this );		// detached until the end of the parallel job
+	else
+#endif
+		serial = ++objSerial;	// fixed serial number (creation order)
 	del_flag = NULL;			// address of flag to signal deletion
 	deleting = false;			// not being deleted
 }
@@ -370,7 +618,7 @@ void object::recreate_maps( void )
 	b_map.clear( );
 
 	for ( cv = v; cv != NULL; cv = cv->next )
-		v_map.insert( v_pairT( cv->label, cv ) );
+		v_map.insert( lab_id( cv->label ), cv );
 
 	for ( cb = b; cb != NULL; cb = cb->next )
 		b_map.insert( b_pairT( cb->blabel, cb ) );
@@ -410,11 +658,14 @@ void object::update( bool recurse, bool user )
 #endif
 				cv->cal( NULL, 0 );
 		}
+		else
+			if ( cv->dep_pos >= 0 )	// computed in the serial order from now
+				dep_use( cv );
 
 		if ( ! deleted	)
 		{
 			if ( cv->save || cv->savei )
-				cv->data[ t - cv->start ] = cv->val[ 0 ];
+				cv->saved( t ) = cv->lagged( 0 );
 #ifndef _NW_
 			if ( ! user && cv->plot == 1 )
 				plot_rt( cv );
@@ -444,10 +695,13 @@ GO_BROTHER
 ****************************************************/
 object *go_brother( object *c )
 {
-	if ( c == NULL || c->next == NULL )
+	if ( c == NULL )
 		return NULL;
 
-	return c->next;
+	// skip objects pending deletion in parallel jobs
+	for ( c = c->next; c != NULL && c->deferred; c = c->next );
+
+	return c;
 }
 
 
@@ -582,13 +836,23 @@ object *object::search( const char *lab, bool no_search )
 	object *cur;
 	b_mapT::iterator bit;
 
+	// skip the object if pending deletion in a parallel job
+	if ( deferred )
+	{
+		cur = go_brother( this );
+		return cur != NULL ? cur->search( lab, no_search ) : NULL;
+	}
+
 	// the current object?
 	if ( ! strcmp( label, lab ) )
 		return this;
 
 	// Search among the descendants of current object
 	if ( ( bit = b_map.find( lab ) ) != b_map.end( ) )
-		return bit->second->head;
+	{
+		cur = bit->second->head;
+		return cur != NULL && cur->deferred ? go_brother( cur ) : cur;
+	}
 
 	// stop if search is disabled
 	if ( no_search )
@@ -626,6 +890,9 @@ object *object::search_err( const char *lab, bool no_search, const char *errmsg
 						"create object in model structure",
 						false,
 						"object '%s' is missing for %s%s", lab, errmsg, no_search && cur != NULL ? " (NO_SEARCH enabled!)" : "");
+		else
+			if ( dep_state != 0 )		// record empty object type search, if required
+				dep_vacant( lab );
 
 		if ( no_zero_instance )
 			error_hard( "object has no instance",
@@ -772,7 +1039,7 @@ double object::initturbo( const char *lab, double tot = 0 )
 
 #ifndef _NP_
 	// prevent concurrent initialization by more than one thread
-	lock_guard < mutex > lock( parallel_comp );
+	lock_guard < comp_lock > lock( parallel_comp );
 #endif
 
 	if ( cb->mn != NULL )		// remove existing mnode
@@ -939,18 +1206,27 @@ is returned. This depends on the right choice of "this", that is, where the
 search is starting from.
 The field caller is used to avoid deadlocks when
 from descendants the search goes up again, or from the parent down.
-Uses the fast variable look-up map of the searched variables.
+Uses the fast variable look-up slots of the searched objects, an array
+indexed through the label ID interned by lab_id( ) (see var_slots). The
+string overload hashes the label to get the ID on every call, while the
+ID overload, used by the *_ID macros, makes no string hashing at all.
 *************************************************/
 variable *object::search_var( object *caller, const char *lab, bool no_error,
 							  bool no_search, bool search_sons )
+{
+	return search_var( caller, lab_id( lab ), no_error, no_search, search_sons );
+}
+
+variable *object::search_var( object *caller, int id, bool no_error,
+							  bool no_search, bool search_sons )
 {
 	bridge *cb;
+	object *cur;
 	variable *cv;
-	v_mapT::iterator vit;
 
 	// Search among the variables of current object
-	if ( ( vit = v_map.find( lab ) ) != v_map.end( ) )
-		return vit->second;
+	if ( ( cv = v_map.find( id ) ) != NULL )
+		return cv;
 
 	// stop if search is disabled except if direct sons must still be searched
 	if ( no_search && ! search_sons )
@@ -959,10 +1235,13 @@ variable *object::search_var( object *caller, const char *lab, bool no_error,
 	// Search among descendants
 	for ( cb = b, cv = NULL; cb != NULL; cb = cb->next )
 	{
+		// skip the first instances pending deletion in a parallel job
+		cur = cb->head != NULL && cb->head->deferred ? go_brother( cb->head ) : cb->head;
+
 		// search down only if one instance exists and the label is different from caller
-		if ( cb->head != NULL && ( caller == NULL || strcmp( cb->head->label, caller->label ) ) )
+		if ( cur != NULL && ( caller == NULL || strcmp( cur->label, caller->label ) ) )
 		{
-			cv = cb->head->search_var( this, lab, no_error, no_search, false );
+			cv = cur->search_var( this, id, no_error, no_search, false );
 			if ( cv != NULL )
 				return cv;
 		}
@@ -983,11 +1262,11 @@ variable *object::search_var( object *caller, const char *lab, bool no_error,
 				error_hard( "variable or parameter not found",
 							"create variable or parameter in model structure",
 							false,
-							"element '%s' is missing", lab );
+							"element '%s' is missing", lab_name( id ) );
 			return NULL;
 		}
 
-		cv = up->search_var( this, lab, no_error, false, false );
+		cv = up->search_var( this, id, no_error, false, false );
 	}
 
 	return cv;
@@ -999,25 +1278,36 @@ SEARCH_VAR_ERR
 *************************************************/
 variable *object::search_var_err( object *caller, const char *lab, bool no_search,
 								  bool search_sons, const char *errmsg )
+{
+	return search_var_err( caller, lab_id( lab ), no_search, search_sons, errmsg );
+}
+
+variable *object::search_var_err( object *caller, int id, bool no_search,
+								  bool search_sons, const char *errmsg )
 {
 	object *cur;
 	variable *cv;
 
-	cv = search_var( caller, lab, true, no_search, search_sons );
+	cv = search_var( caller, id, true, no_search, search_sons );
 	if ( cv == NULL && label != NULL )
 	{	// check if it is not a zero-instance object
 		cur = blueprint->search( label );				// current object in blueprint
-		if ( cur == NULL || cur->search_var( NULL, lab, true, no_search, search_sons ) == NULL )
+		if ( cur == NULL || ( cv = cur->search_var( NULL, id, true, no_search, search_sons ) ) == NULL )
 			error_hard( "variable or parameter not found",
 						"create variable or parameter in model structure",
 						false,
-						"element '%s' is missing for %s", lab, errmsg );
+						"element '%s' is missing for %s", lab_name( id ), errmsg );
+		else
+			if ( dep_state != 0 )		// record empty object type search, if required
+				dep_vacant( cv->up->label );
 
 		if ( no_zero_instance )
 			error_hard( "last object instance deleted",
 						"check your equation code to ensure at least one instance\nof any object is kept or use command USE_ZERO_INSTANCE",
 						true,
-						"all instances of the object containing '%s' were deleted", lab );
+						"all instances of the object containing '%s' were deleted", lab_name( id ) );
+
+		cv = NULL;										// do not return blueprint elements
 	}
 
 	return cv;
@@ -1042,9 +1332,13 @@ object *object::search_var_cond( const char *lab, double value, int lag )
 	if ( cv == NULL )
 		return NULL;
 
+	// use the parameter index, if available
+	if ( lag == 0 && ! no_search && idx_pars.size( ) > 0 && index_find( cv, value, cur ) )
+		return cur;
+
 	for ( cur = cv->up; cur != NULL; cur = cnext )
 	{
-		cnext = no_search ? cur->next : cur->hyper_next( );	// allow object suicide
+		cnext = no_search ? go_brother( cur ) : cur->hyper_next( );	// allow object suicide
 
 		res = cur->cal( lab, lag );
 		if ( res == value )
@@ -1055,132 +1349,368 @@ object *object::search_var_cond( const char *lab, double value, int lag )
 }
 
 
-/****************************
-INITTURBO_COND (*)
-Generate the data structure required to use the turbosearch with condition.
-*****************************/
-double object::initturbo_cond( const char *lab )
+/****************************************************
+SEARCH_VAR_COND_ALL (*)
+Fill list with all the object instances containing the Variable or Parameter
+lab with value value, in creation order, and return the number found. Uses
+the parameter index, if available, otherwise searches like search_var_cond.
+****************************************************/
+int object::search_var_cond_all( const char *lab, double value, o_vecT &list, int lag )
 {
-	bridge *cb;
 	object *cur, *cnext;
 	variable *cv;
-	b_mapT::iterator bit;
 
-	cv = search_var_err( this, lab, no_search, true, "turbo conditional searching" );
+	list.clear( );
+
+	cv = search_var_err( this, lab, no_search, true, "conditional searching" );
 	if ( cv == NULL )
 		return 0;
 
-	if ( cv->up->up == NULL )				// variable at root level?
-	{
-		error_hard( "invalid variable or parameter for turbo search",
-					"check your model structure to prevent this situation",
-					false,
-					"element '%s' is at root level (always single-instanced)", lab );
-		return 0;
-	}
+	if ( lag == 0 && ! no_search && idx_pars.size( ) > 0 && index_find( cv, value, cur, & list ) )
+		return list.size( );
 
-	// find the bridge which contains the object containing the variable
-	if ( ( bit = cv->up->up->b_map.find( cv->up->label ) ) == cv->up->up->b_map.end( ) )
+	for ( cur = cv->up; cur != NULL; cur = cnext )
 	{
-		error_hard( "internal problem in LSD",
-					"if error persists, please contact developers",
-					true,
-					"invalid data structure (bridge not found)" );
-		return 0;
+		cnext = no_search ? go_brother( cur ) : cur->hyper_next( );	// allow object suicide
+
+		if ( cur->cal( lab, lag ) == value )
+			list.push_back( cur );
 	}
 
+	sort( list.begin( ), list.end( ), [ ]( object *a, object *b ) { return a->serial < b->serial; } );
+
+	return list.size( );
+}
+
+
+/****************************************************
+PARAMETER INDEXES
+Parameters set with set_index have a hash index from
+value to the object instances containing them, built
+at the first conditional search of the run and kept
+updated as objects are added or deleted and the
+parameter is written. Each value bucket keeps the
+instances by serial number (creation order). Bulk
+changes of values (configuration loading, checkpoint
+resuming, scenario branching) just reset the indexes
+****************************************************/
+struct par_index
+{
+	bool built;											// index in use and updated
+	unordered_map < double, map < long, object * > > buckets;// instances by value
+};
+
+unordered_set < int > idx_pars;							// indexed parameter label IDs
+unordered_map < int, par_index > par_idxs;				// indexes by parameter label ID
+
 #ifndef _NP_
-	// prevent concurrent initialization by more than one thread
-	lock_guard < mutex > lock( parallel_comp );
+mutex lock_index;
 #endif
 
-	cb = bit->second;
-	cb->o_map.clear( );						// remove any existing mapping
 
-	// fill the map with the object values
-	for ( cur = cb->head; cur != NULL; cur = cnext )
+/****************************************************
+SET_INDEX (*)
+Set (or unset) the parameters with label lab to be
+indexed by value for conditional searching
+****************************************************/
+void set_index( const char *lab, bool on )
+{
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_index );
+#endif
+
+	if ( on )
+		idx_pars.insert( lab_id( lab ) );
+	else
 	{
-		cnext = cur->next;					// allow object suicide
-		cb->o_map.insert( o_pairT ( cur->cal( lab, 0 ), cur ) );
+		idx_pars.erase( lab_id( lab ) );
+		par_idxs.erase( lab_id( lab ) );
 	}
+}
 
-	// register the name of variable for which the map is set
-	cb->search_var = new char [ strlen( lab ) + 1 ];
-	strcpy( cb->search_var, lab );
 
-	return cb->o_map.size( );
+/****************************************************
+INDEX_RESET
+Discard the contents of all parameter indexes, to be
+rebuilt when next used
+****************************************************/
+void index_reset( void )
+{
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_index );
+#endif
+
+	par_idxs.clear( );
 }
 
 
-/****************************
-TURBOSEARCH_COND (*)
-Search the object instance containing a variable label with given value.
-Return the containing object instance, if found, or NULL if not found.
-This search exploits the structure created with 'initturbo_cond'.
-*****************************/
-object *object::turbosearch_cond( const char *lab, double value )
+/****************************************************
+INDEX_FIND
+Search the index of the parameter cv for the object
+instance with value, if the search is not restricted
+to part of the instances (starts at the first one)
+and the result does not depend on the instances order
+(single instance with value). If list is not NULL,
+collect all instances with value in creation order.
+Return false if the index cannot be used
+****************************************************/
+bool index_find( variable *cv, double value, object *&res, o_vecT *list )
 {
 	bridge *cb;
-	variable *cv;
-	b_mapT::iterator bit;
-	o_mapT::iterator oit;
+	object *cur;
+	variable *cv1;
 
-	cv = search_var_err( this, lab, no_search, true, "turbo conditional searching" );
-	if ( cv == NULL )
-		return NULL;
+	if ( cv->param != 1 || idx_pars.count( cv->id ) == 0 || is_nan( value ) )
+		return false;
 
-	if ( cv->up->up == NULL )				// variable at root level?
+	// searches starting after the first instance in the model are not indexed
+	for ( cur = cv->up; cur->up != NULL; cur = cur->up )
 	{
-		error_hard( "invalid variable or parameter for turbo search",
-					"check your model structure to prevent this situation",
-					false,
-					"element '%s' is at root level (always single-instanced)", lab );
-		return NULL;
+		cb = cur->up->search_bridge( cur->label, true );
+		if ( cb == NULL || cb->head != cur )
+			return false;
 	}
 
-	// find the bridge which contains the object containing the variable
-	if ( ( bit = cv->up->up->b_map.find( cv->up->label ) ) == cv->up->up->b_map.end( ) )
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_index );
+#endif
+
+	par_index &idx = par_idxs[ cv->id ];
+
+	if ( ! idx.built )
 	{
-		error_hard( "internal problem in LSD",
-					"if error persists, please contact developers",
-					true,
-					"invalid data structure (bridge not found)" );
-		return NULL;
+		idx.buckets.clear( );
+
+		for ( cur = cv->up; cur != NULL; cur = cur->hyper_next( cur->label ) )
+			if ( ( cv1 = cur->search_var( cur, cv->id, true, true ) ) != NULL && ! is_nan( cv1->lagged( 0 ) ) )
+				idx.buckets[ cv1->lagged( 0 ) ][ cur->serial ] = cur;
+
+		idx.built = true;
 	}
 
-	cb = bit->second;
+	auto it = idx.buckets.find( value );
 
-	if ( cb->o_map.size( ) == 0 || cb->search_var == NULL || strcmp( cb->search_var, lab ) )
+	if ( list != NULL )
 	{
-		error_hard( "invalid search operation",
-					"check your equation code to prevent this situation",
-					true,
-					"element '%s' is not initialized for turbo conditional search", lab );
-		return NULL;
+		if ( it != idx.buckets.end( ) )
+			for ( auto &o : it->second )
+				if ( ! o.second->deferred )
+					list->push_back( o.second );
+
+		return true;
 	}
 
-	// find the object containing the variable
-	if ( ( oit = cb->o_map.find( value ) ) != cb->o_map.end( ) )
-		return oit->second;
+	if ( it == idx.buckets.end( ) || it->second.size( ) == 0 )
+		res = NULL;
 	else
-		return NULL;
+		if ( it->second.size( ) == 1 )
+			res = it->second.begin( )->second->deferred ? NULL : it->second.begin( )->second;
+		else
+			return false;					// first in model order required
+
+	return true;
 }
 
 
 /****************************************************
-ADD_EMPTY_VAR
-Add a new (empty) Variable, used in the creation of the model structure
+INDEX_ADD
+Add the indexed parameters of the new object instance
+obj to the indexes in use
 ****************************************************/
-variable *object::add_empty_var( const char *lab )
+void index_add( object *obj )
 {
 	variable *cv;
 
-	if ( search_var( this, lab, true, true, false ) != NULL )
-	{
-		error_hard( "variable or parameter not added",
-					"choose an unique name for the element",
-					true,
-					"element '%s' already exists in object '%s'", lab, label );
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_index );
+#endif
+
+	for ( cv = obj->v; cv != NULL; cv = cv->next )
+		if ( cv->param == 1 && ! is_nan( cv->lagged( 0 ) ) )
+		{
+			auto it = par_idxs.find( cv->id );
+			if ( it != par_idxs.end( ) && it->second.built )
+				it->second.buckets[ cv->lagged( 0 ) ][ obj->serial ] = obj;
+		}
+}
+
+
+/****************************************************
+INDEX_DEL
+Remove the object instance obj and its descendants,
+about to be deleted, from the indexes in use
+****************************************************/
+void index_del( object *obj )
+{
+	bridge *cb;
+	object *cur;
+	variable *cv;
+
+	for ( cv = obj->v; cv != NULL; cv = cv->next )
+		if ( cv->param == 1 )
+			index_move( cv, cv->lagged( 0 ), NAN );
+
+	for ( cb = obj->b; cb != NULL; cb = cb->next )
+		for ( cur = cb->head; cur != NULL; cur = cur->next )
+			index_del( cur );
+}
+
+
+/****************************************************
+INDEX_MOVE
+Move the object instance containing the indexed
+parameter cv from the bucket of value old to the
+bucket of value value (NaN to just remove it)
+****************************************************/
+void index_move( variable *cv, double old, double value )
+{
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_index );
+#endif
+
+	auto it = par_idxs.find( cv->id );
+	if ( it == par_idxs.end( ) || ! it->second.built || old == value || cv->up->detached )
+		return;									// detached objects indexed when attached
+
+	auto bit = it->second.buckets.find( old );
+	if ( bit != it->second.buckets.end( ) )
+	{
+		bit->second.erase( cv->up->serial );
+		if ( bit->second.size( ) == 0 )
+			it->second.buckets.erase( bit );
+	}
+
+	if ( ! is_nan( value ) )
+		it->second.buckets[ value ][ cv->up->serial ] = cv->up;
+}
+
+
+/****************************
+INITTURBO_COND (*)
+Generate the data structure required to use the turbosearch with condition.
+*****************************/
+double object::initturbo_cond( const char *lab )
+{
+	bridge *cb;
+	object *cur, *cnext;
+	variable *cv;
+	b_mapT::iterator bit;
+
+	cv = search_var_err( this, lab, no_search, true, "turbo conditional searching" );
+	if ( cv == NULL )
+		return 0;
+
+	if ( cv->up->up == NULL )				// variable at root level?
+	{
+		error_hard( "invalid variable or parameter for turbo search",
+					"check your model structure to prevent this situation",
+					false,
+					"element '%s' is at root level (always single-instanced)", lab );
+		return 0;
+	}
+
+	// find the bridge which contains the object containing the variable
+	if ( ( bit = cv->up->up->b_map.find( cv->up->label ) ) == cv->up->up->b_map.end( ) )
+	{
+		error_hard( "internal problem in LSD",
+					"if error persists, please contact developers",
+					true,
+					"invalid data structure (bridge not found)" );
+		return 0;
+	}
+
+#ifndef _NP_
+	// prevent concurrent initialization by more than one thread
+	lock_guard < comp_lock > lock( parallel_comp );
+#endif
+
+	cb = bit->second;
+	cb->o_map.clear( );						// remove any existing mapping
+
+	// fill the map with the object values
+	for ( cur = cb->head != NULL && cb->head->deferred ? go_brother( cb->head ) : cb->head; cur != NULL; cur = cnext )
+	{
+		cnext = go_brother( cur );			// allow object suicide
+		cb->o_map.insert( o_pairT ( cur->cal( lab, 0 ), cur ) );
+	}
+
+	// register the name of variable for which the map is set
+	cb->search_var = new char [ strlen( lab ) + 1 ];
+	strcpy( cb->search_var, lab );
+
+	return cb->o_map.size( );
+}
+
+
+/****************************
+TURBOSEARCH_COND (*)
+Search the object instance containing a variable label with given value.
+Return the containing object instance, if found, or NULL if not found.
+This search exploits the structure created with 'initturbo_cond'.
+*****************************/
+object *object::turbosearch_cond( const char *lab, double value )
+{
+	bridge *cb;
+	variable *cv;
+	b_mapT::iterator bit;
+	o_mapT::iterator oit;
+
+	cv = search_var_err( this, lab, no_search, true, "turbo conditional searching" );
+	if ( cv == NULL )
+		return NULL;
+
+	if ( cv->up->up == NULL )				// variable at root level?
+	{
+		error_hard( "invalid variable or parameter for turbo search",
+					"check your model structure to prevent this situation",
+					false,
+					"element '%s' is at root level (always single-instanced)", lab );
+		return NULL;
+	}
+
+	// find the bridge which contains the object containing the variable
+	if ( ( bit = cv->up->up->b_map.find( cv->up->label ) ) == cv->up->up->b_map.end( ) )
+	{
+		error_hard( "internal problem in LSD",
+					"if error persists, please contact developers",
+					true,
+					"invalid data structure (bridge not found)" );
+		return NULL;
+	}
+
+	cb = bit->second;
+
+	if ( cb->o_map.size( ) == 0 || cb->search_var == NULL || strcmp( cb->search_var, lab ) )
+	{
+		error_hard( "invalid search operation",
+					"check your equation code to prevent this situation",
+					true,
+					"element '%s' is not initialized for turbo conditional search", lab );
+		return NULL;
+	}
+
+	// find the object containing the variable
+	if ( ( oit = cb->o_map.find( value ) ) != cb->o_map.end( ) )
+		return oit->second;
+	else
+		return NULL;
+}
+
+
+/****************************************************
+ADD_EMPTY_VAR
+Add a new (empty) Variable, used in the creation of the model structure
+****************************************************/
+variable *object::add_empty_var( const char *lab )
+{
+	variable *cv;
+
+	if ( search_var( this, lab, true, true, false ) != NULL )
+	{
+		error_hard( "variable or parameter not added",
+					"choose an unique name for the element",
+					true,
+					"element '%s' already exists in object '%s'", lab, label );
 		return NULL;
 	}
 
@@ -1202,7 +1732,7 @@ variable *object::add_empty_var( const char *lab )
 	}
 
 	cv->init( this, lab, -1, NULL, 0 );
-	v_map.insert( v_pairT ( lab, cv ) );
+	v_map.insert( lab_id( lab ), cv );
 
 	return cv;
 }
@@ -1212,29 +1742,35 @@ variable *object::add_empty_var( const char *lab )
 ADD_VAR_FROM_EXAMPLE
 Add a Variable identical to the example.
 ****************************************************/
-void object::add_var_from_example( variable *example )
+variable *object::add_var_from_example( variable *example, variable *last )
 {
 	variable *cv;
 
-	if ( search_var( this, example->label, true, true, false ) != NULL )
-	{
-		error_hard( "variable or parameter not added",
-					"choose an unique name for the element",
-					true,
-					"element '%s' already exists in object '%s'", example->label, label );
-		return;
-	}
-
-	if ( v == NULL )
-		cv = v = new variable;
+	if ( last != NULL )					// stamping a known new element after last
+		cv = last->next = new variable;
 	else
 	{
-		for ( cv = v; cv->next != NULL; cv = cv->next );
-		cv->next = new variable;
-		cv = cv->next;
+		if ( search_var( this, example->label, true, true, false ) != NULL )
+		{
+			error_hard( "variable or parameter not added",
+						"choose an unique name for the element",
+						true,
+						"element '%s' already exists in object '%s'", example->label, label );
+			return NULL;
+		}
+
+		if ( v == NULL )
+			cv = v = new variable;
+		else
+		{
+			for ( cv = v; cv->next != NULL; cv = cv->next );
+			cv->next = new variable;
+			cv = cv->next;
+		}
 	}
 
 	cv->init( this, example->label, example->num_lag, example->val, example->save );
+	cv->head = example->head;
 	cv->savei = example->savei;
 	cv->last_update = example->last_update;
 	cv->delay = example->delay;
@@ -1250,7 +1786,9 @@ void object::add_var_from_example( variable *example )
 	cv->deb_cnd_val = example->deb_cnd_val;
 	cv->data_loaded = example->data_loaded;
 
-	v_map.insert( v_pairT ( example->label, cv ) );
+	v_map.insert( lab_id( example->label ), cv );
+
+	return cv;
 }
 
 
@@ -1263,7 +1801,7 @@ void object::add_obj( const char *lab, int num, int propagate )
 {
 	int i;
 	bridge *cb;
-	object *cur, *cur1;
+	object *cur, *cur1, *last = NULL;
 
 #ifndef _NW_
 	if ( ! valid_label( lab ) )
@@ -1294,6 +1832,8 @@ void object::add_obj( const char *lab, int num, int propagate )
 				cur1 = cur1->next = new object;
 
 			cur1->init( cur, lab );
+			cur1->prev = i == 0 ? NULL : last;
+			last = cur1;
 		}
 
 		cur->b_map.insert( b_pairT ( lab, cb ) );
@@ -1361,10 +1901,10 @@ void move_obj( const char *lab, const char *dest )
 				else
 					cur1->next = no;
 
-				cur1 = no;
-
 				// clone object instance, variables and descending objects
-				cur1->init( d, lab, cur->to_compute );
+				no->init( d, lab, cur->to_compute );
+				no->prev = cur1;
+				cur1 = no;
 
 				for ( cv = cur->v; cv != NULL; cv = cv->next )
 					cur1->add_var_from_example( cv );
@@ -1426,6 +1966,9 @@ void object::replicate( int num, bool propagate )
 		cur->next = new object;
 		cur->next->init( up, label, to_compute );
 		cur->next->next = cur1;
+		cur->next->prev = cur;
+		if ( cur1 != NULL )
+			cur1->prev = cur->next;
 		cur->to_compute = to_compute;
 
 		cur1 = cur->next;
@@ -1497,6 +2040,304 @@ void copy_descendant( object *from, object *to )
 }
 
 
+#ifndef _NP_
+/****************************************************
+DEFERRED STRUCTURAL CHANGES
+While a parallel job is computed, objects additions
+and deletions, and the sorting of objects not owned
+by the job task (the object of the variable instance
+computed and its descendants), are logged by the
+thread instead of changing the shared model tree.
+Added objects are created detached and can be used
+and changed by the equation, but are only attached to
+the model, and become visible to searches and cycles,
+at the end of the job (the parallel update or
+dependency wave). Objects added to the task own
+object are attached at once instead, as in serial
+computation, except in dependency waves. Their final
+serial numbers are given at creation, from the
+position of the task in the job and the count of
+objects it created (see mut_number), and replaced at
+the end of the job by the ones of the serial creation
+order. Deleted objects are hidden from searches and
+cycles at once, but are only removed at the end of
+the job. The logs of all threads are applied in the
+order of the job tasks, so the resulting model is
+independent of the number of threads and of the
+tasks scheduling. Serial numbers used inside the job
+(as the counter-based random draws of the objects
+created in it) are the provisional ones, so variables
+which depend on them should not be computed in parallel
+****************************************************/
+thread_local object *mut_owner = NULL;	// object of current job task
+thread_local size_t mut_pos = 0;		// position of current job task
+thread_local vector < mut_op > *mut_log = NULL;// log of current thread (NULL: none)
+thread_local long mut_cnt = 0;			// objects created by current job task
+long mut_base = 0;						// last serial number before current job
+size_t mut_tasks = 0;					// number of positions in current job
+atomic < long > mut_top( 0 );			// highest serial number given in current job
+
+
+static void mut_push( char type, object *obj, const char *lab = "", const char *var1 = NULL, const char *var2 = NULL, const char *dir = "", int lag = 0 );
+
+
+/****************************************************
+MUT_NUMBER
+Give the provisional serial number to an object
+created detached by a job task. The k-th object
+created by the task at position pos of a job with n
+positions is numbered base + k * n + pos + 1, so the
+numbers are unique and do not depend on the number
+of threads or on the tasks scheduling. The creation
+is logged to give the final number at the end of the
+job (see mut_renumber)
+****************************************************/
+void mut_number( object *r )
+{
+	long top;
+
+	r->detached = true;
+	r->serial = mut_base + mut_cnt++ * ( long ) mut_tasks + ( long ) mut_pos + 1;
+
+	for ( top = mut_top; top < r->serial && ! mut_top.compare_exchange_weak( top, r->serial ); );
+
+	mut_push( 'n', r );
+}
+
+
+/****************************************************
+MUT_START
+Prepare the numbering of the objects created by the
+tasks of a job with n positions
+****************************************************/
+void mut_start( size_t n )
+{
+	mut_base = objSerial;
+	mut_tasks = n;
+	mut_top = objSerial;
+}
+
+
+/****************************************************
+MUT_END
+Advance the objects serial number counter past the
+numbers given in the current job
+****************************************************/
+void mut_end( void )
+{
+	objSerial = max( objSerial, ( long ) mut_top );
+}
+
+
+/****************************************************
+MUT_DEFER
+Check if changing the sons of object r must be
+deferred, because it is part of the model tree
+shared by the job tasks (or not owned by the task,
+if own is true)
+****************************************************/
+bool mut_defer( object *r, bool own )
+{
+	if ( mut_log == NULL )
+		return false;
+
+	for ( ; r != NULL; r = r->up )
+		if ( r->detached || ( own && r == mut_owner ) )
+			return false;
+
+	return true;
+}
+
+
+/****************************************************
+MUT_PUSH
+Log a structural change by the current job task
+****************************************************/
+static void mut_push( char type, object *obj, const char *lab, const char *var1, const char *var2, const char *dir, int lag )
+{
+	mut_op op;
+
+	op.type = type;
+	op.lag = lag;
+	op.pos = mut_pos;
+	op.obj = obj;
+	op.lab = lab;
+	op.var1 = var1 != NULL ? var1 : "";
+	op.var2 = var2 != NULL ? var2 : "";
+	op.dir = dir;
+
+	mut_log->push_back( op );
+}
+
+
+/****************************************************
+MUT_ATTACH
+Mark the objects attached to the model tree (and
+their descendants) and add them to the indexes
+****************************************************/
+static void mut_attach( object *r )
+{
+	bridge *cb;
+	object *cur;
+
+	r->detached = false;
+
+	if ( idx_pars.size( ) > 0 )
+		index_add( r );
+
+	for ( cb = r->b; cb != NULL; cb = cb->next )
+		for ( cur = cb->head; cur != NULL; cur = cur->next )
+			mut_attach( cur );
+}
+
+
+/****************************************************
+MUT_RENUMBER
+Give to the objects created in a job, logged in the
+order of the tasks, the serial numbers of the serial
+creation order, skipping the objects of the tasks
+flagged in skip (to be discarded), and updating the
+indexes of the objects already attached
+****************************************************/
+static void mut_renumber( vector < mut_op > &log, const vector < bool > &skip )
+{
+	bool idx;
+	size_t i;
+	variable *cv;
+
+	for ( i = 0; i < log.size( ); ++i )
+		if ( log[ i ].type == 'n' && ! skip[ i ] )
+		{
+			idx = idx_pars.size( ) > 0 && ! log[ i ].obj->detached;
+
+			if ( idx )
+				for ( cv = log[ i ].obj->v; cv != NULL; cv = cv->next )
+					if ( cv->param == 1 )
+						index_move( cv, cv->lagged( 0 ), NAN );
+
+			log[ i ].obj->serial = ++mut_base;
+
+			if ( idx )
+				for ( cv = log[ i ].obj->v; cv != NULL; cv = cv->next )
+					if ( cv->param == 1 )
+						index_move( cv, NAN, cv->lagged( 0 ) );
+		}
+
+	objSerial = mut_base;
+}
+
+
+/****************************************************
+MUT_APPLY
+Apply the structural changes logged by the job tasks
+in the order of the tasks, skipping the changes to
+objects deleted by a previous change and, if drop is
+not NULL, the changes by the tasks flagged in it
+****************************************************/
+void mut_apply( vector < mut_op > &log, const vector < bool > *drop )
+{
+	size_t i;
+	bridge *cb;
+	object *cur, *cnext;
+	vector < bool > skip( log.size( ), false );
+	unordered_map < object *, size_t > dead;
+
+	stable_sort( log.begin( ), log.end( ), [ ]( const mut_op &a, const mut_op &b ) { return a.pos < b.pos; } );
+
+	// discard the changes by dropped tasks
+	if ( drop != NULL )
+		for ( i = 0; i < log.size( ); ++i )
+			skip[ i ] = ( * drop )[ log[ i ].pos ];
+
+	mut_renumber( log, skip );
+
+	// find the changes to objects already deleted, before any is applied,
+	// making visible again the objects whose deletion is discarded
+	for ( i = 0; i < log.size( ); ++i )
+		if ( log[ i ].type == 'd' )
+		{
+			log[ i ].obj->deferred = false;
+			if ( ! skip[ i ] )
+				dead.emplace( log[ i ].obj, i );
+		}
+
+	if ( dead.size( ) > 0 )
+		for ( i = 0; i < log.size( ); ++i )
+			for ( cur = log[ i ].type == 'a' ? log[ i ].obj->up : log[ i ].obj; cur != NULL && ! skip[ i ]; cur = cur->up )
+			{
+				auto it = dead.find( cur );
+				skip[ i ] = it != dead.end( ) && it->second < i;
+			}
+
+	for ( i = 0; i < log.size( ); ++i )
+	{
+		mut_op &op = log[ i ];
+
+		switch ( op.type )
+		{
+			case 'a':
+				if ( skip[ i ] )		// parent deleted, discard the new objects
+				{
+					for ( cur = op.obj; cur != NULL; cur = cnext )
+					{
+						cnext = cur->next;
+						if ( ! no_ptr_chk )
+							obj_list.erase( cur );
+						cur->empty( );
+						delete cur;
+					}
+
+					break;
+				}
+
+				cb = op.obj->up->search_bridge( op.lab.c_str( ) );
+				if ( cb == NULL )
+					break;
+
+				cb->counter_updated = false;
+
+				if ( cb->head == NULL )
+					cb->head = op.obj;
+				else
+				{
+					for ( cur = cb->head; cur->next != NULL; cur = cur->next );
+					cur->next = op.obj;
+					op.obj->prev = cur;
+				}
+
+				for ( cur = op.obj; cur != NULL; cur = cur->next )
+					mut_attach( cur );
+
+				if ( samplers_on )
+					sampler_dirty( -1 );
+
+				break;
+
+			case 'd':
+				if ( ! skip[ i ] )
+					op.obj->delete_obj( NULL );
+
+				break;
+
+			case 's':
+				if ( skip[ i ] )
+					break;
+
+				if ( op.var2.empty( ) )
+					op.obj->lsdqsort( op.lab.c_str( ), op.var1.empty( ) ? NULL : op.var1.c_str( ), op.dir.c_str( ), op.lag );
+				else
+					op.obj->lsdqsort( op.lab.c_str( ), op.var1.c_str( ), op.var2.c_str( ), op.dir.c_str( ), op.lag );
+		}
+
+		if ( quit == 2 )
+			break;
+	}
+
+	log.clear( );
+}
+#endif
+
+
 /****************************************************
 ADD_N_OBJECTS2 (*)
 As the type with the example, but the example is taken from the blueprint
@@ -1521,11 +2362,14 @@ the example object (if >0) or current t (if =0)
 ****************************************************/
 object *object::add_n_objects2( const char *lab, int n, object *ex, int t_update )
 {
-	bool net;
+	bool defer, net;
 	int i;
 	bridge *cb, *cb1, *cb2;
 	object *cur, *cur1, *last, *first = NULL;
-	variable *cv;
+	variable *cv, *cv1;
+
+	if ( dep_state != 0 )				// record side effect, if required
+		dep_effect( lab );
 
 	// check the labels and prepare the bridge to attach to
 	for ( cb2 = b; cb2 != NULL && strcmp( cb2->blabel, lab ); cb2 = cb2->next );
@@ -1550,10 +2394,18 @@ object *object::add_n_objects2( const char *lab, int n, object *ex, int t_update
 
 #ifndef _NP_
 	// prevent concurrent additions by more than one thread
-	lock_guard < mutex > lock( parallel_comp );
+	lock_guard < comp_lock > lock( parallel_comp );
+
+	// in parallel jobs, attach to the shared model tree only at the end,
+	// except in the task own object, which is not changed by other tasks
+	// (while in dependency waves, as its changes may be discarded)
+	defer = mut_defer( this, ! dep_waving );
+#else
+	defer = false;
 #endif
 
-	cb2->counter_updated = false;
+	if ( ! defer )
+		cb2->counter_updated = false;
 
 	// check if the objects are nodes in a network (avoid using EX from blueprint)
 	cur = search( lab );
@@ -1572,9 +2424,10 @@ object *object::add_n_objects2( const char *lab, int n, object *ex, int t_update
 		if ( net )						// if objects are nodes in a network
 			cur->node = new netNode( );	// insert new nodes in network (as isolated nodes)
 
-		// create its variables and initialize them
-		for ( cv = ex->v; cv != NULL; cv = cv->next )
-		  cur->add_var_from_example( cv );
+		// create its variables and initialize them, stamped from the example
+		cur->v_map.reserve( ex->v_map.size( ) );
+		for ( cv1 = NULL, cv = ex->v; cv != NULL; cv = cv->next )
+			cv1 = cur->add_var_from_example( cv, cv1 );
 
 		for ( cv = cur->v; cv != NULL; cv = cv->next )
 		{
@@ -1633,19 +2486,33 @@ object *object::add_n_objects2( const char *lab, int n, object *ex, int t_update
 		if ( last == NULL )
 		{	// this is the first object created
 			first = cur;
-			if ( cb2->head == NULL )
-				cb2->head = cur;
-			else
+			if ( ! defer )				// or attach at the end of the parallel job
 			{
-				for ( cur1 = cb2->head; cur1->next != NULL; cur1 = cur1->next );
-				cur1->next = cur;
+				if ( cb2->head == NULL )
+					cb2->head = cur;
+				else
+				{
+					for ( cur1 = cb2->head; cur1->next != NULL; cur1 = cur1->next );
+					cur1->next = cur;
+					cur->prev = cur1;
+				}
 			}
 		}
 		else
+		{
 			last->next = cur;
+			cur->prev = last;
+		}
 
 		last = cur;
 
+		// detached objects are indexed when attached
+		if ( idx_pars.size( ) > 0 && ! cur->detached )
+			index_add( cur );
+
+		if ( samplers_on && ! cur->detached )
+			sampler_dirty( -1 );
+
 		// update object list for user pointer checking
 		if ( ! no_ptr_chk )
 		{
@@ -1657,6 +2524,20 @@ object *object::add_n_objects2( const char *lab, int n, object *ex, int t_update
 		}
 	}
 
+#ifndef _NP_
+	if ( defer )
+		mut_push( 'a', first, lab );
+	else
+		if ( mut_log != NULL && ! detached )
+		{	// objects of the task own object are attached now
+			for ( cur = first; cur != NULL; cur = cur->next )
+				mut_attach( cur );
+
+			if ( samplers_on )
+				sampler_dirty( -1 );
+		}
+#endif
+
 	return first;
 }
 
@@ -1707,10 +2588,26 @@ void object::delete_obj( variable *caller )
 	if ( cur == NULL )
 		return;					// ignore deleting null object
 
+	if ( dep_state != 0 )		// record side effect, if required
+		dep_delete( this );
+
+#ifndef _NP_
+	if ( mut_log != NULL )		// in parallel jobs, delete only at the end
+	{
+		deferred = true;		// but hide from searches and cycles now
+		mut_push( 'd', this );
+
+		if ( samplers_on )
+			sampler_dirty( -1 );
+
+		return;
+	}
+#endif
+
 	{							// create context for lock
 #ifndef _NP_
 		// prevent concurrent deletion by more than one thread
-		lock_guard < mutex > lock( parallel_comp );
+		lock_guard < comp_lock > lock( parallel_comp );
 #endif
 
 		if ( deleting )			// ignore if deleting already going on
@@ -1749,6 +2646,13 @@ void object::delete_obj( variable *caller )
 		obj_list.erase( this );
 	}
 
+	// remove from parameter indexes before values are collected
+	if ( idx_pars.size( ) > 0 )
+		index_del( this );
+
+	if ( samplers_on )
+		sampler_dirty( -1 );
+
 	// collect required variables BEFORE removing instances (bridge)
 	collect_cemetery( caller );
 
@@ -1763,7 +2667,10 @@ void object::delete_obj( variable *caller )
 		if ( cb->head == this )
 		{
 			if ( next != NULL )
+			{
 				cb->head = next;
+				next->prev = NULL;
+			}
 			else
 			{
 				if ( no_zero_instance )
@@ -1781,8 +2688,16 @@ void object::delete_obj( variable *caller )
 		}
 		else
 		{
-			for ( cur = cb->head; cur->next != this; cur = cur->next );
+			// use the previous sibling hint, which never refers to a released
+			// object as every chain change relinks it (checked for safety)
+			if ( prev != NULL && prev->next == this )
+				cur = prev;
+			else
+				for ( cur = cb->head; cur->next != this; cur = cur->next );
+
 			cur->next = next;
+			if ( next != NULL )
+				next->prev = cur;
 		}
 
 		cb->counter_updated = false;
@@ -1863,7 +2778,15 @@ void object::collect_cemetery( variable *caller )
 			set_lab_tit( cv );				// update last lab_tit
 
 			cv->end = t;					// define last period,
-			cv->data[ t - cv->start ] = cv->val[ 0 ];	// and last value
+			cv->saved( t ) = cv->lagged( 0 );	// and last value
+
+			if ( cv->stream_id >= 0 )		// streamed series are already on disk
+			{
+				stream_drop( cv );
+				cv->empty( caller == NULL || cv == caller );
+				delete cv;
+				continue;
+			}
 
 			// use C stdlib to be able to deallocate memory for deleted objects
 			cv->data = ( double * ) realloc( cv->data, ( t - cv->start + 1 ) * sizeof( double ) );
@@ -1942,7 +2865,7 @@ void object::delete_var( const char *lab )
 
 	if ( ! strcmp( v->label, lab ) )
 	{	// first variable in the chain
-		v_map.erase( lab );
+		v_map.erase( lab_id( lab ) );
 		cv = v->next;
 		v->empty( );
 		delete v;
@@ -1952,7 +2875,7 @@ void object::delete_var( const char *lab )
 		for ( cv = v; cv->next != NULL; cv = cv->next)
 			if ( ! strcmp( cv->next->label, lab ) )
 			{
-				v_map.erase( lab );
+				v_map.erase( lab_id( lab ) );
 				cv1 = cv->next->next;
 				cv->next->empty( );
 				delete cv->next;
@@ -1994,6 +2917,7 @@ void object::chg_lab( const char *lab )
 		delete [ ] cur->label;
 		cur->label = new char[ strlen( lab ) + 1 ];
 		strcpy( cur->label, lab );
+		cur->id = lab_id( lab );
 	}
 }
 
@@ -2009,11 +2933,12 @@ void object::chg_var_lab( const char *old, const char *newname )
 	for ( cv = v; cv != NULL; cv = cv->next)
 		if ( ! strcmp( cv->label, old ) )
 		{
-			v_map.erase( old );
+			v_map.erase( lab_id( old ) );
 			delete [ ] cv->label;
 			cv->label = new char[ strlen( newname ) + 1 ];
 			strcpy( cv->label, newname );
-			v_map.insert( v_pairT ( newname, cv ) );
+			cv->id = lab_id( newname );
+			v_map.insert( cv->id, cv );
 			break;
 		}
 }
@@ -2081,7 +3006,7 @@ double object::cal( object *caller, const char *lab, int lag, bool force_search
 
 #ifndef _NP_
 	if ( lag == 0 && parallel_ready && cv->parallel && cv->last_update < t && ! cv->dummy )
-		parallel_update( cv, this, caller );
+		parallel_update( cv, cv->up, caller );
 #endif
 	return cv->cal( caller, lag );
 }
@@ -2099,7 +3024,25 @@ double object::cal( object *caller, const char *lab, int lag )
 
 #ifndef _NP_
 	if ( lag == 0 && parallel_ready && cv->parallel && cv->last_update < t && ! cv->dummy )
-		parallel_update( cv, this, caller );
+		parallel_update( cv, cv->up, caller );
+#endif
+	return cv->cal( caller, lag );
+}
+
+double object::cal( object *caller, int id, int lag )
+{
+	variable *cv;
+
+	if ( quit == 2 )
+		return NAN;
+
+	cv = search_var_err( this, id, no_search, false, "retrieving" );
+	if ( cv == NULL )
+		return NAN;
+
+#ifndef _NP_
+	if ( lag == 0 && parallel_ready && cv->parallel && cv->last_update < t && ! cv->dummy )
+		parallel_update( cv, cv->up, caller );
 #endif
 	return cv->cal( caller, lag );
 }
@@ -2141,19 +3084,21 @@ double object::recal( const char *lab )
 	if ( cv == NULL )
 		return NAN;
 
+	if ( dep_state != 0 )				// record side effect, if required
+		dep_effect( lab );
+
 	// don't do anything if not yet computed in t
 	if ( cv->last_update < t )
-		return( cv->val[ 0 ] );
+		return( cv->lagged( 0 ) );
 
-	app = cv->val[ 0 ];
+	app = cv->lagged( 0 );
 
-	for ( i = 0; i < cv->num_lag; ++i )		// scale up the past values
-		cv->val[ i ] = cv->val[ i + 1 ];
+	i = cv->num_lag;							// scale up the past values
+	cv->head = cv->head < i ? cv->head + 1 : 0;
+	cv->roll_cnt = -1;
 
-	if ( ( cv->save || cv->savei ) && i + 1 <= t - cv->start )
-		cv->val[ i ] = cv->data[ t - i - 1 - cv->start ];
-	else
-		cv->val[ i ] = NAN;
+	if ( ! ( cv->save || cv->savei ) || i + 1 > t - cv->start || ! stream_read( cv, t - i - 1, cv->lagged( i ) ) )
+		cv->lagged( i ) = NAN;
 
 	cv->last_update = t - 1;
 	cv->next_update = t;
@@ -2208,6 +3153,50 @@ double object::sum( const char *lab1, int lag, bool cond, const char *lab2, cons
 }
 
 
+/****************************************************
+LAG_SUM (*)
+Compute the sum of num lagged values of Variable lab,
+from lag lag to lag + num - 1. If the variable has a
+rolling window of num values (see set_window), the
+window sum is used instead of requesting each lag.
+****************************************************/
+double object::lag_sum( const char *lab, int num, int lag )
+{
+	int i, first;
+	double tot;
+	variable *cv;
+
+	if ( quit == 2 )
+		return NAN;
+
+	cv = search_var_err( this, lab, no_search, false, "summing lags" );
+	if ( cv == NULL )
+		return NAN;
+
+	if ( cv->roll_k > 0 && cv->roll_k == num && lag >= 0 )
+	{
+		if ( lag == 0 )							// current value required
+			cal( this, lab, 0 );
+
+		// first stored lag (as in variable::cal)
+		first = ( cv->last_update < t ) ? lag - 1 : lag;
+
+		if ( first == 0 || ( first == 1 && num <= cv->num_lag ) )
+		{
+			if ( dep_state != 0 && lag > 0 )	// record dependency, if required
+				dep_call( cv, lag );
+
+			return cv->roll( first );
+		}
+	}
+
+	for ( tot = 0, i = lag; i < lag + num; ++i )
+		tot += cal( this, lab, i );
+
+	return tot;
+}
+
+
 /****************************************************
 OVERALL_MAX (*)
 Compute the maximum of lab1, considering only the
@@ -2401,7 +3390,129 @@ double object::whg_av( const char *lab1, const char *lab2, int lag, bool cond, c
 		}
 	}
 
-	return tot;
+	return tot;
+}
+
+
+/****************************************************
+MULTI_REDUCE (*)
+Compute n reductions over the instances of object lab
+in a single pass, according to the spec vector: sum
+("SUM"), average ("AVE"), count ("CNT", counting the
+instances satisfying 'V("lab") lop value' or the
+non-zero ones if lop is empty), maximum ("MAX") or
+minimum ("MIN"). Results are stored in res (n values).
+Elements are evaluated per instance in spec order, so
+the computation order is the same of an equivalent
+CYCLE over the instances. Values already computed in
+the current time step are read directly, bypassing
+the look-up and the update checks. If vals is not
+NULL, it receives all the values, instance-wise.
+The computation is made over the elements in a
+single branch of the model.
+Returns the number of instances reduced.
+****************************************************/
+double object::multi_reduce( const char *lab, int n, const reduce_spec *spec, double *res, vector < double > *vals, int lag )
+{
+	int i, m;
+	double val;
+	object *cur, *cnext;
+	variable *cv;
+
+	if ( n <= 0 || spec == NULL || res == NULL )
+		return 0;
+
+	vector < int > ids( n ), ops( n ), lopc( n );
+
+	for ( i = 0; i < n; ++i )
+	{
+		ids[ i ] = lab_id( spec[ i ].lab );
+
+		if ( ! strcmp( spec[ i ].op, "SUM" ) )
+			ops[ i ] = 0;
+		else
+			if ( ! strcmp( spec[ i ].op, "AVE" ) )
+				ops[ i ] = 1;
+			else
+				if ( ! strcmp( spec[ i ].op, "CNT" ) )
+					ops[ i ] = 2;
+				else
+					if ( ! strcmp( spec[ i ].op, "MAX" ) )
+						ops[ i ] = 3;
+					else
+						if ( ! strcmp( spec[ i ].op, "MIN" ) )
+							ops[ i ] = 4;
+						else
+						{
+							error_hard( "invalid reduction operation",
+										"use a valid operation (SUM AVE CNT MAX MIN)",
+										false,
+										"cannot reduce '%s' with '%s'", spec[ i ].lab, spec[ i ].op );
+							return 0;
+						}
+
+		if ( ops[ i ] == 2 && spec[ i ].lop != NULL && strlen( spec[ i ].lop ) > 0 )
+		{
+			lopc[ i ] = logic_op_code( spec[ i ].lop, "reducing" );
+			if ( lopc[ i ] < 0 )
+				return 0;
+		}
+		else
+			lopc[ i ] = -1;
+
+		res[ i ] = ( ops[ i ] == 3 ) ? - DBL_MAX : ( ops[ i ] == 4 ) ? DBL_MAX : 0;
+	}
+
+	if ( vals != NULL )
+		vals->clear( );
+
+	cur = search_err( lab, no_search, "reducing" );
+
+	for ( m = 0; cur != NULL; cur = cnext, ++m )
+	{
+		cnext = go_brother( cur );				// allow object suicide
+
+		for ( i = 0; i < n; ++i )
+		{
+			// fast path: already computed in the instance itself
+			if ( lag == 0 && ! debug_flag && ( cv = cur->v_map.find( ids[ i ] ) ) != NULL &&
+				 ( cv->param == 1 || ( cv->param == 0 && cv->last_update >= t && cv->dep_pos < 0 ) ) )
+				val = cv->lagged( 0 );
+			else
+				val = cur->cal( cur, ids[ i ], lag );
+
+			switch ( ops[ i ] )
+			{
+				case 0:
+				case 1:
+					res[ i ] += val;
+					break;
+				case 2:
+					if ( lopc[ i ] < 0 ? val != 0 : check_cond( val, lopc[ i ], spec[ i ].value ) )
+						++res[ i ];
+					break;
+				case 3:
+					if ( val > res[ i ] )
+						res[ i ] = val;
+					break;
+				case 4:
+					if ( val < res[ i ] )
+						res[ i ] = val;
+			}
+
+			if ( vals != NULL )
+				vals->push_back( val );
+		}
+	}
+
+	for ( i = 0; i < n; ++i )
+		if ( ops[ i ] == 1 )
+			res[ i ] = ( m > 0 ) ? res[ i ] / m : NAN;
+		else
+			if ( ops[ i ] > 2 && m == 0 )
+				res[ i ] = NAN;
+
+	return m;
 }
 
 
@@ -2417,6 +3528,22 @@ double object::med( const char *lab1, int lag, bool cond, const char *lab2, cons
 }
 
 
+/****************************************************
+LESS_NAN_LAST / GREATER_NAN_LAST
+Strict weak orderings of values, up and down, which
+place NaNs after all numbers
+****************************************************/
+bool less_nan_last( double a, double b )
+{
+	return isnan( b ) ? ! isnan( a ) : a < b;
+}
+
+bool greater_nan_last( double a, double b )
+{
+	return isnan( b ) ? ! isnan( a ) : a > b;
+}
+
+
 /****************************************************
 PERC (*)
 Compute the percentile p of lab1.
@@ -2472,13 +3599,15 @@ double object::perc( const char *lab1, double p, int lag, bool cond, const char
 
 	if ( n > 0 )
 	{
-		sort( vals.begin( ), vals.end( ) );
-
 		// compute using the C=1 variant a la NumPy
 		x = p * ( n - 1 ) + 1;
 		floor_x = floor( x );
-		vx = vals[ floor_x - 1 ];
-		vx1 = floor_x < n ? vals[ floor_x ] : vx;
+
+		// partial selection instead of full sort
+		auto pos = vals.begin( ) + floor_x - 1;
+		nth_element( vals.begin( ), pos, vals.end( ), less_nan_last );
+		vx = *pos;
+		vx1 = floor_x < n ? *min_element( pos + 1, vals.end( ), less_nan_last ) : vx;
 
 		return vx + modf( x, &tmp ) * ( vx1 - vx );
 	}
@@ -2552,6 +3681,9 @@ double object::count( const char *lab1, int lag, bool cond, const char *lab2, co
 	if ( cur == NULL )
 		return 0;
 
+	if ( dep_state != 0 )				// record object type reading, if required
+		dep_read( lab1 );
+
 	if ( cond )
 	{
 		lopc = logic_op_code( lop, "counting" );
@@ -2593,6 +3725,9 @@ double object::count_all( const char *lab1, int lag, bool cond, const char *lab2
 	if ( cur == NULL )
 		return 0;
 
+	if ( dep_state != 0 )				// record object type reading, if required
+		dep_read( lab1 );
+
 	if ( cond )
 	{
 		lopc = logic_op_code( lop, "counting" );
@@ -2692,13 +3827,7 @@ double object::stat( const char *lab1, double *r, int lag, bool cond, const char
 		r[ 1 ] /= n;
 		r[ 2 ] = r[ 2 ] / n - r[ 1 ] * r[ 1 ];
 		r[ 6 ] = r[ 2 ] >= 0 ? sqrt( r[ 2 ] ) : NAN;
-
-		sort( vals.begin( ), vals.end( ) );
-
-		if ( n % 2 == 0 )
-			r[ 5 ] = ( vals[ n / 2 - 1 ] + vals[ n / 2 ] ) / 2;
-		else
-			r[ 5 ] = vals[ n / 2 ];
+		r[ 5 ] = median( vals );		// partial selection, no full sort
 	}
 	else
 		r[ 1 ] = r[ 2 ] = r[ 3 ] = r[ 4 ] = r[ 5 ] = r[ 6 ] = NAN;
@@ -2708,54 +3837,108 @@ double object::stat( const char *lab1, double *r, int lag, bool cond, const char
 
 
 /****************************************************
-LSDQSORT (*)
-Use the qsort function in the standard library to sort
-a group of Object with label obj according to the values of var
-if var is NULL, try sorting using the network node id
+SORT_KEYS
+Order objects by their cached sorting keys, so
+each element is computed just once and not inside
+the comparator. The sort is stable (ties keep the
+current order) and large sets are sorted in chunks
+by the parallel workers, if not busy, and then
+merged, with the same result of the serial sort.
+NaN keys are placed last in both directions
 ****************************************************/
-int sort_function_up( const void *a, const void *b )
+struct sort_key
 {
-	if ( qsort_lab != NULL )		// variable defined?
-	{
-		if ( ( *( object ** ) a )->cal( qsort_lab, qsort_lag ) < ( *( object ** ) b )->cal( qsort_lab, qsort_lag ) )
-			return -1;
-		else
-			return 1;
-	}
+	double k1;							// primary key
+	double k2;							// secondary key
+	object *obj;
+};
 
-	// handles the case of node id comparison
-	if ( ( *( object ** ) a )->node->id < ( *( object ** ) b )->node->id )
-		return -1;
-	else
-		return 1;
+bool sort_key_up( const sort_key &a, const sort_key &b )
+{
+	if ( less_nan_last( a.k1, b.k1 ) )
+		return true;
+
+	if ( less_nan_last( b.k1, a.k1 ) )
+		return false;
+
+	return less_nan_last( a.k2, b.k2 );
+}
+
+bool sort_key_down( const sort_key &a, const sort_key &b )
+{
+	if ( greater_nan_last( a.k1, b.k1 ) )
+		return true;
+
+	if ( greater_nan_last( b.k1, a.k1 ) )
+		return false;
+
+	return greater_nan_last( a.k2, b.k2 );
 }
 
-int sort_function_down( const void *a, const void *b )
+void sort_keys( vector < sort_key > &keys, bool up )
 {
-	if ( qsort_lab != NULL )		// variable defined?
+	size_t i, parts, step, n = keys.size( );
+	bool ( *comp )( const sort_key &, const sort_key & ) = up ? sort_key_up : sort_key_down;
+	auto k0 = keys.begin( );
+
+	parts = 1;
+
+#ifndef _NP_
+	if ( n >= 2 * PAR_SORT_MIN )
+		parts = min( ( size_t ) task_threads( ), n / PAR_SORT_MIN );
+#endif
+
+	if ( parts < 2 )
 	{
-		if ( ( *( object ** ) a )->cal( qsort_lab, qsort_lag ) > ( *( object ** ) b )->cal( qsort_lab, qsort_lag ) )
-			return -1;
-		else
-			return 1;
+		stable_sort( k0, keys.end( ), comp );
+		return;
 	}
 
-	// handles the case of node id comparison
-	if ( ( *( object ** ) a )->node->id > ( *( object ** ) b )->node->id )
-		return -1;
-	else
-		return 1;
+#ifndef _NP_
+	vector < size_t > bound( parts + 1 );
+	vector < function < void( void ) > > tasks;
+
+	for ( i = 0; i <= parts; ++i )
+		bound[ i ] = n * i / parts;
+
+	// sort chunks in the parallel workers
+	for ( i = 0; i < parts; ++i )
+		tasks.emplace_back( [ =, &bound ] { stable_sort( k0 + bound[ i ], k0 + bound[ i + 1 ], comp ); } );
+
+	run_tasks( tasks );
+
+	// merge pairs of adjacent chunks, in parallel at each level
+	for ( step = 1; step < parts; step *= 2 )
+	{
+		tasks.clear( );
+
+		for ( i = 0; i + step < parts; i += 2 * step )
+			tasks.emplace_back( [ =, &bound ] { inplace_merge( k0 + bound[ i ], k0 + bound[ i + step ], k0 + bound[ min( i + 2 * step, parts ) ], comp ); } );
+
+		run_tasks( tasks );
+	}
+#endif
 }
 
+
+/****************************************************
+LSDQSORT (*)
+Sort a group of Object with label obj according to the values of var
+if var is NULL, try sorting using the network node id
+****************************************************/
 object *object::lsdqsort( const char *obj, const char *var, const char *direction, int lag )
 {
 	char dir[ 6 ];
 	int num, i;
 	bridge *cb;
-	object *cur, **mylist;
+	object *cur;
 	variable *cv;
+	vector < sort_key > keys;
 	bool useNodeId = ( var == NULL ) ? true : false;		// sort on node id and not on variable
 
+	if ( dep_state != 0 )				// record side effect, if required
+		dep_effect( obj );
+
 	if ( ! useNodeId )
 	{
 		cv = search_var_err( this, var, no_search, true, "sorting" );
@@ -2820,50 +4003,55 @@ object *object::lsdqsort( const char *obj, const char *var, const char *directio
 	}
 
 #ifndef _NP_
+	// in parallel jobs, sort objects not owned by the task only at the end
+	if ( mut_defer( cur->up, true ) )
+	{
+		mut_push( 's', this, obj, var, NULL, direction, lag );
+		return cb->head;
+	}
+
 	// prevent concurrent sorting by more than one thread
-	lock_guard < mutex > lock( parallel_comp );
+	lock_guard < comp_lock > lock( parallel_comp );
 #endif
 
+	strcpyn( dir, direction, 6 );
+	strupr( dir );
+
+	if ( strcmp( dir, "UP" ) && strcmp( dir, "DOWN" ) )
+	{
+		error_hard( "invalid sort option ('UP' or 'DOWN' required)",
+					"check your equation code to prevent this situation",
+					true,
+					"direction '%s' is invalid for sorting", direction );
+		return NULL;
+	}
+
 	cb->counter_updated = false;
 	cur = cb->head;
 
+	// extract the keys once
 	skip_next_obj( cur, &num );
-	mylist = new object *[ num ];
+	keys.resize( num );
 	for ( i = 0; i < num; ++i )
 	{
-		mylist[ i ] = cur;
+		keys[ i ].k1 = useNodeId ? cur->node->id : cur->cal( var, lag );
+		keys[ i ].k2 = 0;
+		keys[ i ].obj = cur;
 		cur = cur->next;
 	}
 
-	strcpyn( dir, direction, 6 );
-	strupr( dir );
-
-	qsort_lag = lag;
-	qsort_lab = ( char * ) var;
-
-	if ( ! strcmp( dir, "UP" ) )
-		qsort( ( void * ) mylist, num, sizeof( mylist[ 0 ] ), sort_function_up );
-	else
-		if ( ! strcmp( dir, "DOWN" ) )
-			qsort( ( void * ) mylist, num, sizeof( mylist[ 0 ] ), sort_function_down );
-		else
-		{
-			error_hard( "invalid sort option ('UP' or 'DOWN' required)",
-						"check your equation code to prevent this situation",
-						true,
-						"direction '%s' is invalid for sorting", direction );
-			delete [ ] mylist;
-			return NULL;
-		}
+	sort_keys( keys, ! strcmp( dir, "UP" ) );
 
-	cb->head = mylist[ 0 ];
+	cb->head = keys[ 0 ].obj;
+	cb->head->prev = NULL;
 
 	for ( i = 1; i < num; ++i )
-		( mylist[ i - 1 ] )->next = mylist[ i ];
-
-	mylist[ i - 1 ]->next = NULL;
+	{
+		keys[ i - 1 ].obj->next = keys[ i ].obj;
+		keys[ i ].obj->prev = keys[ i - 1 ].obj;
+	}
 
-	delete [ ] mylist;
+	keys[ i - 1 ].obj->next = NULL;
 
 	return cb->head;
 }
@@ -2873,51 +4061,17 @@ object *object::lsdqsort( const char *obj, const char *var, const char *directio
 LSDQSORT
 Two stage sorting. Objects with identical values of var1 are sorted according to their value of var2
 ****************************************************/
-int sort_function_up_two( const void *a, const void *b )
-{
-	double x, y;
-
-	x = ( *( object ** ) a )->cal( qsort_lab, qsort_lag );
-	y = ( *( object ** ) b )->cal( qsort_lab, qsort_lag );
-
-	if ( x < y )
-		return -1;
-	else
-		if ( x > y )
-			return 1;
-		else
-			if ( ( * ( object ** ) a )->cal( qsort_lab_secondary, qsort_lag ) < ( *( object ** ) b )->cal( qsort_lab_secondary, qsort_lag ) )
-				return -1;
-			else
-				return 1;
-}
-
-int sort_function_down_two( const void *a, const void *b )
-{
-	double x, y;
-
-	x = ( *( object ** ) a )->cal( qsort_lab, qsort_lag );
-	y = ( *( object ** ) b )->cal( qsort_lab, qsort_lag );
-
-	if ( x > y )
-		return -1;
-	else
-		if ( x < y )
-			return 1;
-		else
-			if ( ( *( object ** ) a )->cal( qsort_lab_secondary, qsort_lag ) > ( *( object ** ) b )->cal( qsort_lab_secondary, qsort_lag ) )
-				return -1;
-			else
-				return 1;
-}
-
 object *object::lsdqsort( const char *obj, const char *var1, const char *var2, const char *direction, int lag )
 {
 	char dir[ 6 ];
 	int num, i;
 	bridge *cb;
-	object *cur, **mylist;
+	object *cur;
 	variable *cv;
+	vector < sort_key > keys;
+
+	if ( dep_state != 0 )				// record side effect, if required
+		dep_effect( obj );
 
 	cb = search_bridge( obj, true );			// try to find the bridge
 
@@ -2963,51 +4117,55 @@ object *object::lsdqsort( const char *obj, const char *var1, const char *var2, c
 	}
 
 #ifndef _NP_
+	// in parallel jobs, sort objects not owned by the task only at the end
+	if ( mut_defer( cur->up, true ) )
+	{
+		mut_push( 's', this, obj, var1, var2, direction, lag );
+		return cb->head;
+	}
+
 	// prevent concurrent sorting by more than one thread
-	lock_guard < mutex > lock( parallel_comp );
+	lock_guard < comp_lock > lock( parallel_comp );
 #endif
 
+	strcpyn( dir, direction, 6 );
+	strupr( dir );
+
+	if ( strcmp( dir, "UP" ) && strcmp( dir, "DOWN" ) )
+	{
+		error_hard( "invalid sort option ('UP' or 'DOWN' required)",
+					"check your equation code to prevent this situation",
+					true,
+					"direction '%s' is invalid for sorting", direction );
+		return NULL;
+	}
+
 	cb->counter_updated = false;
 	cur = cb->head;
 
+	// extract both keys once
 	skip_next_obj( cur, &num );
-	mylist = new object *[ num ];
+	keys.resize( num );
 	for ( i = 0; i < num; ++i )
 	{
-		mylist[ i ] = cur;
+		keys[ i ].k1 = cur->cal( var1, lag );
+		keys[ i ].k2 = cur->cal( var2, lag );
+		keys[ i ].obj = cur;
 		cur = cur->next;
 	}
 
-	strcpyn( dir, direction, 6 );
-	strupr( dir );
-
-	qsort_lag = lag;
-	qsort_lab = ( char * ) var1;
-	qsort_lab_secondary = ( char * ) var2;
-
-	if ( ! strcmp( dir, "UP" ) )
-		qsort( ( void * ) mylist, num, sizeof( mylist[ 0 ] ), sort_function_up_two );
-	else
-		if ( ! strcmp( dir, "DOWN" ) )
-			qsort( ( void * ) mylist, num, sizeof( mylist[ 0 ] ), sort_function_down_two );
-		else
-		{
-			error_hard( "invalid sort option ('UP' or 'DOWN' required)",
-						"check your equation code to prevent this situation",
-						true,
-						"direction '%s' is invalid for sorting", direction );
-			delete [ ] mylist;
-			return NULL;
-		}
+	sort_keys( keys, ! strcmp( dir, "UP" ) );
 
-	cb->head = mylist[ 0 ];
+	cb->head = keys[ 0 ].obj;
+	cb->head->prev = NULL;
 
 	for ( i = 1; i < num; ++i )
-		( mylist[ i - 1 ] )->next = mylist[ i ];
-
-	mylist[ i - 1 ]->next = NULL;
+	{
+		keys[ i - 1 ].obj->next = keys[ i ].obj;
+		keys[ i ].obj->prev = keys[ i - 1 ].obj;
+	}
 
-	delete [ ] mylist;
+	keys[ i - 1 ].obj->next = NULL;
 
 	return cb->head;
 }
@@ -3024,6 +4182,8 @@ object *object::draw_rnd( const char *lo, const char *lv, int lag )
 	object *cur, *cur1, *cnext;
 	variable *cv;
 
+	( void ) lo;							// drawn objects are the ones containing lv
+
 	cv = search_var_err( this, lv, no_search, true, "random drawing" );
 	if ( cv == NULL )
 		return NULL;
@@ -3032,7 +4192,7 @@ object *object::draw_rnd( const char *lo, const char *lv, int lag )
 
 	for ( a = 0; cur != NULL; cur = cnext )
 	{
-		cnext = cur->next;						// allow object suicide
+		cnext = go_brother( cur );				// allow object suicide
 		a += cur->cal( lv, lag );
 	}
 
@@ -3061,9 +4221,9 @@ object *object::draw_rnd( const char *lo, const char *lv, int lag )
 	while ( b == a );	// avoid ran1 == 1
 
 	a = cur1->cal( lv, lag );
-	for ( cur = cur1, cur1 = cur1->next; a <= b && cur1 != NULL; cur1 = cnext )
+	for ( cur = cur1, cur1 = go_brother( cur1 ); a <= b && cur1 != NULL; cur1 = cnext )
 	{
-		cnext = cur1->next;						// allow object suicide
+		cnext = go_brother( cur1 );				// allow object suicide
 		a += cur1->cal( lv, lag );
 		cur = cur1;
 	}
@@ -3086,7 +4246,7 @@ object *object::draw_rnd( const char *lab )
 	if ( cur == NULL )
 		return NULL;
 
-	for ( a = 0 ; cur != NULL; cur = cur->next )
+	for ( a = 0 ; cur != NULL; cur = go_brother( cur ) )
 		++a;
 
 	if ( a == 0 )
@@ -3104,7 +4264,7 @@ object *object::draw_rnd( const char *lab )
 	}
 	while ( b == a );	// avoid ran1 == 1
 
-	for ( a = 1, cur = cur1, cur1 = cur1->next; a <= b && cur1 != NULL; cur1 = cur1->next )
+	for ( a = 1, cur = cur1, cur1 = go_brother( cur1 ); a <= b && cur1 != NULL; cur1 = go_brother( cur1 ) )
 	{
 		++a;
 		cur = cur1;
@@ -3124,6 +4284,8 @@ object *object::draw_rnd( const char *lo, const char *lv, int lag, double tot )
 	object *cur, *cur1, *cnext;
 	variable *cv;
 
+	( void ) lo;
+
 	if ( tot <= 0 )
 	{
 		error_hard( "invalid random draw option",
@@ -3140,11 +4302,11 @@ object *object::draw_rnd( const char *lo, const char *lv, int lag, double tot )
 	cur1 = cur = cv->up;
 
 	b = ran1( ) * tot;
-	cnext = cur1->next;
+	cnext = go_brother( cur1 );
 	a = cur1->cal( lv, lag );
 	for ( cur1 = cnext; a <= b && cur1 != NULL; cur1 = cnext )
 	{
-		cnext = cur1->next;				// allow object suicide
+		cnext = go_brother( cur1 );		// allow object suicide
 		a += cur1->cal( lv, lag );
 		cur = cur1;
 	}
@@ -3162,6 +4324,254 @@ object *object::draw_rnd( const char *lo, const char *lv, int lag, double tot )
 }
 
 
+/*********************
+DRAW_RND_BATCH (*)
+Draw randomly n objects with label lo with probabilities proportional
+to the values of their Variables or Parameters lv, with or without
+replacement, and put them in list in the order drawn. The draws use a
+weighted sampler (Fenwick tree) built once per time step for the group
+of objects and reused while the objects and lv are not changed, so each
+draw takes O(log N) instead of O(N). Draws without replacement remove
+the objects from the sampler itself, undoing the removals at the end.
+Return the number of objects drawn, which may be less than n without
+replacement
+*********************/
+struct rnd_sampler
+{
+	int left;							// number of positive weights
+	int time;							// time step when built
+	unsigned sgen;						// structure generation when built
+	unsigned lgen;						// weight label generation when built
+	double total;						// sum of weights
+	vector < double > w;				// weights in group order
+	vector < double > tree;				// Fenwick tree of weights (1-based)
+	o_vecT objs;						// objects in group order
+};
+
+bool samplers_on = false;				// samplers in use (writes tracked)
+unsigned smp_sgen = 0;					// objects structure generation
+map < tuple < object *, int, int >, rnd_sampler > samplers;// by first object, label ID and lag
+unordered_map < int, unsigned > smp_lgens;// weight label generations
+
+#ifndef _NP_
+mutex lock_sampler;
+#endif
+
+// find the position of the first weight whose cumulative sum is over b
+static int fenwick_find( const vector < double > &tree, double b )
+{
+	int pos = 0, step, n = tree.size( ) - 1;
+
+	for ( step = 1; 2 * step <= n; step *= 2 );
+
+	for ( ; step > 0; step /= 2 )
+		if ( pos + step <= n && tree[ pos + step ] <= b )
+		{
+			pos += step;
+			b -= tree[ pos ];
+		}
+
+	return pos;
+}
+
+// add to a weight, saving the changed tree nodes in undo, if any
+static void fenwick_add( vector < double > &tree, int pos, double d, vector < pair < int, double > > *undo = NULL )
+{
+	for ( ++pos; pos < ( int ) tree.size( ); pos += pos & - pos )
+	{
+		if ( undo != NULL )
+			undo->push_back( make_pair( pos, tree[ pos ] ) );
+
+		tree[ pos ] += d;
+	}
+}
+
+int object::draw_rnd_batch( const char *lo, const char *lv, int lag, int n, bool replace, o_vecT &list )
+{
+	double a, b;
+	int i, j, left, tries;
+	unsigned sgen, lgen;
+	object *cur, *cnext;
+	variable *cv;
+	o_vecT objs;
+	vector < double > w, tree;
+	vector < pair < int, double > > undo_w, undo_t;
+
+	( void ) lo;
+
+	list.clear( );
+
+	cv = search_var_err( this, lv, no_search, true, "random drawing" );
+	if ( cv == NULL || n <= 0 )
+		return 0;
+
+	auto key = make_tuple( cv->up, cv->id, lag );
+
+	{
+#ifndef _NP_
+		lock_guard < mutex > lock( lock_sampler );
+#endif
+		samplers_on = true;
+		sgen = smp_sgen;
+		lgen = smp_lgens[ cv->id ];
+		auto it = samplers.find( key );
+		if ( it != samplers.end( ) && it->second.time == t && it->second.sgen == sgen && it->second.lgen == lgen )
+			cv = NULL;							// sampler is valid
+	}
+
+	// (re)build the sampler, out of the lock as the weights may be computed now
+	if ( cv != NULL )
+	{
+		for ( a = 0, left = 0, cur = cv->up; cur != NULL; cur = cnext )
+		{
+			cnext = go_brother( cur );			// allow object suicide
+			b = cur->cal( lv, lag );
+
+			if ( is_nan( b ) || is_inf( b ) || b < 0 )
+			{
+				error_hard( "invalid random draw option",
+							"check your equation code to prevent this situation",
+							true,
+							"element '%s' has invalid value '%g' for random drawing", lv, b );
+				return 0;
+			}
+
+			objs.push_back( cur );
+			w.push_back( b );
+			a += b;
+
+			if ( b > 0 )
+				++left;
+		}
+
+		if ( a == 0 )
+		{
+			error_hard( "invalid random draw option",
+						"check your equation code to prevent this situation",
+						true,
+						"element '%s' has only zero values for random drawing", lv );
+			return 0;
+		}
+
+		// build the tree in linear time
+		tree.assign( w.size( ) + 1, 0 );
+		for ( i = 1; i < ( int ) tree.size( ); ++i )
+		{
+			tree[ i ] += w[ i - 1 ];
+			j = i + ( i & - i );
+			if ( j < ( int ) tree.size( ) )
+				tree[ j ] += tree[ i ];
+		}
+	}
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_sampler );
+#endif
+
+	if ( cv != NULL )
+	{
+		// prune the samplers no longer valid, including of deleted objects
+		for ( auto it = samplers.begin( ); it != samplers.end( ); )
+			if ( it->second.time != t || it->second.sgen != sgen )
+				it = samplers.erase( it );
+			else
+				++it;
+	}
+
+	rnd_sampler &s = samplers[ key ];
+
+	if ( cv != NULL )
+	{
+		s.left = left;
+		s.time = t;
+		s.sgen = sgen;
+		s.lgen = lgen;
+		s.total = a;
+		s.objs.swap( objs );
+		s.w.swap( w );
+		s.tree.swap( tree );
+	}
+
+	for ( a = s.total, left = s.left, tries = 0; ( int ) list.size( ) < n && left > 0 && a > 0; )
+	{
+		do
+		{
+			b = ran1( ) * a;
+		}
+		while ( b == a );	// avoid ran1 == 1
+
+		i = fenwick_find( s.tree, b );
+
+		if ( i >= ( int ) s.w.size( ) || s.w[ i ] <= 0 )
+		{	// rounding error in the tree sums, try again
+			if ( ++tries > MAX_DRAW_TRIES )
+				break;
+			continue;
+		}
+
+		list.push_back( s.objs[ i ] );
+
+		// without replacement, remove the drawn object keeping the undo list
+		if ( ! replace )
+		{
+			undo_w.push_back( make_pair( i, s.w[ i ] ) );
+			fenwick_add( s.tree, i, - s.w[ i ], & undo_t );
+			a -= s.w[ i ];
+			s.w[ i ] = 0;
+			--left;
+		}
+	}
+
+	// restore the removed objects exactly, in reverse order
+	for ( auto it = undo_t.rbegin( ); it != undo_t.rend( ); ++it )
+		s.tree[ it->first ] = it->second;
+
+	for ( auto it = undo_w.rbegin( ); it != undo_w.rend( ); ++it )
+		s.w[ it->first ] = it->second;
+
+	return list.size( );
+}
+
+
+/*********************
+SAMPLER_DIRTY
+Flag the change of the values of the label ID
+or of the objects structure (id < 0) to the
+random draw samplers in use
+*********************/
+void sampler_dirty( int id )
+{
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_sampler );
+#endif
+
+	if ( id < 0 )
+		++smp_sgen;
+	else
+	{
+		auto it = smp_lgens.find( id );
+		if ( it != smp_lgens.end( ) )
+			++it->second;
+	}
+}
+
+
+/*********************
+SAMPLER_RESET
+Discard all random draw samplers
+*********************/
+void sampler_reset( void )
+{
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_sampler );
+#endif
+
+	samplers.clear( );
+	smp_lgens.clear( );
+	samplers_on = false;
+}
+
+
 /****************************************************
  WRITE (*)
  Write the value in the Variable or Parameter lab, making it appearing as if
@@ -3169,7 +4579,7 @@ object *object::draw_rnd( const char *lo, const char *lv, int lag, double tot )
  ***************************************************/
 double object::write( const char *lab, double value, int time, int lag )
 {
-	int i, eff_lag, eff_time;
+	int eff_lag, eff_time;
 	variable *cv;
 
 	if ( ( ! use_nan && is_nan( value ) ) || is_inf( value ) )
@@ -3185,6 +4595,9 @@ double object::write( const char *lab, double value, int time, int lag )
 	if ( cv == NULL )
 		return NAN;
 
+	if ( dep_state != 0 )				// record side effect, if required
+		dep_effect( lab );
+
 	if ( cv->under_computation )
 	{
 		if ( ! cv->dummy )
@@ -3235,11 +4648,12 @@ double object::write( const char *lab, double value, int time, int lag )
 			return NAN;
 		}
 
-		cv->val[ - time - 1 ] = value;
+		cv->lagged( - time - 1 ) = value;
 		cv->last_update = 0;	// force new updating
+		cv->roll_cnt = -1;
 
 		if ( time == -1 && ( cv->save || cv->savei ) )
-			cv->data[ 0 ] = value;
+			stream_write( cv, cv->start, value );
 
 		// choose next update step for special updating variables
 		if ( cv->delay > 0 || cv->delay_range > 0 )
@@ -3269,8 +4683,7 @@ double object::write( const char *lab, double value, int time, int lag )
 		{
 			// if not yet calculated this time step, adjust lagged values
 			if ( time >= t && lag == 0 && cv->last_update < t )
-				for ( i = 0; i < cv->num_lag; ++i )
-					cv->val[ cv->num_lag - i ] = cv->val[ cv->num_lag - i - 1 ];
+				cv->shift( cv->lagged( 0 ) );
 
 			if ( lag == 0 )
 			{
@@ -3310,17 +4723,33 @@ double object::write( const char *lab, double value, int time, int lag )
 			}
 		}
 
-		cv->val[ eff_lag ] = value;
+		if ( cv->param == 1 && idx_pars.size( ) > 0 )
+			index_move( cv, cv->lagged( 0 ), value );
+
+		if ( samplers_on )
+			sampler_dirty( cv->id );
+
+		cv->lagged( eff_lag ) = value;
 		cv->last_update = time;
+		cv->roll_cnt = -1;						// rolling window changed
 
 		if ( cv->save || cv->savei )
 		{
 			if ( eff_time >= cv->start && eff_time <= cv->end )
-				cv->data[ eff_time - cv->start ] = value;
+			{
+				if ( ! stream_write( cv, eff_time, value ) )
+				{
+					error_hard( "invalid write operation",
+								"the period was already written to disk, do not use\nstreaming results mode (option -w) to rewrite past values",
+								true,
+								"cannot rewrite period %d of streamed variable '%s'", eff_time, lab );
+					return NAN;
+				}
+			}
 			else
 				// handle special initial case
 				if ( time == 0 && cv->start == 0 )
-					cv->data[ 0 ] = value;
+					cv->saved( 0 ) = value;
 		}
 	}
 
@@ -3359,19 +4788,19 @@ double object::increment( const char *lab, double value )
 	if ( cv == NULL )
 		return NAN;
 
-	if ( ! use_nan && is_nan( cv->val[ 0 ] ) )	// try to recover from RECALC
+	if ( ! use_nan && is_nan( cv->lagged( 0 ) ) )	// try to recover from RECALC
 		cv->cal( this, 0 );
 
-	if ( ( ! use_nan && is_nan( cv->val[ 0 ] ) ) || is_inf( cv->val[ 0 ] ) )
+	if ( ( ! use_nan && is_nan( cv->lagged( 0 ) ) ) || is_inf( cv->lagged( 0 ) ) )
 	{
 		error_hard( "invalid increment operation",
 					"check your equation code to prevent this situation",
 					true,
-					"current value '%g' of element '%s' is invalid for incrementing", cv->val[ 0 ], lab );
+					"current value '%g' of element '%s' is invalid for incrementing", cv->lagged( 0 ), lab );
 		return NAN;
 	}
 
-	new_value = cv->val[ 0 ] + value;
+	new_value = cv->lagged( 0 ) + value;
 	this->write( lab, new_value, t );
 
 	return new_value;
@@ -3402,19 +4831,19 @@ double object::multiply( const char *lab, double value )
 	if ( cv == NULL )
 		return NAN;
 
-	if ( ! use_nan && is_nan( cv->val[ 0 ] ) )	// try to recover from RECALC
+	if ( ! use_nan && is_nan( cv->lagged( 0 ) ) )	// try to recover from RECALC
 		cv->cal( this, 0 );
 
-	if ( ( ! use_nan && is_nan( cv->val[ 0 ] ) ) || is_inf( cv->val[ 0 ] ) )
+	if ( ( ! use_nan && is_nan( cv->lagged( 0 ) ) ) || is_inf( cv->lagged( 0 ) ) )
 	{
 		error_hard( "invalid multiply operation",
 					"check your equation code to prevent this situation",
 					true,
-					"current value '%g' of element '%s' is invalid for multiplying", cv->val[ 0 ], lab );
+					"current value '%g' of element '%s' is invalid for multiplying", cv->lagged( 0 ), lab );
 		return NAN;
 	}
 
-	new_value = cv->val[ 0 ] * value;
+	new_value = cv->lagged( 0 ) * value;
 	this->write( lab, new_value, t );
 
 	return new_value;
@@ -60,9 +60,16 @@ int geomErrCnt, binomErrCnt, cauchErrCnt, chisqErrCnt, expErrCnt;
 int fishErrCnt, studErrCnt, weibErrCnt, betaErrCnt, paretErrCnt, alaplErrCnt;
 double dimW = 0;						// lattice screen size
 double dimH = 0;
+bool lab_frozen = false;				// interned labels table frozen (run)
+l_mapT lab_ids;							// interned element labels IDs
+l_mapT lab_more_ids;					// labels IDs interned while frozen
+vector < char * > lab_names;			// interned element labels by ID
+vector < char * > lab_more_names;		// labels interned while frozen
 
 #ifndef _NP_
 mutex error;
+mutex lock_lab_more;					// lock for labels interned while frozen
+shared_timed_mutex lock_lab_ids;		// lock for interned labels table
 #endif
 
 
@@ -668,6 +675,125 @@ void reset_blueprint( object *r )
 }
 
 
+/***************************************************
+LAB_ID
+Return the dense integer ID of the element label lab,
+interning it in the global label table if new.
+IDs are never reused or released during the program
+execution, so they may be safely cached by callers
+(e.g., in static variables by the *_ID macros).
+While a simulation runs the table is frozen (see
+lab_freeze) and looked up without locking, and only
+the labels not interned before take a lock
+***************************************************/
+static char *lab_copy( const char *lab )
+{
+	char *copy = new char[ strlen( lab ) + 1 ];
+	strcpy( copy, lab );
+	return copy;
+}
+
+int lab_id( const char *lab )
+{
+	int id;
+	l_mapT::iterator it;
+
+	if ( lab_frozen )
+	{
+		if ( ( it = lab_ids.find( lab ) ) != lab_ids.end( ) )
+			return it->second;
+
+#ifndef _NP_
+		lock_guard < mutex > lock( lock_lab_more );
+#endif
+		if ( ( it = lab_more_ids.find( lab ) ) != lab_more_ids.end( ) )
+			return it->second;
+
+		id = lab_names.size( ) + lab_more_names.size( );
+		lab_more_names.push_back( lab_copy( lab ) );
+		lab_more_ids.emplace( lab_more_names.back( ), id );
+
+		return id;
+	}
+
+	{
+#ifndef _NP_
+		shared_lock < shared_timed_mutex > lock( lock_lab_ids );
+#endif
+		if ( ( it = lab_ids.find( lab ) ) != lab_ids.end( ) )
+			return it->second;
+	}
+
+#ifndef _NP_
+	lock_guard < shared_timed_mutex > lock( lock_lab_ids );
+#endif
+	// check again as another thread may have just added it
+	if ( ( it = lab_ids.find( lab ) ) != lab_ids.end( ) )
+		return it->second;
+
+	id = lab_names.size( );
+	lab_names.push_back( lab_copy( lab ) );
+	lab_ids.emplace( lab_names.back( ), id );
+
+	return id;
+}
+
+
+/***************************************************
+LAB_NAME
+Return the element label interned under ID id
+***************************************************/
+const char *lab_name( int id )
+{
+	if ( lab_frozen )
+	{
+		if ( id >= 0 && id < ( int ) lab_names.size( ) )
+			return lab_names[ id ];
+
+#ifndef _NP_
+		lock_guard < mutex > lock( lock_lab_more );
+#endif
+		if ( id < 0 || id >= ( int ) ( lab_names.size( ) + lab_more_names.size( ) ) )
+			return "(invalid)";
+
+		return lab_more_names[ id - lab_names.size( ) ];
+	}
+
+#ifndef _NP_
+	shared_lock < shared_timed_mutex > lock( lock_lab_ids );
+#endif
+	if ( id < 0 || id >= ( int ) lab_names.size( ) )
+		return "(invalid)";
+
+	return lab_names[ id ];
+}
+
+
+/***************************************************
+LAB_FREEZE
+Freeze (or unfreeze) the interned labels table, to be
+called only when no other thread is using it. When
+unfrozen, the labels interned while frozen are moved
+to the main table, keeping their IDs
+***************************************************/
+void lab_freeze( bool freeze )
+{
+	if ( ! freeze && lab_frozen )
+	{
+		for ( auto lab : lab_more_names )
+		{
+			lab_ids.emplace( lab, lab_names.size( ) );
+			lab_names.push_back( lab );
+		}
+
+		lab_more_ids.clear( );
+		lab_more_names.clear( );
+	}
+
+	lab_frozen = freeze;
+}
+
+
 /***************************************************
 SEARCH_DESCRIPTION
 ***************************************************/
@@ -1586,6 +1712,345 @@ double median( vector < double > & v )
 }
 
 
+/****************************************************
+DIST_INDEX
+Incremental order-statistics index of the values of
+a set of objects, allowing to keep a distribution up
+to date as values change, instead of sorting it again
+Randomized search tree (treap) ordered by value and
+object serial number, whose priorities are a hash of
+the serial number, so the tree shape (and the floating
+point results) only depends on the set of values and
+not on the order of updates
+Each node keeps the subtree count, sum and rank-weighted
+sum, so the Gini index, shares, order statistics and
+ranks take O(log N) time, and updates O(log N) time
+****************************************************/
+dist_index::dist_index( void )
+{
+	root = -1;
+	stamp = 0;
+}
+
+bool dist_index::less( int a, int b )
+{
+	if ( nodes[ a ].val != nodes[ b ].val )
+		return nodes[ a ].val < nodes[ b ].val;
+
+	return nodes[ a ].ser < nodes[ b ].ser;
+}
+
+void dist_index::pull( int n )
+{
+	dist_node &x = nodes[ n ];
+	int lc = 0, rc = 0;
+	double ls = 0, lw = 0, rs = 0, rw = 0;
+
+	if ( x.l >= 0 )
+	{
+		lc = nodes[ x.l ].cnt;
+		ls = nodes[ x.l ].sum;
+		lw = nodes[ x.l ].wsum;
+	}
+
+	if ( x.r >= 0 )
+	{
+		rc = nodes[ x.r ].cnt;
+		rs = nodes[ x.r ].sum;
+		rw = nodes[ x.r ].wsum;
+	}
+
+	x.cnt = lc + 1 + rc;
+	x.sum = ls + x.val + rs;
+	x.wsum = lw + ( lc + 1 ) * x.val + rw + ( lc + 1 ) * rs;
+}
+
+void dist_index::split( int n, int e, int &a, int &b )
+{
+	if ( n < 0 )
+	{
+		a = b = -1;
+		return;
+	}
+
+	if ( less( n, e ) )
+	{
+		split( nodes[ n ].r, e, nodes[ n ].r, b );
+		a = n;
+	}
+	else
+	{
+		split( nodes[ n ].l, e, a, nodes[ n ].l );
+		b = n;
+	}
+
+	pull( n );
+}
+
+int dist_index::merge( int a, int b )
+{
+	if ( a < 0 )
+		return b;
+
+	if ( b < 0 )
+		return a;
+
+	if ( nodes[ a ].prio > nodes[ b ].prio )
+	{
+		nodes[ a ].r = merge( nodes[ a ].r, b );
+		pull( a );
+		return a;
+	}
+
+	nodes[ b ].l = merge( a, nodes[ b ].l );
+	pull( b );
+	return b;
+}
+
+int dist_index::insert( int n, int e )
+{
+	if ( n < 0 )
+		return e;
+
+	if ( nodes[ e ].prio > nodes[ n ].prio )
+	{
+		split( n, e, nodes[ e ].l, nodes[ e ].r );
+		pull( e );
+		return e;
+	}
+
+	if ( less( e, n ) )
+		nodes[ n ].l = insert( nodes[ n ].l, e );
+	else
+		nodes[ n ].r = insert( nodes[ n ].r, e );
+
+	pull( n );
+	return n;
+}
+
+int dist_index::erase( int n, int e )
+{
+	if ( n < 0 )
+		return -1;
+
+	if ( n == e )
+		return merge( nodes[ n ].l, nodes[ n ].r );
+
+	if ( less( e, n ) )
+		nodes[ n ].l = erase( nodes[ n ].l, e );
+	else
+		nodes[ n ].r = erase( nodes[ n ].r, e );
+
+	pull( n );
+	return n;
+}
+
+void dist_index::update( object *o, double x )
+{
+	int e;
+	uint64_t h;
+	auto it = pos.find( o );
+
+	if ( it != pos.end( ) )
+	{
+		e = it->second;
+		nodes[ e ].stamp = stamp;
+
+		// unchanged value of the same object (the address may be reused)
+		if ( nodes[ e ].val == x && nodes[ e ].ser == o->serial )
+			return;
+
+		root = erase( root, e );
+	}
+	else
+	{
+		if ( free_nodes.empty( ) )
+		{
+			e = nodes.size( );
+			nodes.emplace_back( );
+		}
+		else
+		{
+			e = free_nodes.back( );
+			free_nodes.pop_back( );
+		}
+
+		nodes[ e ].stamp = stamp;
+		nodes[ e ].obj = o;
+		nodes[ e ].ser = -1;
+		pos[ o ] = e;
+	}
+
+	if ( nodes[ e ].ser != o->serial )
+	{
+		// splitmix64 finalizer of the serial number
+		h = ( uint64_t ) o->serial + 0x9E3779B97F4A7C15ull;
+		h = ( h ^ ( h >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+		h = ( h ^ ( h >> 27 ) ) * 0x94D049BB133111EBull;
+
+		nodes[ e ].ser = o->serial;
+		nodes[ e ].prio = h ^ ( h >> 31 );
+	}
+
+	nodes[ e ].val = x;
+	nodes[ e ].l = nodes[ e ].r = -1;
+	pull( e );
+	root = insert( root, e );
+}
+
+void dist_index::remove( object *o )
+{
+	auto it = pos.find( o );
+
+	if ( it == pos.end( ) )
+		return;
+
+	root = erase( root, it->second );
+	free_nodes.push_back( it->second );
+	pos.erase( it );
+}
+
+void dist_index::clear( void )
+{
+	root = -1;
+	nodes.clear( );
+	free_nodes.clear( );
+	pos.clear( );
+}
+
+void dist_index::mark( void )
+{
+	++stamp;
+}
+
+void dist_index::sweep( void )
+{
+	for ( auto it = pos.begin( ); it != pos.end( ); )
+		if ( nodes[ it->second ].stamp != stamp )
+		{
+			root = erase( root, it->second );
+			free_nodes.push_back( it->second );
+			it = pos.erase( it );
+		}
+		else
+			++it;
+}
+
+int dist_index::size( void )
+{
+	return root < 0 ? 0 : nodes[ root ].cnt;
+}
+
+double dist_index::total( void )
+{
+	return root < 0 ? 0 : nodes[ root ].sum;
+}
+
+double dist_index::gini( void )
+{
+	int n = size( );
+	double s = total( );
+
+	if ( n == 0 || s <= 1e-10 )
+		return 0;
+
+	return ( 2 * nodes[ root ].wsum - ( n + 1 ) * s ) / ( n * s );
+}
+
+double dist_index::sum_below( int k )
+{
+	int n = root;
+	double acc = 0;
+
+	while ( n >= 0 && k > 0 )
+	{
+		dist_node &x = nodes[ n ];
+		int lc = x.l >= 0 ? nodes[ x.l ].cnt : 0;
+
+		if ( k <= lc )
+			n = x.l;
+		else
+		{
+			acc += ( x.l >= 0 ? nodes[ x.l ].sum : 0 ) + x.val;
+			k -= lc + 1;
+			n = x.r;
+		}
+	}
+
+	return acc;
+}
+
+double dist_index::select( int k )
+{
+	int n = root;
+
+	while ( n >= 0 )
+	{
+		dist_node &x = nodes[ n ];
+		int lc = x.l >= 0 ? nodes[ x.l ].cnt : 0;
+
+		if ( k < lc )
+			n = x.l;
+		else
+			if ( k == lc )
+				return x.val;
+			else
+			{
+				k -= lc + 1;
+				n = x.r;
+			}
+	}
+
+	return NAN;
+}
+
+int dist_index::rank( object *o )
+{
+	int n = root, r = 0, e;
+	auto it = pos.find( o );
+
+	if ( it == pos.end( ) )
+		return -1;
+
+	e = it->second;
+
+	while ( n >= 0 )
+	{
+		int lc = nodes[ n ].l >= 0 ? nodes[ nodes[ n ].l ].cnt : 0;
+
+		if ( n == e )
+			return r + lc;
+
+		if ( less( e, n ) )
+			n = nodes[ n ].l;
+		else
+		{
+			r += lc + 1;
+			n = nodes[ n ].r;
+		}
+	}
+
+	return -1;
+}
+
+void dist_index::walk( int n, vector < o_pairT > &out )
+{
+	if ( n < 0 )
+		return;
+
+	walk( nodes[ n ].l, out );
+	out.push_back( o_pairT( nodes[ n ].val, nodes[ n ].obj ) );
+	walk( nodes[ n ].r, out );
+}
+
+void dist_index::sorted( vector < o_pairT > &out )
+{
+	out.clear( );
+	out.reserve( size( ) );
+	walk( root, out );
+}
+
+
 /***************************************************
 FACT
 Factorial function
@@ -2062,10 +2527,12 @@ mt19937 mt32;						// Mersenne-Twister 32 bits generator
 mt19937_64 mt64;					// Mersenne-Twister 64 bits generator
 ranlux24 lf24;						// lagged fibonacci 24 bits generator
 ranlux48 lf48;						// lagged fibonacci 48 bits generator
+unsigned ctr_seed = 0;				// seed keying counter-based draws
 
 void init_random( unsigned seed )
 {
 	idum = -seed;					// unused (legacy code only)
+	ctr_seed = seed;				// counter-based (per element) key
 	lc1.seed( seed );				// linear congruential (internal)
 	lc2.seed( seed );				// linear congruential (user)
 	mt32.seed( seed );				// Mersenne-Twister 32 bits
@@ -2074,6 +2541,31 @@ void init_random( unsigned seed )
 	lf48.seed( seed );				// lagged fibonacci 48 bits
 }
 
+
+/****************************************************
+RANDOM_STATE / SET_RANDOM_STATE
+Get and set the state of all pseudo-random number
+generators as text, to save and restore checkpoints
+****************************************************/
+string random_state( void )
+{
+	ostringstream state;
+
+	state << ran_gen_id << ' ' << idum << ' ' << ctr_seed << ' ' << lc1 << ' ' << lc2 << ' ' << mt32 << ' ' << mt64 << ' ' << lf24 << ' ' << lf48;
+
+	return state.str( );
+}
+
+bool set_random_state( const string &state )
+{
+	istringstream in( state );
+
+	// engines extraction does not skip leading white space
+	in >> ran_gen_id >> idum >> ctr_seed >> ws >> lc1 >> ws >> lc2 >> ws >> mt32 >> ws >> mt64 >> ws >> lf24 >> ws >> lf48;
+
+	return ! in.fail( );
+}
+
 template < class distr > double draw_rd( distr &d )
 {
 #ifndef _NP_
@@ -2144,6 +2636,9 @@ Generate the draw using current generator object
 ***************************************************/
 template < class distr > double draw_gen( distr &d )
 {
+	if ( dep_state != 0 )				// shared generator draws are side effects
+		dep_effect( NULL );
+
 	switch ( ran_gen_id )
 	{
 		case 0:						// system (not pseudo) random generator
@@ -2209,6 +2704,189 @@ void *set_random( int gen )
 }
 
 
+/***************************************************
+COUNTER-BASED RANDOM DRAWS
+Philox4x32-10 generator: each draw is a pure function
+of the key (seed, run) and of the counter (object
+serial number, variable label hash, time step, draw
+number), so no state is shared among threads and the
+same element gets the same draws whatever the order
+(or thread) in which it is computed
+Draw numbers restart every time step for each
+variable instance, and each draw may consume up to
+4096 blocks of 4 32-bit words
+***************************************************/
+struct ctr_engine
+{
+	typedef uint32_t result_type;
+
+	uint32_t key[ 2 ];
+	uint32_t ctr[ 4 ];
+	uint32_t buf[ 4 ];
+	int pos;
+
+	ctr_engine( object *obj, variable *var );
+
+	static constexpr result_type min( void ) { return 0; }
+	static constexpr result_type max( void ) { return UINT32_MAX; }
+
+	result_type operator( )( void );
+	double unif( void );
+};
+
+ctr_engine::ctr_engine( object *obj, variable *var )
+{
+	if ( var->rnd_t != t )			// first draw in the period?
+	{
+		var->rnd_t = t;
+		var->rnd_cnt = 0;
+	}
+
+	key[ 0 ] = ctr_seed;
+	key[ 1 ] = ( uint32_t ) cur_sim;
+	ctr[ 0 ] = ( uint32_t ) obj->serial;
+	ctr[ 1 ] = var->rnd_key;
+	ctr[ 2 ] = ( uint32_t ) t;
+	ctr[ 3 ] = var->rnd_cnt++ << 12;
+	pos = 4;
+}
+
+ctr_engine::result_type ctr_engine::operator( )( void )
+{
+	int i;
+	uint32_t k0, k1, c[ 4 ];
+	uint64_t p0, p1;
+
+	if ( pos < 4 )
+		return buf[ pos++ ];
+
+	for ( i = 0; i < 4; ++i )
+		c[ i ] = ctr[ i ];
+
+	for ( k0 = key[ 0 ], k1 = key[ 1 ], i = 0; i < 10; ++i, k0 += 0x9E3779B9, k1 += 0xBB67AE85 )
+	{
+		p0 = ( uint64_t ) 0xD2511F53 * c[ 0 ];
+		p1 = ( uint64_t ) 0xCD9E8D57 * c[ 2 ];
+		c[ 0 ] = ( uint32_t ) ( p1 >> 32 ) ^ c[ 1 ] ^ k0;
+		c[ 1 ] = ( uint32_t ) p1;
+		c[ 2 ] = ( uint32_t ) ( p0 >> 32 ) ^ c[ 3 ] ^ k1;
+		c[ 3 ] = ( uint32_t ) p0;
+	}
+
+	for ( i = 0; i < 4; ++i )
+		buf[ i ] = c[ i ];
+
+	++ctr[ 3 ];						// next block in the same draw
+	pos = 1;
+
+	return buf[ 0 ];
+}
+
+// 53-bit resolution uniform in (0,1)
+double ctr_engine::unif( void )
+{
+	uint32_t a = ( *this )( ) >> 5, b = ( *this )( ) >> 6;
+	return ( a * 67108864.0 + b + 0.5 ) / 9007199254740992.0;
+}
+
+
+/***************************************************
+RND_CTR_KEY
+Hash (FNV-1a) of a variable label to key its draws
+***************************************************/
+unsigned rnd_ctr_key( const char *lab )
+{
+	uint32_t h = 2166136261u;
+
+	for ( ; *lab != '\0'; ++lab )
+		h = ( h ^ ( unsigned char ) *lab ) * 16777619u;
+
+	return h;
+}
+
+
+/***************************************************
+RND_CTR
+Counter-based draw in (0,1) for the pair object/variable
+***************************************************/
+double rnd_ctr( object *obj, variable *var )
+{
+	ctr_engine eng( obj, var );
+	return eng.unif( );
+}
+
+
+/****************************************************
+UNIFORM_CTR
+****************************************************/
+double uniform_ctr( object *obj, variable *var, double min, double max )
+{
+	ctr_engine eng( obj, var );
+	return min + ( max - min ) * eng.unif( );
+}
+
+
+/***************************************************
+NORM_CTR
+Box-Muller transform, so it takes a single block
+***************************************************/
+double norm_ctr( object *obj, variable *var, double mean, double dev )
+{
+	static bool normStopErr;
+
+	if ( dev < 0 )
+	{
+		warn_distr( & normErrCnt, & normStopErr, "norm_ctr", "negative standard deviation" );
+		return mean;
+	}
+
+	ctr_engine eng( obj, var );
+	double u = eng.unif( );
+	return mean + dev * sqrt( -2 * log( u ) ) * cos( 2 * M_PI * eng.unif( ) );
+}
+
+
+/***************************************************
+LNORM_CTR
+***************************************************/
+double lnorm_ctr( object *obj, variable *var, double mean, double dev )
+{
+	static bool lnormStopErr;
+
+	if ( dev < 0 )
+	{
+		warn_distr( & lnormErrCnt, & lnormStopErr, "lnorm_ctr", "negative standard deviation" );
+		return exp( mean );
+	}
+
+	return exp( norm_ctr( obj, var, mean, dev ) );
+}
+
+
+/***************************************************
+BETA_CTR
+***************************************************/
+double beta_ctr( object *obj, variable *var, double alpha, double beta )
+{
+	static bool betaStopErr;
+
+	if ( alpha <= 0 || beta <= 0 )
+	{
+		warn_distr( & betaErrCnt, & betaStopErr, "beta_ctr", "non-positive alpha or beta parameter" );
+
+		if ( alpha < beta )
+			return 0.0;
+		else
+			return 1.0;
+	}
+
+	ctr_engine eng( obj, var );
+	gamma_distribution< double > distr1( alpha, 1.0 ), distr2( beta, 1.0 );
+	double draw = distr1( eng );
+	return draw / ( draw + distr2( eng ) );
+}
+
+
 /****************************************************
 RND_INT
 ****************************************************/
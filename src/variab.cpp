@@ -42,9 +42,11 @@ are organized as a linked chain, and can be reached only  via their fields
 next
 
 - double *val;
-vector of numerical values. val[ 0 ] is the most recent value computed by the
-equation, that is, computed at time last_update. val[1] is the value computed
-at time last_update - 1; val[2] at time last_update - 2 and so on.
+circular vector of numerical values, accessed with lagged( lag ). lagged( 0 ) is
+the most recent value computed by the equation, that is, computed at time
+last_update. lagged( 1 ) is the value computed at time last_update - 1;
+lagged( 2 ) at time last_update - 2 and so on. The position of the most recent
+value is head, so storing a new one (shift) just overwrites the oldest value.
 
 - int num_lag;
 number of lagged values stored for the variable
@@ -77,7 +79,7 @@ contain the global time when it was lastly computed the equation for the variabl
 
 - int param;
 Flag set to 1, in case the variable is considered a parameter. In case it is,
-when requested the value it is always returned its field val[ 0 ].
+when requested the value it is always returned its field lagged( 0 ).
 
 - char data_loaded;
 flag indicative whether the variable has been initialized with numerical values
@@ -95,7 +97,7 @@ perform the initialization.
 - double cal( object *caller, int lag );
 it is its main function. Return the numerical value
 
-	   val[last_update+lag-t]
+	   lagged( last_update + lag - t )
 
 if the condition
 
@@ -110,6 +112,12 @@ Only in case the lag requested is zero and the variable has not been computed
 at the present time step, the method shifts its lagged values and calls the
 method fun that perform the equation computation.
 
+- double cal_batch( object *caller, const batch_funcT &body );
+used by the equations declared with EQUATION_BATCH. The equation code (body)
+computes at once the values of all the instances of the variable in the
+sibling objects not yet updated in the time step, so the shared values are
+fetched only once. All the instances computed are marked as updated.
+
 - void empty( void ) ;
 It is used to free all the memory assigned to the variable. Used by
 object::delete_obj to cancel an object.
@@ -117,8 +125,14 @@ object::delete_obj to cancel an object.
 
 #include "decl.h"
 
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
 clock_t start_profile[ 100 ], end_profile[ 100 ];
 
+unordered_map < int, int > roll_wins;			// rolling window sizes by variable label ID
+
 #ifndef _NP_
 condition_variable upd_workers;
 mutex thr_ptr_lock;
@@ -154,6 +168,17 @@ variable::variable( void )
 	num_lag = 0;
 	param = 0;
 	start = 0;
+	rnd_t = -1;
+	rnd_cnt = 0;
+	rnd_key = 0;
+	id = -1;
+	dep_pos = -1;
+	stream_id = -1;
+	win = 0;
+	head = 0;
+	roll_k = 0;
+	roll_cnt = -1;
+	roll_sum[ 0 ] = roll_sum[ 1 ] = 0;
 	delay = 0;
 	delay_range = 0;
 	period = 1;
@@ -191,6 +216,18 @@ variable::variable( const variable &v )
 	num_lag = v.num_lag;
 	param = v.param;
 	start = v.start;
+	rnd_t = v.rnd_t;
+	rnd_cnt = v.rnd_cnt;
+	rnd_key = v.rnd_key;
+	id = v.id;
+	dep_pos = -1;						// copies are never wave results
+	stream_id = -1;						// copies are never streamed
+	win = v.win;
+	head = v.head;
+	roll_k = v.roll_k;
+	roll_cnt = v.roll_cnt;
+	roll_sum[ 0 ] = v.roll_sum[ 0 ];
+	roll_sum[ 1 ] = v.roll_sum[ 1 ];
 	delay = v.delay;
 	delay_range = v.delay_range;
 	period = v.period;
@@ -219,16 +256,26 @@ void variable::init( object *_up, const char *_label, int _num_lag, double *v, i
 	i = strlen( _label ) + 1;
 	label = new char[ i ];
 	strcpy( label, _label );
+	rnd_key = rnd_ctr_key( label );
+	id = lab_id( label );
+	dep_pos = -1;
+	rnd_t = -1;
+	rnd_cnt = 0;
 
 	num_lag = _num_lag;
+	head = 0;
 	if ( num_lag >= 0 )
 	{
-		val = new double[ num_lag + 1 ];
+		val = lag_alloc( num_lag + 1 );
+
 		for ( i = 0; i < num_lag + 1; ++i )
 			val[ i ] = v[ i ];
 	}
 	else
 		val = NULL;
+
+	roll_k = roll_wins.size( ) > 0 ? window_size( this ) : 0;
+	roll_cnt = -1;
 }
 
 
@@ -257,22 +304,166 @@ void variable::empty( bool no_lock )
 		return;
 	}
 
+	if ( dep_pos >= 0 )					// drop pending wave result
+		dep_forget( this );
+
+	lag_free( val, num_lag + 1 );
+
 	delete [ ] label;
-	delete [ ] val;
 	delete [ ] lab_tit;
 	free( data );		// use C stdlib to be able to deallocate memory for deleted objects
 }
 
 
+/****************************************************
+LAG_ALLOC / LAG_FREE
+Allocate (or release) a lagged values vector
+of n values, taking the usual small vectors from the
+pool of their size (see lag_slab)
+****************************************************/
+double *lag_alloc( int n )
+{
+	if ( n > LAG_SLABS )
+		return new double[ n ];
+
+	return ( double * ) lag_slab( n ).alloc( );
+}
+
+void lag_free( double *p, int n )
+{
+	if ( p == NULL )
+		return;
+
+	if ( n > LAG_SLABS )
+		delete [ ] p;
+	else
+		lag_slab( n ).release( p );
+}
+
+
+/***************************************************
+SET_WINDOW (*)
+Set (or unset, if num is zero) a rolling window of the
+last num values for the variables with label lab. The
+window sums are updated in O(1) when a new value is
+stored, and used by object::lag_sum instead of
+requesting each lag. The window cannot be larger than
+the number of lags plus one of the variable.
+WARNING: the updated sums may differ in the last bits
+from the lag-by-lag sums, and the model may amplify
+such differences over time, so results are not the
+same as without the window. Use only for long windows
+of variables the model is not sensitive to
+****************************************************/
+void set_window( const char *lab, int num )
+{
+	object *cur;
+	variable *cv;
+
+	if ( num <= 0 )
+		roll_wins.erase( lab_id( lab ) );
+	else
+		roll_wins[ lab_id( lab ) ] = num;
+
+	if ( root == NULL || ( cv = root->search_var( root, lab, true, false, true ) ) == NULL )
+		return;
+
+	for ( cur = cv->up; cur != NULL; cur = cur->hyper_next( cur->label ) )
+		if ( ( cv = cur->search_var( cur, lab, true, false, false ) ) != NULL )
+		{
+			cv->roll_k = num > 0 ? window_size( cv ) : 0;
+			cv->roll_cnt = -1;
+		}
+}
+
+
+/***************************************************
+WINDOW_SIZE
+Get the rolling window size for variable v, if set
+and possible with its lags, or zero otherwise
+***************************************************/
+int window_size( variable *v )
+{
+	auto it = roll_wins.find( lab_id( v->label ) );
+
+	if ( it == roll_wins.end( ) || v->param != 0 || it->second > v->num_lag + 1 )
+		return 0;
+
+	return it->second;
+}
+
+
+/***************************************************
+ROLL_ADD
+Update the rolling window sums for the new value
+about to be stored, dropping the oldest one. The
+sums are recomputed exactly when stale or when the
+window is completely renewed, to avoid drifting, so
+only the writer of the variable changes them
+***************************************************/
+void variable::roll_add( double value )
+{
+	int i;
+
+	if ( roll_cnt >= 0 && ++roll_cnt < roll_k )
+	{
+		roll_sum[ 1 ] = roll_sum[ 0 ];
+		roll_sum[ 0 ] += value - lagged( roll_k - 1 );
+		return;
+	}
+
+	// new lags 1 to roll_k are the current lags 0 to roll_k - 1
+	roll_sum[ 0 ] = value;
+	roll_sum[ 1 ] = 0;
+
+	for ( i = 0; i < roll_k - 1; ++i )
+		roll_sum[ 0 ] += lagged( i );
+
+	if ( roll_k <= num_lag )
+		for ( i = 0; i < roll_k; ++i )
+			roll_sum[ 1 ] += lagged( i );
+
+	roll_cnt = 0;
+}
+
+
+/***************************************************
+ROLL
+Get the sum of the rolling window values starting at
+stored lag first (0 or 1), summing the lags if the
+window sums are stale (without updating them)
+***************************************************/
+double variable::roll( int first )
+{
+	int i;
+	double sum;
+
+	if ( roll_cnt >= 0 )
+		return roll_sum[ first ];
+
+	for ( sum = 0, i = first; i < first + roll_k; ++i )
+		sum += lagged( i );
+
+	return sum;
+}
+
+
 /***************************************************
 CAL
 Standard version (non parallel computation)
 ****************************************************/
 double variable::cal( object *caller, int lag )
 {
-	int i, eff_lag, time;
+	int eff_lag;
+#ifndef _NW_
+	int time;
 	clock_t pstart = 0, pend = 0;
+#endif
 	double app;
+	variable *dep_prev = NULL;
+
+	if ( dep_state != 0 )				// record dependency, if required
+		dep_call( this, lag );
 
 	if ( param == 1 )
 	{
@@ -283,11 +474,11 @@ double variable::cal( object *caller, int lag )
 			strncpy( watch_elem, label, MAX_ELEM_LENGTH );
 		}
 
-		return val[ 0 ];				// it's a parameter, ignore lags
+		return lagged( 0 );				// it's a parameter, ignore lags
 	}
 
 #ifndef _NP_
-	// prepare mutex for variables and functions updated in multiple threads
+	// prepare lock for variables and functions updated in multiple threads
 	rec_uniqlT guard( parallel_comp, defer_lock );
 #endif
 
@@ -314,13 +505,13 @@ double variable::cal( object *caller, int lag )
 				if ( no_saved || ! ( save || savei ) )	// and not saved
 					goto error;
 				else
-					if ( lag > t - start )	// or before there are saved values
-						goto error;
+					if ( lag > t - start || ! stream_read( this, t - lag, app ) )
+						goto error;		// or before there are saved values
 
-				return data[ t - lag - start ];	// use saved past value
+				return app;				// use saved past value
 			}
 			else
-				return val[ eff_lag ];	// use regular past value
+				return lagged( eff_lag );	// use regular past value
 		}
 		else
 		{
@@ -334,7 +525,7 @@ double variable::cal( object *caller, int lag )
 					strncpy( watch_elem, label, MAX_ELEM_LENGTH );
 				}
 
-				return( val[ 0 ] );
+				return( lagged( 0 ) );
 			}
 #ifndef _NP_
 			// wait for computation of this variable by other threads
@@ -342,7 +533,7 @@ double variable::cal( object *caller, int lag )
 				guard.lock( );
 
 			if ( last_update >= t )		// recheck if not computed during lock
-				return( val[ 0 ] );
+				return( lagged( 0 ) );
 #endif
 		}
 	}
@@ -352,10 +543,10 @@ double variable::cal( object *caller, int lag )
 			goto error;
 
 		if ( lag > 0 )					// lagged value
-			return val[ lag - 1 ];
+			return lagged( lag - 1 );
 
 		if ( caller == NULL )			// update or inadequate caller
-			return val[ 0 ];
+			return lagged( 0 );
 
 #ifndef _NP_
 		// wait for computation of this function by other threads
@@ -418,6 +609,12 @@ double variable::cal( object *caller, int lag )
 			pstart = clock( );
 #endif
 
+	if ( dep_state != 0 )
+		dep_prev = dep_enter( this );
+
+	if ( prof_on )
+		prof_enter( this );
+
 	// Compute the Variable's equation
 	user_exception = true;			// allow distinguishing among internal & user exceptions
 	try								// do it while catching exceptions to avoid obscure aborts
@@ -434,6 +631,17 @@ double variable::cal( object *caller, int lag )
 	{
 		throw p;
 	}
+	catch ( dep_reject & )		// side effect in dependency wave: leave to lazy pull
+	{
+		user_exception = under_computation = false;
+		rnd_t = -1;					// restart counter-based draws
+
+		if ( prof_on )
+			prof_leave( );
+
+		dep_leave( dep_prev );
+		throw;
+	}
 	catch ( ... )
 	{
 		if ( quit != 2 )			// error message not already presented?
@@ -450,10 +658,16 @@ double variable::cal( object *caller, int lag )
 	}
 	user_exception = false;
 
-	for ( i = 0; i < num_lag; ++i ) // scale down the past values
-		val[ num_lag - i ] = val[ num_lag - i - 1 ];
+	if ( prof_on )
+		prof_leave( );
+
+	if ( dep_state != 0 )
+		dep_leave( dep_prev );
 
-	val[ 0 ] = app;
+	if ( dep_waving )					// keep undo data, if required
+		dep_store( this );
+
+	shift( app );						// scale down the past values
 
 	last_update = t;
 
@@ -495,7 +709,7 @@ double variable::cal( object *caller, int lag )
 			{
 				set_lab_tit( this );
 				plog_tag( "\n%-12.12s(%-.10s)\t=", "prof1", label, lab_tit );
-				plog_tag( "%.4g\t", "highlight", val[ 0 ] );
+				plog_tag( "%.4g\t", "highlight", lagged( 0 ) );
 				plog( "t=" );
 				plog_tag( "%d\t", "highlight", t );
 				plog( "msecs=" );
@@ -508,27 +722,27 @@ double variable::cal( object *caller, int lag )
 
 		// update debug log file
 		if ( log_file != NULL && t >= log_start && t <= log_stop )
-			fprintf( log_file, "%s\t= %g\t(t=%d)\n", label, val[ 0 ], t );
+			fprintf( log_file, "%s\t= %g\t(t=%d)\n", label, lagged( 0 ), t );
 
 		// open the debugger if required
 		if ( debug_flag && t == when_debug && ( watch_trigger || ( deb_cond == 0 && ( deb_mode == 'd' || deb_mode == 'W' || deb_mode == 'R' ) ) ) )
-			deb( ( object * ) up, caller, label, &val[ 0 ], false );
+			deb( ( object * ) up, caller, label, &lagged( 0 ), false );
 		else
 			switch ( deb_cond )
 			{
 				case 0:
 					break;
 				case 1:
-					if ( val[ 0 ] == deb_cnd_val )
-						deb( ( object * ) up, caller, label, &val[ 0 ], false );
+					if ( lagged( 0 ) == deb_cnd_val )
+						deb( ( object * ) up, caller, label, &lagged( 0 ), false );
 					break;
 				case 2:
-					if ( val[ 0 ] > deb_cnd_val )
-						deb( ( object * ) up, caller, label, &val[ 0 ], false );
+					if ( lagged( 0 ) > deb_cnd_val )
+						deb( ( object * ) up, caller, label, &lagged( 0 ), false );
 					break;
 				case 3:
-					if ( val[ 0 ] < deb_cnd_val )
-						deb( ( object * ) up, caller, label, &val[ 0 ], false );
+					if ( lagged( 0 ) < deb_cnd_val )
+						deb( ( object * ) up, caller, label, &lagged( 0 ), false );
 					break;
 				default:
 					error_hard( "internal problem in LSD",
@@ -589,20 +803,203 @@ double variable::cal( object *caller, int lag )
 }
 
 
+/***************************************************
+CAL_BATCH
+Compute the variable for all the sibling object
+instances at once, calling the batch equation code
+(body) a single time. Only the instances not yet
+updated in the time step (and, in parallel mode,
+not being computed by other threads) are included.
+The value for the calling instance is returned, to
+be stored by cal( ), the others are stored here
+****************************************************/
+double variable::cal_batch( object *caller, const batch_funcT &body )
+{
+	int i, me = -1;
+	bridge *cb;
+	object *cur;
+	variable *cv;
+	o_vecT objs;
+	vector < double > res;
+	vector < variable * > vars;
+
+	// release the other instances collected
+	auto release = [ & ]( void )
+	{
+		for ( i = 0; i < ( int ) vars.size( ); ++i )
+			if ( i != me )
+			{
+				vars[ i ]->under_computation = false;
+#ifndef _NP_
+				if ( parallel_mode )
+					vars[ i ]->parallel_comp.unlock( );
+#endif
+			}
+	};
+
+	// functions are not batched: compute just this instance
+	if ( param == 0 && up->up != NULL && ( cb = up->up->search_bridge( up->label, true ) ) != NULL )
+	{
+		for ( cur = cb->head; cur != NULL; cur = cur->next )
+		{
+			if ( cur == up )
+			{
+				me = objs.size( );
+				objs.push_back( cur );
+				vars.push_back( this );
+				continue;
+			}
+
+			cv = cur->search_var( cur, id, true, true );
+			if ( cv != NULL && cv->dep_pos >= 0 && ! dep_waving )
+				dep_use( cv );			// computed in the serial order from now
+
+			if ( cv == NULL || cv->param != 0 || cv->last_update >= t || t < cv->next_update || cv->under_computation )
+				continue;
+#ifndef _NP_
+			// skip instances being computed by other threads
+			if ( parallel_mode && ! cv->parallel_comp.try_lock( ) )
+				continue;
+#endif
+			cv->under_computation = true;	// detect requests of own value
+			objs.push_back( cur );
+			vars.push_back( cv );
+		}
+	}
+
+	// not in the parent's list (e.g. not attached yet): only this instance
+	if ( me < 0 )
+	{
+		release( );
+		objs.assign( 1, up );
+		vars.assign( 1, this );
+		me = 0;
+	}
+
+	res.assign( objs.size( ), def_res );
+
+	try									// do not keep others locked on errors
+	{
+		body( caller, this, objs, res );
+
+		for ( i = 0; i < ( int ) vars.size( ); ++i )
+		{
+			if ( i == me )
+				continue;
+
+			cv = vars[ i ];
+
+			if ( quit == 0 && ( ( ! use_nan && is_nan( res[ i ] ) ) || is_inf( res[ i ] ) ) )
+				error_hard( "invalid equation result", "check your equation code to prevent invalid math operations\nPossible problems:\n- Illegal math operation (division by zero, log of negative number etc.)\n- Use of too-large/small value in calculation\n- Use of non-initialized temporary variable in calculation", true, "equation for '%s' produces the invalid value '%lf' at case %d", label, res[ i ], t );
+
+			if ( dep_waving )			// keep undo data, if required
+				dep_store( cv );
+
+			cv->shift( res[ i ] );
+			cv->last_update = t;
+
+			// choose next update step for special updating variables
+			if ( cv->period > 1 || cv->period_range > 0 )
+			{
+				cv->next_update = t + cv->period;
+				if ( cv->period_range > 0 )
+					cv->next_update += rnd_int( 0, cv->period_range );
+			}
+		}
+	}
+	catch ( ... )
+	{
+		release( );
+		throw;
+	}
+
+	release( );
+
+	return res[ me ];
+}
+
+
+/***************************************************
+BATCH_VALS
+Fill vals with the values of the variable lab (with
+lag) in each of the objects in objs, in order
+****************************************************/
+void batch_vals( const o_vecT &objs, const char *lab, int lag, vector < double > &vals )
+{
+	vals.resize( objs.size( ) );
+
+	for ( size_t i = 0; i < objs.size( ); ++i )
+		vals[ i ] = objs[ i ]->cal( objs[ i ], lab, lag );
+}
+
+
 #ifndef _NP_
+/***************************************************
+COMP_LOCK
+Compute-once lock word of variables and objects.
+Taking a free lock or one already owned by the
+thread is a single atomic operation. Only when
+another thread owns it, the requester blocks in a
+small table of waiting slots shared by all locks,
+flagging the lock word so the owner wakes it up
+****************************************************/
+struct comp_slot						// waiting slot for contended locks
+{
+	mutex lock;
+	condition_variable free;
+};
+
+atomic < unsigned > comp_tags( 0 );		// last thread tag used
+comp_slot comp_slots[ COMP_SLOTS ];		// waiting slots (by lock address)
+
+unsigned comp_lock::new_tag( void )
+{
+	return ++comp_tags & ~ waiting;
+}
+
+void comp_lock::wait( void )
+{
+	unsigned s, me = self( );
+	comp_slot &slot = comp_slots[ ( ( uintptr_t ) this / sizeof( comp_lock ) ) % COMP_SLOTS ];
+
+	unique_lock < mutex > lock_slot( slot.lock );
+
+	while ( true )
+	{
+		// keep the flag when taking the lock, as others may be waiting
+		s = 0;
+		if ( state.compare_exchange_strong( s, me | waiting, memory_order_acquire ) )
+			break;
+
+		if ( s == 0 )					// just released
+			continue;
+
+		// flag the waiting before blocking, so the owner wakes it up
+		if ( ( s & waiting ) || state.compare_exchange_strong( s, s | waiting, memory_order_relaxed ) )
+			slot.free.wait( lock_slot );
+	}
+
+	depth = 1;
+}
+
+void comp_lock::wake( void )
+{
+	comp_slot &slot = comp_slots[ ( ( uintptr_t ) this / sizeof( comp_lock ) ) % COMP_SLOTS ];
+
+	lock_guard < mutex > lock_slot( slot.lock );
+	slot.free.notify_all( );
+}
+
+
 /***************************************************
 CAL_WORKER
 Multi-thread worker for parallel computation
 ****************************************************/
 void worker::cal_worker( void )
 {
-	int i;
-	double app;
-
 	// create try-catch block to capture exceptions in thread and reroute to main thread
 	try
 	{
-		running = true;
 		errored = false;
 
 		// update object map and register all signal handlers
@@ -613,6 +1010,7 @@ void worker::cal_worker( void )
 		handle_signals( signal_wrapper );
 
 		free = true;
+		signal_idle( );
 
 		while ( running )
 		{
@@ -620,101 +1018,24 @@ void worker::cal_worker( void )
 			unique_lock < mutex > lock_worker( lock );
 			run.wait( lock_worker, [ this ]{ return ! free; }  );
 
-			// exit if shutdown or continue if already updated
-			if ( running && var != NULL && var->last_update < t )
-			{	// prevent parallel computation of the same variable
-				rec_uniqlT guard_var( var->parallel_comp );
-
-				// recheck if not computed during lock
-				if ( var->last_update >= t )
-					goto end;
-
-				if ( var->under_computation )
-				{
-					snprintf( err_msg1, MAX_BUFF_SIZE, "deadlock during parallel computation" );
-					snprintf( err_msg2, MAX_BUFF_SIZE, "the equation for '%s' in object '%s' requested its own value\nwhile parallel-computing its current value", var->label, var->up->label );
-					snprintf( err_msg3, MAX_BUFF_SIZE, "check your code to prevent this situation" );
-					user_excpt = true;
-
-					if ( worker_errors( ) == 0 )
-					{
-						errored = true;
-						throw;
-					}
-					else
-					{
-						errored = true;
-						goto stop;
-					}
-				}
-
-				var->under_computation = true;
-
-				// compute the Variable's equation
-				user_excpt = true;			// allow distinguishing among internal & user exceptions
-
 #ifndef _NW_
-				if ( setjmp( env ) )		// allow recovering from signals
-					return;
+			if ( setjmp( env ) )		// allow recovering from signals
+				return;
 #endif
-				try							// do it while catching exceptions to avoid obscure aborts
-				{
-					app = var->fun( NULL );
-				}
-				catch ( ... )
-				{
-					if ( error_hard_thread )
-						pexcpt = nullptr;
-					else
-					{
-						pexcpt = current_exception( );
-						snprintf( err_msg1, MAX_BUFF_SIZE, "equation error" );
-						snprintf( err_msg2, MAX_BUFF_SIZE, "an exception was detected while parallel-computing the equation\nfor '%s' in object '%s'", var->label, var->up->label );
-						snprintf( err_msg3, MAX_BUFF_SIZE, "check your code to prevent this situation" );
-					}
-
-					if ( worker_errors( ) == 0 )
-					{
-						errored = true;
-						throw;
-					}
-					else
-					{
-						errored = true;
-						goto stop;
-					}
-				}
-
-				user_excpt = errored = false;
-
-				// scale down the past values
-				for ( i = 0; i < var->num_lag; ++i )
-					var->val[ var->num_lag - i ] = var->val[ var->num_lag - i - 1 ];
-				var->val[ 0 ] = app;
-
-				var->last_update = t;
-
-				// choose next update step for special updating variables
-				if ( var->period > 1 || var->period_range > 0 )
-				{
-					var->next_update = t + var->period;
-					if ( var->period_range > 0 )
-						var->next_update += rnd_int( 0, var->period_range );
-				}
-
-				var->under_computation = false;
-
-				// if there is a pending object deletion, try to do it now
-				if ( wait_delete != NULL )
-				{
-					guard_var.unlock( );					// release lock
-					wait_delete->delete_obj( var );
-				}
+			// exit if shutdown or compute job/variable
+			if ( running && job != NULL )
+			{
+				if ( ! cal_job( ) )
+					goto stop;
 			}
+			else
+				if ( running && var != NULL && ! cal_var( ) )
+					goto stop;
 
-		end:
+			job = NULL;
 			var = NULL;
 			free = true;
+			signal_idle( );
 			// create context to send signal to update scheduler if needed
 			if ( ! worker_ready )
 			{
@@ -743,87 +1064,265 @@ void worker::cal_worker( void )
 	stop:
 
 	running = free = false;
+	signal_idle( );
 }
 
 
 /***************************************************
-WORKER constructor
+CAL_JOB
+Compute chunks of instances of a parallel update job
+until none is left, then signal the job barrier.
+Chunks are taken from the shared job cursor, so
+faster threads take more chunks (self-scheduling)
 ****************************************************/
-worker::worker( void )
+bool worker::cal_job( void )
 {
-	running = false;
-	free = false;
-	pexcpt = nullptr;
-	signum = -1;
-	var = NULL;
-	strcpy( err_msg1, "" );
-	strcpy( err_msg2, "" );
-	strcpy( err_msg3, "" );
+	size_t i, first, last;
 
-	// launch new thread (waiting mode)
-	thr = thread( & worker::cal_worker, this );
-}
+	// engine tasks instead of variables (see run_tasks)
+	if ( ! job->funcs.empty( ) )
+	{
+		while ( ( i = job->next++ ) < job->num_tasks( ) )
+			job->funcs[ i ]( );
+
+		goto done;
+	}
 
+	mut_log = & muts;					// log structural changes in job
+	dep_log = dep_waving ? & undos : NULL;	// log computed variables in wave
+	dep_links = dep_waving ? & links : NULL;	// log requested variables in wave
 
-/***************************************************
-WORKER destructor
-****************************************************/
-worker::~worker( void )
-{
-	// command thread shutdown if running
-	if ( running && ! errored )
+	while ( job->take( first, last ) )
 	{
-		unique_lock< mutex > lock_worker( lock );
-		running = free = false;
-		run.notify_one( );
+		for ( i = first; i < last; ++i )
+		{
+			var = job->vars[ i ];
+			mut_pos = i;
+			mut_cnt = 0;
+			mut_owner = var->up;
+			if ( ! cal_var( ) )
+			{
+				mut_log = NULL;
+				dep_log = NULL;
+				dep_links = NULL;
+				return false;
+			}
+		}
 	}
 
-	// wait for shutdown and check exception
-	if ( thr.joinable( ) && ! errored )
-		thr.join( );
+	mut_log = NULL;
+	dep_log = NULL;
+	dep_links = NULL;
+	var = NULL;
 
-	// remove thread id from threads map
-	thr_ptr.erase( thr_id );
+	done:
+
+	// last thread out of the job opens the barrier
+	if ( --job->pending == 0 )
+	{
+		lock_guard < mutex > lock_job( job->lock );
+		job->done.notify_all( );
+	}
+
+	return true;
 }
 
 
 /***************************************************
-SIGNAL
-Handle system signals in worker
+CAL_VAR
+Compute the current variable instance in the worker
+Return false if the worker must stop
 ****************************************************/
-void worker::signal( int sig )
+bool worker::cal_var( void )
 {
-	char signame[ 16 ];
+	double app;
+	variable *dep_prev = NULL;
 
-	switch ( sig )
-	{
-		case SIGMEM:
-			strcpy( signame, "SIGMEM" );
-			break;
+	if ( var->last_update >= t )
+		return true;
 
-		case SIGABRT:
-			strcpy( signame, "SIGABRT" );
-			break;
+	// prevent parallel computation of the same variable
+	rec_uniqlT guard_var( var->parallel_comp );
 
-		case SIGFPE:
-			strcpy( signame, "SIGFPE" );
-			break;
+	// recheck if not computed during lock
+	if ( var->last_update >= t )
+		return true;
 
-		case SIGILL:
-			strcpy( signame, "SIGILL" );
-			break;
+	if ( var->under_computation )
+	{
+		snprintf( err_msg1, MAX_BUFF_SIZE, "deadlock during parallel computation" );
+		snprintf( err_msg2, MAX_BUFF_SIZE, "the equation for '%s' in object '%s' requested its own value\nwhile parallel-computing its current value", var->label, var->up->label );
+		snprintf( err_msg3, MAX_BUFF_SIZE, "check your code to prevent this situation" );
+		user_excpt = true;
 
-		case SIGSEGV:
-			strcpy( signame, "SIGSEGV" );
-			break;
+		errored = true;
+		if ( worker_errors( ) == 1 )
+			throw;
 
-		default:
-			strcpy( signame, "Unknown signal" );
+		return false;
 	}
 
-	if ( var != NULL && var->label != NULL	)
-		snprintf( err_msg1, MAX_BUFF_SIZE, "\n\n%s: signal received while parallel-computing the equation\nfor '%s' in object '%s'. Disable parallel computation for this variable\nor check your code to prevent this situation.", signame, var->label, var->up->label != NULL ? var->up->label : "(none)" );
-	else
+	var->under_computation = true;
+
+	if ( dep_state != 0 )
+		dep_prev = dep_enter( var );
+
+	if ( prof_on )
+		prof_enter( var );
+
+	// compute the Variable's equation
+	user_excpt = true;			// allow distinguishing among internal & user exceptions
+
+	try							// do it while catching exceptions to avoid obscure aborts
+	{
+		app = var->fun( NULL );
+	}
+	catch ( dep_reject & )		// side effect in dependency wave: leave to lazy pull
+	{
+		user_excpt = var->under_computation = false;
+		var->rnd_t = -1;			// restart counter-based draws
+
+		if ( prof_on )
+			prof_leave( );
+
+		dep_leave( dep_prev );
+		return true;
+	}
+	catch ( ... )
+	{
+		if ( error_hard_thread )
+			pexcpt = nullptr;
+		else
+		{
+			pexcpt = current_exception( );
+			snprintf( err_msg1, MAX_BUFF_SIZE, "equation error" );
+			snprintf( err_msg2, MAX_BUFF_SIZE, "an exception was detected while parallel-computing the equation\nfor '%s' in object '%s'", var->label, var->up->label );
+			snprintf( err_msg3, MAX_BUFF_SIZE, "check your code to prevent this situation" );
+		}
+
+		errored = true;
+		if ( worker_errors( ) == 1 )
+			throw;
+
+		return false;
+	}
+
+	user_excpt = errored = false;
+
+	if ( prof_on )
+		prof_leave( );
+
+	if ( dep_state != 0 )
+		dep_leave( dep_prev );
+
+	if ( dep_waving )					// keep undo data, if required
+		dep_store( var );
+
+	// scale down the past values
+	var->shift( app );
+
+	var->last_update = t;
+
+	// choose next update step for special updating variables
+	if ( var->period > 1 || var->period_range > 0 )
+	{
+		var->next_update = t + var->period;
+		if ( var->period_range > 0 )
+			var->next_update += rnd_int( 0, var->period_range );
+	}
+
+	var->under_computation = false;
+
+	// if there is a pending object deletion, try to do it now
+	if ( wait_delete != NULL )
+	{
+		guard_var.unlock( );					// release lock
+		wait_delete->delete_obj( var );
+	}
+
+	return true;
+}
+
+
+/***************************************************
+WORKER constructor
+****************************************************/
+worker::worker( void )
+{
+	running = true;				// until stopped, so a starting thread is not taken as crashed
+	errored = free = false;
+	pexcpt = nullptr;
+	signum = -1;
+	job = NULL;
+	var = NULL;
+	strcpy( err_msg1, "" );
+	strcpy( err_msg2, "" );
+	strcpy( err_msg3, "" );
+
+	// launch new thread (waiting mode)
+	thr = thread( & worker::cal_worker, this );
+}
+
+
+/***************************************************
+WORKER destructor
+****************************************************/
+worker::~worker( void )
+{
+	// command thread shutdown if running
+	if ( running && ! errored )
+	{
+		unique_lock< mutex > lock_worker( lock );
+		running = free = false;
+		run.notify_one( );
+	}
+
+	// wait for shutdown and check exception
+	if ( thr.joinable( ) && ! errored )
+		thr.join( );
+
+	// remove thread id from threads map
+	thr_ptr.erase( thr_id );
+}
+
+
+/***************************************************
+SIGNAL
+Handle system signals in worker
+****************************************************/
+void worker::signal( int sig )
+{
+	char signame[ 16 ];
+
+	switch ( sig )
+	{
+		case SIGMEM:
+			strcpy( signame, "SIGMEM" );
+			break;
+
+		case SIGABRT:
+			strcpy( signame, "SIGABRT" );
+			break;
+
+		case SIGFPE:
+			strcpy( signame, "SIGFPE" );
+			break;
+
+		case SIGILL:
+			strcpy( signame, "SIGILL" );
+			break;
+
+		case SIGSEGV:
+			strcpy( signame, "SIGSEGV" );
+			break;
+
+		default:
+			strcpy( signame, "Unknown signal" );
+	}
+
+	if ( var != NULL && var->label != NULL	)
+		snprintf( err_msg1, MAX_BUFF_SIZE, "\n\n%s: signal received while parallel-computing the equation\nfor '%s' in object '%s'. Disable parallel computation for this variable\nor check your code to prevent this situation.", signame, var->label, var->up->label != NULL ? var->up->label : "(none)" );
+	else
 		snprintf( err_msg1, MAX_BUFF_SIZE, "\n\n%s: signal received by a parallel worker thread.\nDisable parallel computation to prevent this situation.", signame );
 
 	// signal & kill thread
@@ -858,11 +1357,44 @@ Multi-thread CAL version (parallel computation)
 void worker::cal( variable *v )
 {
 	unique_lock< mutex > worker_lock( lock );
+	job = NULL;
 	var = v;
 	free = false;
 	run.notify_one( );
 }
 
+void worker::cal( upd_job *j )
+{
+	unique_lock< mutex > worker_lock( lock );
+	job = j;
+	var = NULL;
+	free = false;
+	run.notify_one( );
+}
+
+
+/****************************************************
+SIGNAL_IDLE / WAIT_FREE
+Signal the worker became free or stopped, and wait
+for it, checking again on timeout (signal handlers
+stop the worker without signaling)
+****************************************************/
+void worker::signal_idle( void )
+{
+	{
+		lock_guard < mutex > lock_idle( idle_lock );
+	}
+
+	idle.notify_all( );
+}
+
+void worker::wait_free( void )
+{
+	unique_lock < mutex > lock_idle( idle_lock );
+
+	while ( ! idle.wait_for( lock_idle, chrono::milliseconds( MAX_TIMEOUT ), [ this ]{ return free || ! running || errored; } ) );
+}
+
 
 /****************************************************
 CHECK
@@ -917,18 +1449,205 @@ bool worker::check( void )
 }
 
 
+static bool dep_dropped( variable *v );
+
+
+/***************************************************
+JOB_APPLY
+Apply the structural changes deferred by the tasks of
+a job, discarding the ones by the variables removed
+from the dependency waves while being computed
+****************************************************/
+static void job_apply( upd_job &job, vector < mut_op > &muts )
+{
+	size_t j;
+	vector < bool > drop;
+
+	if ( muts.size( ) == 0 )
+		return;
+
+	if ( dep_waving )
+	{
+		drop.resize( job.vars.size( ) );
+		for ( j = 0; j < job.vars.size( ); ++j )
+			drop[ j ] = dep_dropped( job.vars[ j ] );
+	}
+
+	mut_apply( muts, drop.empty( ) ? NULL : & drop );
+}
+
+
+/***************************************************
+JOB_STOP
+Stop a parallel update job before its completion,
+preventing new tasks from being taken and waiting
+the healthy workers to leave the job, so it can be
+safely dropped by the calling thread
+****************************************************/
+static void job_stop( upd_job &job, int nt )
+{
+	int i;
+
+	job.next = job.num_tasks( );
+
+	for ( i = 0; i < nt; ++i )
+		workers[ i ].wait_free( );
+}
+
+
+/***************************************************
+JOB_CAL
+Compute a task variable of a parallel update job in
+the calling thread, leaving the ones rejected for a
+side effect in a dependency wave to the lazy pull
+****************************************************/
+static void job_cal( variable *v, object *caller )
+{
+	try
+	{
+		v->cal( caller, 0 );
+	}
+	catch ( dep_reject & )
+	{
+	}
+}
+
+
+/***************************************************
+RUN_JOB
+Run the tasks of a parallel update job in the free
+workers and the calling thread, until all are
+computed. The calling thread then waits in the job
+completion barrier, checking for crashed workers on
+each timeout, and applies the structural changes
+deferred by the tasks (see job_apply). Return false
+if a worker crashed, after all workers left the job.
+****************************************************/
+static bool run_job( upd_job &job, object *caller )
+{
+	int i, nt;
+	size_t j, first, last;
+	vector < mut_op > muts;
+
+	job.next = 0;
+	mut_start( job.vars.size( ) );		// number objects created in job
+	mut_log = & muts;					// log structural changes in job
+	dep_log = dep_waving ? & job.undos : NULL;	// log computed variables in wave
+	dep_links = dep_waving ? & job.links : NULL;	// log requested variables in wave
+
+	// too few tasks for parallel computation
+	if ( job.num_tasks( ) < 2 )
+	{
+		for ( j = 0; j < job.vars.size( ); ++j )
+		{
+			mut_pos = j;
+			mut_cnt = 0;
+			mut_owner = job.vars[ j ]->up;
+			job_cal( job.vars[ j ], caller );
+		}
+
+		mut_log = NULL;
+		dep_log = NULL;
+		dep_links = NULL;
+		mut_end( );
+
+		job_apply( job, muts );
+		return true;
+	}
+
+	// dispatch the job to all workers, keeping one task for the calling thread
+	nt = min( max_threads, ( int ) job.num_tasks( ) - 1 );
+	job.pending = nt + 1;
+	for ( i = 0; i < nt; ++i )
+		workers[ i ].cal( & job );
+
+	// do tasks in the calling thread too, not leaving workers in the job on errors
+	try
+	{
+		while ( job.take( first, last ) )
+			for ( j = first; j < last; ++j )
+			{
+				mut_pos = j;
+				mut_cnt = 0;
+				mut_owner = job.vars[ j ]->up;
+				job_cal( job.vars[ j ], caller );
+			}
+	}
+	catch ( ... )
+	{
+		mut_log = NULL;
+		dep_log = NULL;
+		dep_links = NULL;
+		job_stop( job, nt );
+		throw;
+	}
+
+	mut_log = NULL;
+	dep_log = NULL;
+	dep_links = NULL;
+
+	// completion barrier, checking workers health on timeout
+	if ( --job.pending > 0 )
+	{
+		unique_lock < mutex > lock_job( job.lock );
+		while ( ! job.done.wait_for( lock_job, chrono::milliseconds( MAX_TIMEOUT ), [ & job ]{ return job.pending == 0; } ) )
+			for ( i = 0; i < nt; ++i )
+				if ( ! workers[ i ].running || workers[ i ].errored )
+				{
+					lock_job.unlock( );		// let other workers leave the job
+					job_stop( job, nt );
+					return workers[ i ].check( );
+				}
+	}
+
+	// wait workers to become free for the next job
+	for ( i = 0; i < nt; ++i )
+	{
+		workers[ i ].wait_free( );
+
+		if ( ! workers[ i ].free )
+		{
+			job_stop( job, nt );
+			return workers[ i ].check( );
+		}
+	}
+
+	mut_end( );
+
+	// apply the structural changes of all threads in tasks order
+	for ( i = 0; i < nt; ++i )
+	{
+		muts.insert( muts.end( ), workers[ i ].muts.begin( ), workers[ i ].muts.end( ) );
+		workers[ i ].muts.clear( );
+		job.undos.insert( job.undos.end( ), workers[ i ].undos.begin( ), workers[ i ].undos.end( ) );
+		workers[ i ].undos.clear( );
+		job.links.insert( job.links.end( ), workers[ i ].links.begin( ), workers[ i ].links.end( ) );
+		workers[ i ].links.clear( );
+	}
+
+	job_apply( job, muts );
+	return true;
+}
+
+
 /***************************************************
 PARALLEL_UPDATE
-Multi-thread scheduler for parallel updating
+Multi-thread scheduler for parallel updating.
+The instances of the variable under the same parent
+are split in chunks, which are taken by the free
+workers and the calling thread from a shared cursor
+until all are computed (see run_job).
 ****************************************************/
 void parallel_update( variable *v, object* p, object *caller )
 {
-	bool ready[ max_threads ], wait = false;
-	int i, nt, wait_time;
-	clock_t pstart = 0;
+	int i, id, nt;
 	bridge *cb;
 	object *co;
-	variable *cv = NULL;
+	variable *cv;
+	upd_job job;
+
+	if ( dep_state != 0 )				// record dependency, if required
+		dep_call( v, 0 );
 
 	// prevent concurrent parallel update and multi-threading in a single core
 	if ( parallel_ready && max_threads > 1 )
@@ -940,20 +1659,22 @@ void parallel_update( variable *v, object* p, object *caller )
 	}
 
 	// find the beginning of the linked list chain for current object
-	cb = p->up->search_bridge( p->label );
+	cb = p->up != NULL ? p->up->search_bridge( p->label ) : NULL;
 
 	// if single instanced object, update as usual
-	if ( cb->head == NULL || cb->head->next == NULL )
+	if ( cb == NULL || cb->head == NULL || cb->head->next == NULL )
 	{
 		v->cal( caller, 0 );
+		parallel_ready = true;
 		return;
 	}
 
-	// set ready worker threads
+	// check all workers are ready, waiting the ones still starting
 	for ( nt = 0, i = 0; i < max_threads; ++i )
 	{
-		ready[ i ] = workers[ i ].free;
-		if ( ! ready[ i ] )
+		workers[ i ].wait_free( );
+
+		if ( ! workers[ i ].free )
 			++nt;
 	}
 
@@ -962,132 +1683,1285 @@ void parallel_update( variable *v, object* p, object *caller )
 		error_hard( "parallel computation problem",
 					"disable parallel computation for this variable or check your equation code to prevent this situation.\n\nPlease choose 'Quit LSD Browser' in the next dialog box",
 					true,
-					"variable '%s' (object '%s') %d parallel worker(s) crashed", v->label, v->up->label, i );
+					"variable '%s' (object '%s') %d parallel worker(s) crashed", v->label, v->up->label, nt );
 		return;
 	}
 
-	// scan all instances of current object under current parent
+	// collect all instances of current object under current parent to compute
+	id = lab_id( v->label );
 	for ( co = cb->head; co != NULL; co = co->next )
 	{
-		cv = co->search_var( co, v->label );
+		cv = co->search_var( co, id );
+
+		if ( cv != NULL && cv->dep_pos >= 0 )
+			dep_use( cv );				// computed in the serial order from now
 
 		// compute only if not updated
 		if ( cv != NULL && cv->last_update < t && t >= cv->next_update )
-		{
-			// if no worker available, wait to free existing ones
-			while ( nt >= max_threads )
-			{
-				// if starting wait, reset chronometer
-				if ( ! wait )
-				{
-					wait = true;
-					pstart = clock( );
-				}
-				else		// already waiting
-				{
-					wait_time = ( clock( ) - pstart ) / CLOCKS_PER_SEC;
-					if ( wait_time > MAX_WAIT_TIME )
-					{
-						error_hard( "deadlock during parallel computation",
-									"disable parallel computation for this variable or check your equation code to prevent this situation.\n\nPlease choose 'Quit LSD Browser' in the next dialog box",
-									true,
-									"variable '%s' (object '%s') took more than %d seconds\nwhile computing value for case %d", cv->label, cv->up->label, MAX_WAIT_TIME, t );
-						return;
-					}
-				}
-
-				// look for free and stopped workers
-				for ( i = 0; i < max_threads; ++i )
-				{
-					workers[ i ].check( );
-
-					if ( ! ready[ i ] && workers[ i ].free )
-					{
-						--nt;
-						ready[ i ] = true;
-						wait = false;
-					}
-				}
-
-				// sleep process until first worker is free
-				if ( nt >= max_threads )
-				{
-					unique_lock< mutex > lock_update( update_lock );
-					worker_ready = false;
-					if ( ! upd_workers.wait_for ( lock_update, chrono::milliseconds( MAX_TIMEOUT ), [ ]{ return ! worker_ready; } ) )
-						{
-							worker_ready = true;
-							plog( "\nWarning: workers timeout (%d millisecs.), continuing...", MAX_TIMEOUT );
-							break;
-						}
-				}
-
-				// recheck running workers
-				for ( i = 0; i < max_threads; ++i )
-					workers[ i ].check( );
-			}
-
-			// find first free worker
-			for ( i = 0; ! ready[ i ] && i < max_threads; ++i );
-			// if something go wrong, wait fist worker (always there)
-			if ( i >= max_threads )
-			{
-				error_hard( "parallel computation problem",
-							"disable parallel computation for this variable or check your equation code to prevent this situation.\n\nPlease choose 'Quit LSD Browser' in the next dialog box",
-							true,
-							"variable '%s' (object '%s') had a multi-threading inconsistency,\nmaybe a deadlock state", cv->label, cv->up->label );
-				return;
-			}
-			else
-			{	// start the computation of the current variable instance in the worker
-				++nt;
-				ready[ i ] = false;
-				workers[ i ].cal( cv );
-			}
-		}
+			job.vars.push_back( cv );
 	}
 
-	// wait last threads finish processing
-	while ( nt > 0 )
-	{	// if starting wait, reset chronometer
-		if ( ! wait )
-		{
-			wait = true;
-			pstart = clock( );
-		}
-		else		// already waiting
-		{
-			wait_time = ( clock( ) - pstart ) / CLOCKS_PER_SEC;
-			if ( wait_time > MAX_WAIT_TIME )
-			{
-				error_hard( "deadlock during parallel computation",
-							"disable parallel computation for this variable or check your equation code to prevent this situation.\n\nPlease choose 'Quit LSD Browser' in the next dialog box",
-							true,
-							"variable '%s' (object '%s') took more than %d seconds\nwhile computing value for case %d", cv != NULL ? cv->up->label : "", cv != NULL ? cv->label : "", MAX_WAIT_TIME, t );
-				return;
-			}
-		}
-
-		// wait till each thread finishes
-		for ( i = 0; i < max_threads; ++i )
-		{
-			if ( ! ready[ i ] && workers[ i ].free )
-			{
-				--nt;
-				ready[ i ] = true;
-				wait = false;
-			}
+	// chunks small enough to balance the load but large enough to amortize dispatching
+	job.chunk = max( ( size_t ) PAR_CHUNK_MIN, job.vars.size( ) / ( PAR_CHUNK_THR * max_threads ) );
 
-			// check worker problem
-			workers[ i ].check( );
-		}
-	}
+	if ( ! run_job( job, caller ) )
+		return;
 
 	// re-enable concurrent parallel update
 	parallel_ready = true;
 }
 
+
+/***************************************************
+TASK_THREADS
+Number of threads available to run engine tasks
+(see run_tasks), or 1 if the workers are busy in a
+parallel update or dependency wave (including when
+called from a worker) or not started
+****************************************************/
+int task_threads( void )
+{
+	return ( parallel_mode && parallel_ready && workers != NULL && max_threads > 1 ) ? max_threads : 1;
+}
+
+
+/***************************************************
+RUN_TASKS
+Run independent engine tasks (as the parts of a large
+sort) in the free workers and the calling thread,
+which takes tasks too, waiting all to complete. The
+tasks run in the calling thread alone if the workers
+are not available (see task_threads). The tasks must
+not compute variables nor change the model structure
+****************************************************/
+void run_tasks( vector < function < void( void ) > > &tasks )
+{
+	int i, nt;
+	size_t k;
+	upd_job job;
+
+	nt = min( task_threads( ), ( int ) tasks.size( ) ) - 1;
+
+	if ( nt < 1 )
+	{
+		for ( auto &f : tasks )
+			f( );
+
+		return;
+	}
+
+	parallel_ready = false;				// take the workers
+
+	// use only the workers ready before the first crashed one, if any
+	for ( i = 0; i < nt; ++i )
+	{
+		workers[ i ].wait_free( );
+
+		if ( ! workers[ i ].free )
+			nt = i;
+	}
+
+	if ( nt < 1 )
+	{
+		for ( auto &f : tasks )
+			f( );
+
+		parallel_ready = true;
+		return;
+	}
+
+	job.funcs.swap( tasks );
+	job.next = 0;
+	job.pending = nt + 1;
+	for ( i = 0; i < nt; ++i )
+		workers[ i ].cal( & job );
+
+	while ( ( k = job.next++ ) < job.num_tasks( ) )
+		job.funcs[ k ]( );
+
+	// completion barrier, leaving crashed workers behind
+	if ( --job.pending > 0 )
+	{
+		unique_lock < mutex > lock_job( job.lock );
+		while ( ! job.done.wait_for( lock_job, chrono::milliseconds( MAX_TIMEOUT ), [ & job ]{ return job.pending == 0; } ) )
+			for ( i = 0; i < nt; ++i )
+				if ( ! workers[ i ].running || workers[ i ].errored )
+				{
+					lock_job.unlock( );
+					job_stop( job, nt );
+					workers[ i ].check( );
+					return;
+				}
+	}
+
+	for ( i = 0; i < nt; ++i )
+		workers[ i ].wait_free( );
+
+	job.funcs.swap( tasks );
+	parallel_ready = true;
+}
+
+#endif
+
+/***************************************************
+DEPENDENCY WAVES
+Dependency-graph scheduler (-d option). During the
+DEP_WARM periods after the first one, the equations
+record the labels they request, with or without lags,
+and the object types they read from other objects.
+Side effects are recorded too: WRITE and RECALC mark
+the writer and the written label, shared random
+generator draws mark the drawing equation, and object
+creation, deletion or sorting mark the equation and
+the object type, and searching object types without
+instances marks the type as vacant. At the end of the
+warm-up, the variables without side effects, not
+written and depending only on such labels and types
+(not vacant), and not in object types with deletions,
+are grouped in topological waves (level 0 depends on
+no variable).
+In the following periods, before the root update,
+each wave is computed concurrently by the parallel
+workers, one label per task (split in chunks if set
+to parallel updating), using the usual per-variable
+locks. The remaining equations are computed as usual
+by the lazy pull in the regular update, which also
+covers any dependency not seen during the warm-up.
+While the waves are computed, a side effect or the
+request of a label not found pure removes the wave
+variable being computed from the waves. A side
+effect (writing, shared generator draw, structural
+change) is also rejected before being done, stopping
+the computation of the wave variable. The current
+period results of its instances, and of the variables
+they computed, are then discarded, restoring their
+lags, along with their structural changes, and the
+remaining waves are skipped, so all are recomputed
+in the serial order by the lazy pull. The request
+of a label not recorded for the wave variable in
+the warm-up is handled in the same way.
+The wave results are kept pending until used by the
+serial update. When a label or object type is then
+written or changed, the pending results depending on
+it are discarded, so they are recomputed after the
+change, as in the serial order, and its readers are
+removed from the waves from the next period.
+Side effects through static or global variables or
+hooks in equations are not detected, so models using
+them must not use this option.
+***************************************************/
+struct dep_node							// label node in dependency graph
+{
+	bool deleted;						// object type with deleted instances
+	bool effect;						// equation has side effects
+	bool pure;							// no side effects in dependencies
+	bool var;							// is a variable (not parameter/function)
+	bool vacant;						// object type searched without instances
+	bool written;						// label written or object type changed
+	char state;							// graph search state
+	int level;							// wave of pure variable
+	int type;							// label ID of variable object type
+	unordered_set < int > callees;		// labels requested in current period
+	unordered_set < int > reads;		// labels requested with lags and types read
+
+	dep_node( void ) : deleted( false ), effect( false ), pure( false ), var( false ), vacant( false ), written( false ), state( 0 ), level( 0 ), type( -1 ) { };
+};
+
+int dep_state = 0;						// 0: off, 1: recording, 2: scheduling
+bool dep_waving = false;				// waves being computed
+thread_local variable *dep_caller = NULL;	// variable being computed in thread
+thread_local variable *dep_task = NULL;	// outermost variable computed in thread
+#ifndef _NP_
+thread_local vector < dep_link > *dep_links = NULL;// variables requested in wave in thread
+thread_local vector < dep_undo > *dep_log = NULL;// variables computed in wave in thread
+
+struct dep_result						// result of variable computed in waves
+{
+	bool pending;						// not yet used by the serial update
+	int prev;							// previous result of same instance (-1: none)
+	dep_undo undo;						// undo data of the computation
+	vector < int > callees;				// results requested in the computation
+};
+
+vector < dep_result > dep_results;		// results of the waves in current period
 #endif
+vector < int > dep_demoted;				// wave labels found with side effects
+vector < int > dep_changed;				// labels changed after the waves
+vector < dep_node > dep_nodes;			// graph nodes by label ID
+vector < int > dep_slot;				// index of label ID in waves (-1: none)
+vector < vector < int > > dep_users;	// label IDs requesting or reading each label
+vector < vector < int > > dep_waves;	// label IDs in each wave
+
+#ifndef _NP_
+mutex lock_dep;
+#endif
+
+static dep_node &dep_get( int id )
+{
+	if ( id >= ( int ) dep_nodes.size( ) )
+		dep_nodes.resize( id + 1 );
+
+	return dep_nodes[ id ];
+}
+
+// check if label ID was found pure when the waves were built
+static bool dep_known( int id )
+{
+	return id < ( int ) dep_nodes.size( ) && dep_nodes[ id ].state == 2 && dep_nodes[ id ].pure;
+}
+
+// check if label ID was requested (or read if lagged) by variable v in the warm-up
+static bool dep_seen( variable *v, int id, bool lagged )
+{
+	if ( v->id < 0 || v->id >= ( int ) dep_nodes.size( ) )
+		return false;
+
+	return lagged ? dep_nodes[ v->id ].reads.count( id ) > 0 : dep_nodes[ v->id ].callees.count( id ) > 0;
+}
+
+// remove the wave variable being computed in thread from the next waves
+static void dep_demote( void )
+{
+	int id = dep_task->id;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_dep );
+#endif
+
+	if ( ! dep_nodes[ id ].effect )
+	{
+		dep_nodes[ id ].effect = true;
+		dep_demoted.push_back( id );
+	}
+}
+
+
+/***************************************************
+DEP_CALL
+Record the request of variable v by the variable
+being computed in the current thread, or check it
+while the waves are computed
+***************************************************/
+void dep_call( variable *v, int lag )
+{
+	if ( v->dep_pos >= 0 && lag == 0 && ! dep_waving )
+		dep_use( v );					// wave result used by serial update
+
+	if ( dep_caller == NULL || dep_caller == v )
+		return;
+
+	if ( dep_state == 2 )
+	{
+		if ( dep_waving )
+		{
+			int id = v->id;
+			int tid = ( v->up != dep_caller->up && v->up != NULL ) ? v->up->id : -1;
+
+			if ( ! dep_known( id ) || ! dep_seen( dep_caller, id, lag > 0 ) || ( tid >= 0 && ( ! dep_known( tid ) || ! dep_seen( dep_caller, tid, true ) ) ) )
+				dep_demote( );
+#ifndef _NP_
+			else
+				if ( lag == 0 && v->param != 1 && dep_links != NULL )
+					dep_links->push_back( { dep_caller, v } );
+#endif
+		}
+
+		return;
+	}
+
+	int id = v->id, cid = dep_caller->id;
+	int tid = ( v->up != dep_caller->up && v->up != NULL ) ? v->up->id : -1;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_dep );
+#endif
+
+	dep_get( id );
+	if ( tid >= 0 )						// reading from another object
+	{
+		dep_get( tid );
+		dep_get( cid ).reads.insert( tid );
+	}
+
+	if ( lag == 0 )
+		dep_get( cid ).callees.insert( id );
+	else
+		dep_get( cid ).reads.insert( id );
+}
+
+
+/***************************************************
+DEP_READ
+Record the reading of the instances of object type
+lab by the variable being computed in the thread
+***************************************************/
+void dep_read( const char *lab )
+{
+	if ( dep_caller == NULL )
+		return;
+
+	if ( dep_state == 2 )
+	{
+		if ( dep_waving && ( ! dep_known( lab_id( lab ) ) || ! dep_seen( dep_caller, lab_id( lab ), true ) ) )
+			dep_demote( );
+
+		return;
+	}
+
+	int id = lab_id( lab ), cid = dep_caller->id;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_dep );
+#endif
+
+	dep_get( id );
+	dep_get( cid ).reads.insert( id );
+}
+
+
+/***************************************************
+DEP_VACANT
+Record the search of object type lab, without any
+instance, by the variable being computed in thread
+***************************************************/
+void dep_vacant( const char *lab )
+{
+	dep_read( lab );
+
+	if ( dep_state != 1 || dep_caller == NULL )
+		return;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_dep );
+#endif
+
+	dep_get( lab_id( lab ) ).vacant = true;
+}
+
+
+/***************************************************
+DEP_STORE
+Keep the data to undo the computation of variable v
+in the current period, while the waves are computed
+***************************************************/
+void dep_store( variable *v )
+{
+#ifndef _NP_
+	dep_undo u;
+
+	if ( dep_log == NULL || dep_task == NULL )
+		return;
+
+	u.task = dep_task->id;
+	u.last_update = v->last_update;
+	u.next_update = v->next_update;
+	u.drop = v->lagged( v->num_lag );
+	u.var = v;
+
+	dep_log->push_back( u );
+#endif
+}
+
+
+/***************************************************
+DEP_ENTER / DEP_LEAVE
+Set the variable being computed in the current
+thread, returning the previous one to be restored
+***************************************************/
+variable *dep_enter( variable *v )
+{
+	variable *prev = dep_caller;
+
+	if ( dep_state == 1 )
+	{
+		int id = v->id, tid = v->up != NULL ? v->up->id : -1;
+
+#ifndef _NP_
+		lock_guard < mutex > lock( lock_dep );
+#endif
+		if ( tid >= 0 )
+			dep_get( tid );
+
+		dep_node &n = dep_get( id );
+		n.var = ( v->param == 0 );
+		n.type = tid;
+	}
+
+	if ( prev == NULL )
+		dep_task = v;
+
+	dep_caller = v;
+	return prev;
+}
+
+void dep_leave( variable *prev )
+{
+	dep_caller = prev;
+}
+
+
+#ifndef _NP_
+// restore variable computed in wave to its state before the computation
+static void dep_restore( dep_undo &u )
+{
+	variable *cv = u.var;
+
+	cv->head = cv->head < cv->num_lag ? cv->head + 1 : 0;
+	cv->lagged( cv->num_lag ) = u.drop;
+	cv->last_update = u.last_update;
+	cv->next_update = u.next_update;
+	cv->roll_cnt = -1;					// rolling window changed
+	cv->rnd_t = -1;						// restart counter-based draws
+}
+
+// discard the pending wave results depending on label ID, changed after the waves
+static void dep_change( int id )
+{
+	int i;
+	vector < bool > dep;
+	vector < int > todo;
+
+	lock_guard < mutex > lock( lock_dep );
+
+	if ( ! dep_known( id ) || dep_nodes[ id ].written )
+		return;
+
+	dep_nodes[ id ].written = true;		// remove readers from the next waves
+	dep_changed.push_back( id );
+
+	// labels requesting or reading the changed one, directly or not
+	dep.resize( dep_nodes.size( ) );
+	for ( dep[ id ] = true, todo.push_back( id ); ! todo.empty( ); )
+	{
+		i = todo.back( );
+		todo.pop_back( );
+
+		for ( auto u : dep_users[ i ] )
+			if ( ! dep[ u ] )
+			{
+				dep[ u ] = true;
+				todo.push_back( u );
+			}
+	}
+
+	for ( i = ( int ) dep_results.size( ) - 1; i >= 0; --i )
+		if ( dep_results[ i ].pending && dep[ dep_results[ i ].undo.var->id ] )
+		{
+			dep_results[ i ].pending = false;
+			dep_restore( dep_results[ i ].undo );
+			dep_results[ i ].undo.var->dep_pos = -1;
+		}
+}
+#endif
+
+
+/***************************************************
+DEP_USE
+Mark the pending wave result of variable v, and the
+ones requested to compute it, as used by the serial
+update, so they are kept when a dependency changes
+***************************************************/
+void dep_use( variable *v )
+{
+#ifndef _NP_
+	int i;
+	vector < int > todo;
+
+	lock_guard < mutex > lock( lock_dep );
+
+	if ( v->dep_pos >= 0 )				// recheck under lock
+		todo.push_back( v->dep_pos );
+
+	while ( ! todo.empty( ) )
+	{
+		i = todo.back( );
+		todo.pop_back( );
+
+		dep_result &r = dep_results[ i ];
+		if ( ! r.pending )
+			continue;
+
+		r.pending = false;
+		r.undo.var->dep_pos = -1;
+
+		if ( r.prev >= 0 )
+			todo.push_back( r.prev );
+
+		todo.insert( todo.end( ), r.callees.begin( ), r.callees.end( ) );
+	}
+#endif
+}
+
+
+/***************************************************
+DEP_FORGET
+Drop the pending wave results of variable v, before
+it is deleted
+***************************************************/
+void dep_forget( variable *v )
+{
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_dep );
+
+	for ( int i = v->dep_pos; i >= 0; i = dep_results[ i ].prev )
+		dep_results[ i ].pending = false;
+
+	v->dep_pos = -1;
+#endif
+}
+
+
+/***************************************************
+DEP_EFFECT
+Record a side effect by the variable being computed
+in the current thread, writing to label lab, if any
+***************************************************/
+void dep_effect( const char *lab )
+{
+	if ( dep_state == 2 )
+	{
+		if ( dep_waving && dep_caller != NULL )
+		{
+			dep_demote( );
+			throw dep_reject( );		// stop the task before the effect is done
+		}
+
+#ifndef _NP_
+		if ( ! dep_waving && lab != NULL && dep_results.size( ) > 0 )
+			dep_change( lab_id( lab ) );
+#endif
+		return;
+	}
+
+	if ( dep_caller == NULL && lab == NULL )
+		return;
+
+	int id = lab != NULL ? lab_id( lab ) : -1;
+	int cid = dep_caller != NULL ? dep_caller->id : -1;
+
+#ifndef _NP_
+	lock_guard < mutex > lock( lock_dep );
+#endif
+
+	if ( cid >= 0 )
+		dep_get( cid ).effect = true;
+
+	if ( id >= 0 )
+		dep_get( id ).written = true;
+}
+
+
+/***************************************************
+DEP_DELETE
+Record the deletion of object r, and of its
+descendants, by the variable being computed
+***************************************************/
+void dep_delete( object *r )
+{
+	bridge *cb;
+
+	dep_effect( r->label );
+
+	if ( dep_state == 2 )
+	{
+#ifndef _NP_
+		if ( dep_waving || dep_results.size( ) == 0 )
+#endif
+			return;
+	}
+	else
+	{
+#ifndef _NP_
+		lock_guard < mutex > lock( lock_dep );
+#endif
+		dep_get( r->id ).deleted = true;
+	}
+
+	for ( cb = r->b; cb != NULL; cb = cb->next )
+		if ( cb->head != NULL )
+			dep_delete( cb->head );
+}
+
+
+// check if label and its dependencies have no side effects, setting its wave
+static bool dep_pure( int id )
+{
+	dep_node &n = dep_nodes[ id ];
+
+	if ( n.state != 0 )					// evaluated or in a cycle
+		return n.state == 2 && n.pure;
+
+	n.state = 1;
+	n.pure = ! ( n.effect || n.written || n.vacant || ( n.type >= 0 && dep_nodes[ n.type ].deleted ) );
+
+	for ( auto c : n.reads )
+		if ( ! dep_pure( c ) )
+			n.pure = false;
+
+	for ( auto c : n.callees )
+		if ( ! dep_pure( c ) )
+			n.pure = false;
+		else					// computed after pure variables requested
+			n.level = max( n.level, dep_nodes[ c ].level + ( dep_nodes[ c ].var ? 1 : 0 ) );
+
+	n.state = 2;
+	return n.pure;
+}
+
+// build the waves from the recorded graph
+static void dep_build( void )
+{
+	int id, n = 0;
+
+	dep_waves.clear( );
+	dep_slot.assign( dep_nodes.size( ), -1 );
+	dep_users.assign( dep_nodes.size( ), vector < int > ( ) );
+
+	for ( id = 0; id < ( int ) dep_nodes.size( ); ++id )
+	{
+		for ( auto c : dep_nodes[ id ].reads )
+			dep_users[ c ].push_back( id );
+
+		for ( auto c : dep_nodes[ id ].callees )
+			dep_users[ c ].push_back( id );
+	}
+
+	for ( id = 0; id < ( int ) dep_nodes.size( ); ++id )
+		if ( dep_pure( id ) && dep_nodes[ id ].var )
+		{
+			if ( dep_nodes[ id ].level >= ( int ) dep_waves.size( ) )
+				dep_waves.resize( dep_nodes[ id ].level + 1 );
+
+			dep_waves[ dep_nodes[ id ].level ].push_back( id );
+			dep_slot[ id ] = n++;
+		}
+
+	if ( fast_mode < 2 )
+		plog( "\nDependency scheduler: %d variable(s) in %d wave(s)\n", n, ( int ) dep_waves.size( ) );
+}
+
+#ifndef _NP_
+// check if the label of wave variable v was removed from the waves while computed
+static bool dep_dropped( variable *v )
+{
+	return v->id >= 0 && v->id < ( int ) dep_nodes.size( ) && dep_nodes[ v->id ].effect;
+}
+
+// discard the current period results of the variables computed by removed wave variables
+static void dep_discard( vector < dep_undo > &undos )
+{
+	for ( auto it = undos.rbegin( ); it != undos.rend( ); ++it )
+		if ( dep_nodes[ it->task ].effect )
+			dep_restore( *it );
+}
+
+// keep the other results of a wave job pending, until used by the serial update
+static void dep_keep( upd_job &job )
+{
+	for ( auto &u : job.undos )
+		if ( ! dep_nodes[ u.task ].effect )
+		{
+			dep_results.push_back( { true, u.var->dep_pos, u, { } } );
+			u.var->dep_pos = dep_results.size( ) - 1;
+		}
+
+	for ( auto &l : job.links )
+		if ( l.from->dep_pos >= 0 && l.to->dep_pos >= 0 )
+			dep_results[ l.from->dep_pos ].callees.push_back( l.to->dep_pos );
+}
+
+// make the pending wave results of the previous period final
+static void dep_clear( void )
+{
+	for ( auto &r : dep_results )
+		if ( r.pending )
+			r.undo.var->dep_pos = -1;
+
+	dep_results.clear( );
+}
+
+// collect the instances to compute of the labels in waves
+static void dep_collect( object *r, vector < vector < variable * > > &inst )
+{
+	int id;
+	bridge *cb;
+	object *co;
+	variable *cv;
+	vector < int > ids;
+
+	for ( cb = r->b; cb != NULL; cb = cb->next )
+	{
+		if ( cb->head == NULL || ! cb->head->to_compute )
+			continue;
+
+		// wave labels in the object type
+		ids.clear( );
+		for ( cv = cb->head->v; cv != NULL; cv = cv->next )
+			if ( ( id = cv->id ) < ( int ) dep_slot.size( ) && dep_slot[ id ] >= 0 )
+				ids.push_back( id );
+
+		for ( co = cb->head; co != NULL; co = co->next )
+		{
+			for ( auto i : ids )
+				if ( ( cv = co->search_var( co, i ) ) != NULL && cv->last_update < t && t >= cv->next_update )
+					inst[ dep_slot[ i ] ].push_back( cv );
+
+			dep_collect( co, inst );
+		}
+	}
+}
+
+// compute the waves, each one as a parallel job
+static void dep_run( object *r )
+{
+	int id;
+	size_t k, demoted;
+	variable *cv;
+	vector < vector < variable * > > inst( dep_slot.size( ) );
+
+	for ( cv = r->v; cv != NULL; cv = cv->next )
+		if ( ( id = cv->id ) < ( int ) dep_slot.size( ) && dep_slot[ id ] >= 0 && cv->last_update < t && t >= cv->next_update )
+			inst[ dep_slot[ id ] ].push_back( cv );
+
+	dep_collect( r, inst );
+
+	parallel_ready = false;
+	dep_waving = true;
+
+	for ( auto &wave : dep_waves )
+	{
+		upd_job job;
+
+		// one task per label, or chunks if set to parallel updating
+		job.tasks.push_back( 0 );
+		for ( auto i : wave )
+		{
+			auto &v = inst[ dep_slot[ i ] ];
+
+			for ( k = 0; k < v.size( ); ++k )
+			{
+				job.vars.push_back( v[ k ] );
+
+				if ( k + 1 == v.size( ) || ( v[ 0 ]->parallel && ( k + 1 ) % PAR_CHUNK_MIN == 0 ) )
+					job.tasks.push_back( job.vars.size( ) );
+			}
+		}
+
+		demoted = dep_demoted.size( );
+
+		if ( job.vars.size( ) > 0 && ! run_job( job, NULL ) )
+		{
+			dep_waving = false;
+			return;
+		}
+
+		// leave the variables removed from the waves, and the next waves, to the lazy pull
+		if ( dep_demoted.size( ) > demoted )
+			dep_discard( job.undos );
+
+		dep_keep( job );
+
+		if ( dep_demoted.size( ) > demoted || quit == 2 )
+			break;
+	}
+
+	dep_waving = false;
+	parallel_ready = true;
+}
+#endif
+
+
+/***************************************************
+DEP_PERIOD
+Handle the dependency scheduler before the update of
+period t, recording in the warm-up periods and
+computing the waves afterwards
+***************************************************/
+void dep_period( object *r )
+{
+	if ( t == start_step )				// reset for a new run
+	{
+		dep_state = 0;
+		dep_caller = dep_task = NULL;
+		dep_changed.clear( );
+		dep_demoted.clear( );
+		dep_nodes.clear( );
+		dep_slot.clear( );
+		dep_waves.clear( );
+#ifndef _NP_
+		dep_results.clear( );
+#endif
+	}
+#ifndef _NP_
+	else
+		dep_clear( );
+#endif
+
+	// only useful with multiple threads
+	if ( ! parallel_mode || max_threads < 2 )
+		return;
+
+	if ( t == start_step + 1 )			// skip initialization period
+		dep_state = 1;
+
+	if ( dep_state == 1 && t >= start_step + 1 + DEP_WARM )
+	{
+		dep_build( );
+		dep_state = 2;
+	}
+
+	if ( dep_state == 2 && ( dep_demoted.size( ) > 0 || dep_changed.size( ) > 0 ) )
+	{									// rebuild without the labels with effects
+		if ( fast_mode < 2 )
+		{
+			for ( auto id : dep_demoted )
+				plog( "\nDependency scheduler: '%s' has side effects, removed from waves", lab_name( id ) );
+
+			for ( auto id : dep_changed )
+				plog( "\nDependency scheduler: '%s' changed after waves, readers removed from waves", lab_name( id ) );
+		}
+
+		dep_changed.clear( );
+		dep_demoted.clear( );
+		for ( auto &n : dep_nodes )
+		{
+			n.state = 0;
+			n.level = 0;
+		}
+
+		dep_build( );
+	}
+
+#ifndef _NP_
+	if ( dep_state == 2 && dep_waves.size( ) > 0 )
+		dep_run( r );
+#endif
+}
+
+/***************************************************
+EQUATION PROFILER
+Headless equations profiler (-q option). Each thread
+keeps its own call tree of the equations computed,
+with the number of computations and the inclusive
+and exclusive times, measured with the processor
+time-stamp counter (or the steady clock, if not
+available). The computations longer than
+PROF_MIN_USEC are also kept for the trace timeline.
+***************************************************/
+int prof_on = false;					// profiler active
+int prof_run = 0;						// current profiled run
+vector < prof_thread * > prof_threads;	// profiler data of each thread
+thread_local int prof_cur_run = -1;		// run of thread profiler data
+thread_local prof_thread *prof_cur = NULL;	// thread profiler data
+double prof_nspt = 1;					// nanoseconds per tick
+unsigned long long prof_tick0;			// run start time (ticks)
+unsigned long long prof_min;			// minimum time in trace (ticks)
+chrono::steady_clock::time_point prof_clk0;	// run start time
+
+#ifndef _NP_
+mutex lock_prof;
+#endif
+
+static inline unsigned long long prof_ticks( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+	return __rdtsc( );
+#else
+	return chrono::duration_cast < chrono::nanoseconds > ( chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+#endif
+}
+
+// calibrate the ticks duration against the steady clock
+static void prof_calib( void )
+{
+	unsigned long long dt = prof_ticks( ) - prof_tick0;
+	double ns = chrono::duration_cast < chrono::nanoseconds > ( chrono::steady_clock::now( ) - prof_clk0 ).count( );
+
+	if ( dt > 0 && ns > 0 )
+		prof_nspt = ns / dt;
+}
+
+// create the profiler data for the current thread
+static prof_thread *prof_new( void )
+{
+	prof_thread *p = new prof_thread;
+
+	p->cur = 0;
+	p->nodes.push_back( prof_node{ -1, -1, 0, 0, 0, { } } );
+
+	{
+#ifndef _NP_
+		lock_guard < mutex > lock( lock_prof );
+#endif
+		p->tid = prof_threads.size( );
+		prof_threads.push_back( p );
+	}
+
+	prof_cur_run = prof_run;
+	return prof_cur = p;
+}
+
+
+/***************************************************
+PROF_START
+Reset the profiler for a new simulation run
+***************************************************/
+void prof_start( void )
+{
+	for ( auto p : prof_threads )
+		delete p;
+
+	prof_threads.clear( );
+	++prof_run;							// invalidate threads data
+	prof_on = true;
+
+	prof_clk0 = chrono::steady_clock::now( );
+	prof_tick0 = prof_ticks( );
+	this_thread::sleep_for( chrono::milliseconds( 2 ) );
+	prof_calib( );						// preliminary calibration
+	prof_min = ( unsigned long long ) ( PROF_MIN_USEC * 1000 / prof_nspt );
+}
+
+
+/***************************************************
+PROF_ENTER / PROF_LEAVE
+Start and finish profiling the computation of the
+equation of variable v in the current thread
+***************************************************/
+void prof_enter( variable *v )
+{
+	int i, n;
+	prof_thread *p = prof_cur_run == prof_run ? prof_cur : prof_new( );
+	vector < pair < int, int > > &sons = p->nodes[ p->cur ].sons;
+
+	for ( i = 0, n = sons.size( ); i < n && sons[ i ].first != v->id; ++i );
+
+	if ( i < n )
+		n = sons[ i ].second;
+	else
+	{
+		n = p->nodes.size( );
+		sons.push_back( make_pair( v->id, n ) );
+		p->nodes.push_back( prof_node{ v->id, p->cur, 0, 0, 0, { } } );
+	}
+
+	p->cur = n;
+	p->stack.push_back( prof_frame{ n, 0, 0 } );
+	p->stack.back( ).start = prof_ticks( );
+}
+
+void prof_leave( void )
+{
+	unsigned long long end = prof_ticks( ), dur;
+	prof_thread *p = prof_cur;
+
+	if ( p == NULL || prof_cur_run != prof_run || p->stack.empty( ) )
+		return;
+
+	prof_frame f = p->stack.back( );
+	p->stack.pop_back( );
+
+	dur = end - f.start;
+	prof_node &x = p->nodes[ f.node ];
+	++x.calls;
+	x.incl += dur;
+	x.excl += dur > f.sons ? dur - f.sons : 0;
+	p->cur = x.up;
+
+	if ( ! p->stack.empty( ) )
+		p->stack.back( ).sons += dur;
+
+	if ( dur >= prof_min && p->events.size( ) < PROF_MAX_EVENTS )
+		p->events.push_back( prof_event{ x.id, f.start - prof_tick0, dur } );
+}
+
+
+/***************************************************
+PROF_SAVE
+Save the profiler results of the last run to the
+files base.trace.json (Chrome trace format, with the
+long computations in each thread timeline) and
+base.folded (collapsed stacks of the exclusive times
+in microseconds, for flame graphs), and log the
+PROF_TOP equations by exclusive time
+***************************************************/
+void prof_save( const char *base )
+{
+	bool first;
+	int i, j;
+	char fname[ MAX_PATH_LENGTH ];
+	double usec = 0;
+	FILE *f;
+	string path;
+	vector < string > paths;
+	unordered_map < string, double > stacks;
+	unordered_map < int, prof_node > totals;
+
+	prof_calib( );
+	auto us = [ ]( unsigned long long ticks ) { return ticks * prof_nspt / 1000; };
+
+	// collapsed stacks and totals by equation from all threads
+	for ( auto p : prof_threads )
+	{
+		paths.assign( p->nodes.size( ), "" );
+
+		for ( i = 1; i < ( int ) p->nodes.size( ); ++i )
+		{
+			prof_node &x = p->nodes[ i ];
+			paths[ i ] = x.up > 0 ? paths[ x.up ] + ";" + lab_name( x.id ) : lab_name( x.id );
+			stacks[ paths[ i ] ] += us( x.excl );
+			usec += us( x.excl );
+
+			prof_node &tot = totals[ x.id ];
+			tot.calls += x.calls;
+			tot.excl += x.excl;
+
+			// inclusive time not counted in recursive calls
+			for ( j = x.up; j > 0 && p->nodes[ j ].id != x.id; j = p->nodes[ j ].up );
+			if ( j <= 0 )
+				tot.incl += x.incl;
+		}
+	}
+
+	snprintf( fname, MAX_PATH_LENGTH, "%s.folded", base );
+	if ( ( f = fopen( fname, "w" ) ) != NULL )
+	{
+		for ( auto &s : stacks )
+			if ( llround( s.second ) > 0 )
+				fprintf( f, "%s %lld\n", s.first.c_str( ), llround( s.second ) );
+
+		fclose( f );
+	}
+	else
+		plog( "\nError: cannot create the profiler file '%s'\n", fname );
+
+	snprintf( fname, MAX_PATH_LENGTH, "%s.trace.json", base );
+	if ( ( f = fopen( fname, "w" ) ) != NULL )
+	{
+		fprintf( f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+		first = true;
+
+		for ( auto p : prof_threads )
+		{
+			fprintf( f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}", first ? "" : ",", p->tid, p->tid );
+			first = false;
+
+			for ( auto &e : p->events )
+				fprintf( f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", lab_name( e.id ), p->tid, us( e.start ), us( e.dur ) );
+		}
+
+		fprintf( f, "\n]}\n" );
+		fclose( f );
+	}
+	else
+		plog( "\nError: cannot create the profiler file '%s'\n", fname );
+
+	if ( fast_mode >= 2 || totals.size( ) == 0 )
+		return;
+
+	vector < pair < int, prof_node > > top( totals.begin( ), totals.end( ) );
+	sort( top.begin( ), top.end( ), [ ]( const pair < int, prof_node > &a, const pair < int, prof_node > &b ) { return a.second.excl > b.second.excl; } );
+
+	plog( "\nEquations profile (%.3f sec. in %d thread(s), top %d by exclusive time):\n", usec / 1e6, ( int ) prof_threads.size( ), PROF_TOP );
+	plog( "%-32s\t%12s\t%12s\t%12s\n", "Equation", "Calls", "Incl. (ms)", "Excl. (ms)" );
+
+	for ( i = 0; i < ( int ) top.size( ) && i < PROF_TOP; ++i )
+		plog( "%-32.32s\t%12lld\t%12.3f\t%12.3f\n", lab_name( top[ i ].first ), top[ i ].second.calls, us( top[ i ].second.incl ) / 1000, us( top[ i ].second.excl ) / 1000 );
+}
+
+
+/***************************************************
+PROF_INCL
+Return the inclusive time (ms) of the computations
+of the equation with label ID id in the current run,
+summed over all threads (recursive calls not counted)
+***************************************************/
+double prof_incl( int id )
+{
+	int i, j;
+	double ticks = 0;
+
+	for ( auto p : prof_threads )
+		for ( i = 1; i < ( int ) p->nodes.size( ); ++i )
+			if ( p->nodes[ i ].id == id )
+			{
+				for ( j = p->nodes[ i ].up; j > 0 && p->nodes[ j ].id != id; j = p->nodes[ j ].up );
+				if ( j <= 0 )
+					ticks += p->nodes[ i ].incl;
+			}
+
+	prof_calib( );
+	return ticks * prof_nspt / 1e6;
+}
+
+
+/***************************************************
+BENCHMARK RECORDS
+Benchmark file (-j FILE[:LABEL,...] option), saved
+as JSON with, for each run, the records of each time
+step: the wall time, the peak resident memory and the
+inclusive time of the selected equations (CPU time,
+if computed in several threads). The time to save
+the results of the run is also recorded. The file is
+rewritten at the end of each run.
+***************************************************/
+string bench_file;						// benchmark file name
+string bench_runs;						// JSON of the finished runs
+string bench_cur;						// JSON of the current run
+vector < int > bench_ids;				// label IDs of the equations to time
+vector < double > bench_last;			// equations time at the previous step
+chrono::steady_clock::time_point bench_clk0, bench_clk, bench_clk_save;
+
+static double bench_ms( chrono::steady_clock::time_point &from )
+{
+	chrono::steady_clock::time_point now = chrono::steady_clock::now( );
+	double ms = chrono::duration < double, milli > ( now - from ).count( );
+
+	from = now;
+	return ms;
+}
+
+// peak resident set size (KB)
+static long bench_rss( void )
+{
+#ifdef _WIN32
+	return 0;							// not available
+#else
+	struct rusage ru;
+
+	if ( getrusage( RUSAGE_SELF, & ru ) != 0 )
+		return 0;
+#ifdef __APPLE__
+	return ru.ru_maxrss / 1024;			// bytes in macOS
+#else
+	return ru.ru_maxrss;
+#endif
+#endif
+}
+
+static void bench_add( string &json, const char *fmt, ... )
+{
+	char buf[ MAX_LINE_SIZE ];
+	va_list args;
+
+	va_start( args, fmt );
+	vsnprintf( buf, MAX_LINE_SIZE, fmt, args );
+	va_end( args );
+
+	json += buf;
+}
+
+
+/***************************************************
+BENCH_OPEN
+Set the benchmark file and the equations to time
+from the option argument FILE[:LABEL,LABEL,...]
+***************************************************/
+bool bench_open( const char *arg )
+{
+	char *lab, *labs = new char[ strlen( arg ) + 1 ];
+	FILE *f;
+
+	strcpy( labs, arg );
+	lab = strrchr( labs, ':' );
+
+	// skip drive letter in Windows
+	if ( lab != NULL && ! ( lab == labs + 1 && isalpha( labs[ 0 ] ) && ( lab[ 1 ] == '\\' || lab[ 1 ] == '/' ) ) )
+	{
+		*lab++ = '\0';
+		for ( lab = strtok( lab, "," ); lab != NULL; lab = strtok( NULL, "," ) )
+			if ( strlen( lab ) > 0 )
+				bench_ids.push_back( lab_id( lab ) );
+	}
+
+	bench_file = labs;
+	delete [ ] labs;
+
+	if ( ( f = fopen( bench_file.c_str( ), "w" ) ) == NULL )
+		return false;
+
+	fclose( f );
+	bench_runs.clear( );
+	dobench = true;
+
+	return true;
+}
+
+
+/***************************************************
+BENCH_RUN
+Start the benchmark records of a new run
+***************************************************/
+void bench_run( int seed )
+{
+	if ( bench_ids.size( ) > 0 && ! doprof )
+		prof_start( );
+
+	bench_cur.clear( );
+	bench_add( bench_cur, "%s\n{\"seed\":%d,\"threads\":%d,\"waves\":%s,\"steps\":[", bench_runs.size( ) > 0 ? "," : "", seed, max_threads, dowaves ? "true" : "false" );
+	bench_last.assign( bench_ids.size( ), 0 );
+	bench_clk0 = bench_clk = chrono::steady_clock::now( );
+}
+
+
+/***************************************************
+BENCH_STEP
+Add the records of time step t to the current run
+***************************************************/
+void bench_step( int t )
+{
+	int i;
+	double ms;
+
+	bench_add( bench_cur, "%s\n{\"t\":%d,\"wall_ms\":%.3f,\"peak_rss_kb\":%ld,\"eq_ms\":{", t > start_step ? "," : "", t, bench_ms( bench_clk ), bench_rss( ) );
+
+	for ( i = 0; i < ( int ) bench_ids.size( ); ++i )
+	{
+		ms = prof_incl( bench_ids[ i ] );
+		bench_add( bench_cur, "%s\"%s\":%.3f", i > 0 ? "," : "", lab_name( bench_ids[ i ] ), ms - bench_last[ i ] );
+		bench_last[ i ] = ms;
+	}
+
+	bench_cur += "}}";
+}
+
+
+/***************************************************
+BENCH_SAVE / BENCH_END
+Close the time steps records of the current run and
+record the time to save its results, rewriting the
+benchmark file
+***************************************************/
+void bench_save( void )
+{
+	bench_clk_save = chrono::steady_clock::now( );
+	bench_add( bench_cur, "\n],\"run_ms\":%.3f,\"peak_rss_kb\":%ld", chrono::duration < double, milli > ( bench_clk_save - bench_clk0 ).count( ), bench_rss( ) );
+}
+
+void bench_end( void )
+{
+	int i;
+	FILE *f;
+
+	bench_add( bench_cur, ",\"results_ms\":%.3f}", bench_ms( bench_clk_save ) );
+	bench_runs += bench_cur;
+	bench_cur.clear( );
+
+	if ( ( f = fopen( bench_file.c_str( ), "w" ) ) == NULL )
+	{
+		plog( "\nError: cannot create the benchmark file '%s'\n", bench_file.c_str( ) );
+		return;
+	}
+
+	fprintf( f, "{\"config\":\"%s\",\"max_step\":%d,\"labels\":[", clean_file( simul_name ), max_step );
+
+	for ( i = 0; i < ( int ) bench_ids.size( ); ++i )
+		fprintf( f, "%s\"%s\"", i > 0 ? "," : "", lab_name( bench_ids[ i ] ) );
+
+	fprintf( f, "],\"runs\":[%s\n]}\n", bench_runs.c_str( ) );
+	fclose( f );
+}
+
 
 /****************************************************
 WORKER_ERRORS